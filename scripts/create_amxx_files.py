@@ -49,6 +49,7 @@ class ClassInfo:
         self.base_class_name: str | None = None
         self.fields: list[FieldInfo] = []
         self.vtable: list[VirtualMethodInfo] = []
+        self.has_resolved_vtable = False
 
     def find_field(self, name: str) -> FieldInfo | None:
         for i in self.fields:
@@ -69,81 +70,118 @@ def log_warn(s: str):
 def log_note(s: str):
     print(f'NOTE   {s}')
 
-def read_json(path, platform: EPlatform) -> dict[str, ClassInfo]:
-    with open(path, 'r') as f:
-        jroot = json.load(f)
+def read_classes(path: Path) -> dict:
+    if path.is_dir():
+        # --out-dir: every shard is one NDJSON line, listed in manifest.json
+        with open(path / 'manifest.json', 'r') as f:
+            manifest = json.load(f)
 
-        result: dict[str, ClassInfo] = {}
+        if manifest['format'] != 'ndjson':
+            raise Exception(f'{path}: unsupported shard format {manifest["format"]}')
 
-        for class_name, jclass in jroot['classes'].items():
-            ci = ClassInfo()
-            ci.base_class_name = jclass['baseClass']
+        jclasses = {}
+        for shard in manifest['classes']:
+            with open(path / shard['file'], 'r') as f:
+                jclasses[shard['name']] = json.load(f)
 
-            for jfield in jclass['fields']:
-                fi = FieldInfo()
-                fi.name = jfield['name']
-                fi.array_size = jfield['arraySize']
-                fi.amxx_type = jfield['amxxType']
-                fi.unsigned = jfield['unsigned']
-                
-                fi.plat_offset[platform] = jfield['offset']
-                fi.plat_type[platform] = jfield['type']
+        return jclasses
+
+    with open(path, 'r') as f:
+        if str(path).endswith('.ndjson'):
+            # One class per line, see --format ndjson
+            jclasses = {}
+            for line in f:
+                if line.strip():
+                    jclass = json.loads(line)
+                    jclasses[jclass['name']] = jclass
+            return jclasses
+        else:
+            return json.load(f)['classes']
+
+def read_json(path, platform: EPlatform) -> dict[str, ClassInfo]:
+    jclasses = read_classes(Path(path))
 
-                ci.fields.append(fi)
+    result: dict[str, ClassInfo] = {}
 
-            method_map: dict[str, VirtualMethodInfo] = {}
-            method_overload_names: set[str] = set()
+    for class_name, jclass in jclasses.items():
+        ci = ClassInfo()
+        ci.base_class_name = jclass['baseClass']
 
-            for jmethod in jclass['vtable']:
-                vmi = VirtualMethodInfo()
-                vmi.name = jmethod['name']
+        for jfield in jclass['fields']:
+            fi = FieldInfo()
+            fi.name = jfield['name']
+            fi.array_size = jfield['arraySize']
+            fi.amxx_type = jfield['amxxType']
+            fi.unsigned = jfield['unsigned']
+            
+            fi.plat_offset[platform] = jfield['offset']
+            fi.plat_type[platform] = jfield['type']
 
-                vmi.plat_link_name[platform] = jmethod['linkName']
-                vmi.plat_index[platform] = jmethod['index']
+            ci.fields.append(fi)
 
-                ci.vtable.append(vmi)
+        method_map: dict[str, VirtualMethodInfo] = {}
+        method_overload_names: set[str] = set()
 
-                if vmi.name in method_map:
-                    method_overload_names.add(vmi.name)
-                
-                method_map[vmi.name] = vmi
+        if 'slots' in jclass:
+            # Complete vtable resolved by the exporter: the class owns the slots it introduced
+            ci.has_resolved_vtable = True
+            jmethods = [i for i in jclass['slots'] if i['introducedBy'] == class_name]
+        else:
+            jmethods = jclass['vtable']
 
-            # Remove overloads (not supported)
-            for i in method_overload_names:
-                log_warn(f'Removing overload {class_name}::{i}')
-                ci.vtable.remove(method_map[i])
+        for jmethod in jmethods:
+            vmi = VirtualMethodInfo()
+            vmi.name = jmethod['name']
 
-            result[class_name] = ci
+            vmi.plat_link_name[platform] = jmethod['linkName']
+            vmi.plat_index[platform] = jmethod['index']
 
-        # Check that all base classes were exported
-        for class_name, ci in result.items():
-            if ci.base_class_name is None:
-                continue
-            if ci.base_class_name not in result:
-                log_warn(f'Base class {ci.base_class_name} of {class_name} was not exported')
-
-        # Remove virtual methods that exist in base
-        for class_name, ci in result.items():
-            def find_method_in_base(name: str, index: int) -> str | None:
-                cur_class = ci.base_class_name
-
-                while cur_class is not None:
-                    base_ci = result[cur_class]
-                    for i in base_ci.vtable:
-                        if i.plat_index[platform] == index and i.name == name:
-                            return cur_class
-                    cur_class = base_ci.base_class_name
-                return None
+            ci.vtable.append(vmi)
+
+            if vmi.name in method_map:
+                method_overload_names.add(vmi.name)
             
-            for i in range(len(ci.vtable) - 1, -1, -1):
-                vmi = ci.vtable[i]
-                vmi_in_base_name = find_method_in_base(vmi.name, vmi.plat_index[platform])
+            method_map[vmi.name] = vmi
+
+        # Remove overloads (not supported)
+        for i in method_overload_names:
+            log_warn(f'Removing overload {class_name}::{i}')
+            ci.vtable.remove(method_map[i])
+
+        result[class_name] = ci
+
+    # Check that all base classes were exported
+    for class_name, ci in result.items():
+        if ci.base_class_name is None:
+            continue
+        if ci.base_class_name not in result:
+            log_warn(f'Base class {ci.base_class_name} of {class_name} was not exported')
+
+    # Remove virtual methods that exist in base
+    for class_name, ci in result.items():
+        if ci.has_resolved_vtable:
+            continue
+
+        def find_method_in_base(name: str, index: int) -> str | None:
+            cur_class = ci.base_class_name
+
+            while cur_class is not None:
+                base_ci = result[cur_class]
+                for i in base_ci.vtable:
+                    if i.plat_index[platform] == index and i.name == name:
+                        return cur_class
+                cur_class = base_ci.base_class_name
+            return None
+        
+        for i in range(len(ci.vtable) - 1, -1, -1):
+            vmi = ci.vtable[i]
+            vmi_in_base_name = find_method_in_base(vmi.name, vmi.plat_index[platform])
 
-                if vmi_in_base_name is not None:
-                    # log_note(f'Removed virtual method {class_name} :: {vmi.name} that exists in base {vmi_in_base_name}')
-                    ci.vtable.pop(i)
+            if vmi_in_base_name is not None:
+                # log_note(f'Removed virtual method {class_name} :: {vmi.name} that exists in base {vmi_in_base_name}')
+                ci.vtable.pop(i)
 
-        return result
+    return result
 
 def combine_files(files: dict[EPlatform, dict[str, ClassInfo]]) -> dict[str, ClassInfo]:
     result: dict[str, ClassInfo] = {}
@@ -460,4 +498,5 @@ def main():
     print(f'==== Creating gamedata in {args.out}')
     create_gamedata(classes, Path(args.out), args.banner, args.file_prefix)
 
-main()
+if __name__ == '__main__':
+    main()
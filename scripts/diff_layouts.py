@@ -0,0 +1,194 @@
+import argparse
+import json
+import sys
+from pathlib import Path
+
+from create_amxx_files import read_classes
+
+# Exit codes, like diff(1)
+EXIT_SAME = 0
+EXIT_DIFFERENT = 1
+
+FNV_OFFSET = 14695981039346656037
+FNV_PRIME = 1099511628211
+NULL_TOKEN = '\x01'
+
+def layout_hash(jclass: dict) -> str:
+    """Same as LayoutModel::GetLayoutHash: FNV-1a 64 over NUL-terminated tokens, null is the token "\\x01"."""
+    h = FNV_OFFSET
+
+    def add(token):
+        nonlocal h
+        if token is None:
+            token = NULL_TOKEN
+        elif isinstance(token, int):
+            token = str(token)
+
+        for b in token.encode('utf-8') + b'\0':
+            h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFFFFFFFFFF
+
+    add(jclass['baseClass'])
+
+    for jfield in jclass['fields']:
+        add('field')
+        add(jfield['name'])
+        add(jfield['offset'])
+        add(jfield['arraySize'])
+        add(jfield['type'])
+        add(jfield['amxxType'])
+        add({ False: 'signed', True: 'unsigned', None: None }[jfield['unsigned']])
+
+    if 'slots' in jclass:
+        for jslot in jclass['slots']:
+            add('slot')
+            add(jslot['index'])
+            add(jslot['name'])
+            add(jslot['linkName'])
+            add(jslot['introducedBy'])
+            add(jslot['overriddenBy'])
+    else:
+        for jmethod in jclass.get('vtable', []):
+            add('vm')
+            add(jmethod['name'])
+            add(jmethod['linkName'])
+            add(jmethod['index'])
+
+    return f'{h:016x}'
+
+def get_hash(jclass: dict) -> str:
+    # Output of older exporters has no hash
+    return jclass.get('layoutHash') or layout_hash(jclass)
+
+def key_members(members: list[dict], key) -> dict:
+    """Keys members by key(member). Repeated keys (overloads, anonymous members) get an occurrence number."""
+    result = {}
+    counts: dict = {}
+
+    for member in members:
+        k = key(member)
+        n = counts.get(k, 0)
+        counts[k] = n + 1
+        result[(k, n)] = member
+
+    return result
+
+def field_type(jfield: dict) -> dict:
+    return { k: jfield[k] for k in ('type', 'amxxType', 'arraySize', 'unsigned') }
+
+def diff_fields(old: list[dict], new: list[dict]) -> dict:
+    old_fields = key_members(old, lambda i: i['name'])
+    new_fields = key_members(new, lambda i: i['name'])
+    result = { 'moved': [], 'retyped': [], 'added': [], 'removed': [] }
+
+    for k, jfield in old_fields.items():
+        if k not in new_fields:
+            result['removed'].append({ 'name': jfield['name'], 'offset': jfield['offset'] })
+            continue
+
+        jnew = new_fields[k]
+
+        if jfield['offset'] != jnew['offset']:
+            result['moved'].append({ 'name': jfield['name'], 'old': jfield['offset'], 'new': jnew['offset'] })
+
+        if field_type(jfield) != field_type(jnew):
+            result['retyped'].append({ 'name': jfield['name'], 'old': field_type(jfield), 'new': field_type(jnew) })
+
+    for k, jfield in new_fields.items():
+        if k not in old_fields:
+            result['added'].append({ 'name': jfield['name'], 'offset': jfield['offset'] })
+
+    return { k: v for k, v in result.items() if v }
+
+def get_methods(jclass: dict) -> list[dict]:
+    # Complete vtable if the exporter resolved it
+    return jclass['slots'] if 'slots' in jclass else jclass.get('vtable', [])
+
+def diff_vtable(old: list[dict], new: list[dict]) -> dict:
+    # Link names tell overloads apart where available
+    old_methods = key_members(old, lambda i: i['linkName'] or i['name'])
+    new_methods = key_members(new, lambda i: i['linkName'] or i['name'])
+    result = { 'shifted': [], 'added': [], 'removed': [] }
+
+    for k, jmethod in old_methods.items():
+        if k not in new_methods:
+            result['removed'].append({ 'name': jmethod['name'], 'linkName': jmethod['linkName'], 'index': jmethod['index'] })
+        elif jmethod['index'] != new_methods[k]['index']:
+            result['shifted'].append({ 'name': jmethod['name'], 'linkName': jmethod['linkName'], 'old': jmethod['index'], 'new': new_methods[k]['index'] })
+
+    for k, jmethod in new_methods.items():
+        if k not in old_methods:
+            result['added'].append({ 'name': jmethod['name'], 'linkName': jmethod['linkName'], 'index': jmethod['index'] })
+
+    return { k: v for k, v in result.items() if v }
+
+def diff_class(old: dict, new: dict) -> dict:
+    result = {}
+
+    if old['baseClass'] != new['baseClass']:
+        result['baseClass'] = { 'old': old['baseClass'], 'new': new['baseClass'] }
+
+    fields = diff_fields(old['fields'], new['fields'])
+    if fields:
+        result['fields'] = fields
+
+    vtable = diff_vtable(get_methods(old), get_methods(new))
+    if vtable:
+        result['vtable'] = vtable
+
+    return result
+
+def diff_layouts(old_classes: dict, new_classes: dict) -> dict:
+    result = {
+        'unchanged': 0,
+        'added': sorted(i for i in new_classes if i not in old_classes),
+        'removed': sorted(i for i in old_classes if i not in new_classes),
+        'changed': {},
+    }
+
+    for class_name, jold in old_classes.items():
+        jnew = new_classes.get(class_name)
+
+        if jnew is None:
+            continue
+
+        # Equal hashes mean equal layouts, most classes don't change between builds
+        if get_hash(jold) == get_hash(jnew):
+            result['unchanged'] += 1
+            continue
+
+        changes = diff_class(jold, jnew)
+
+        # Changes that don't move anything, e.g. which class last overrides a slot, are not reported
+        if changes:
+            result['changed'][class_name] = changes
+        else:
+            result['unchanged'] += 1
+
+    return result
+
+def main():
+    parser = argparse.ArgumentParser(description='Compares the layouts of two exporter outputs (json, ndjson or --out-dir). '
+        'Exits with 0 if they are the same and 1 if they differ.')
+    parser.add_argument('old', help='Output of the old build')
+    parser.add_argument('new', help='Output of the new build')
+    parser.add_argument('--out', help='Write the JSON diff to this file instead of stdout')
+
+    args = parser.parse_args()
+
+    result = diff_layouts(read_classes(Path(args.old)), read_classes(Path(args.new)))
+    text = json.dumps(result, indent=2) + '\n'
+
+    if args.out is not None:
+        with open(args.out, 'w') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+    print(f'{len(result["changed"])} changed, {len(result["added"])} added, {len(result["removed"])} removed, '
+        f'{result["unchanged"]} unchanged', file=sys.stderr)
+
+    is_same = not result['changed'] and not result['added'] and not result['removed']
+    sys.exit(EXIT_SAME if is_same else EXIT_DIFFERENT)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,118 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "AllocationStats.h"
+
+#ifdef OFFSET_EXPORTER_COUNT_ALLOCATIONS
+
+namespace
+{
+
+std::atomic<uint64_t> g_AllocationCount = 0;
+std::atomic<uint64_t> g_AllocationBytes = 0;
+
+void* CountedAlloc(size_t size)
+{
+    g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    g_AllocationBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size != 0 ? size : 1);
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    void* ptr = CountedAlloc(size);
+
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+bool AllocationStats::IsCounting()
+{
+    return true;
+}
+
+AllocationStats AllocationStats::Get()
+{
+    return AllocationStats { g_AllocationCount.load(std::memory_order_relaxed), g_AllocationBytes.load(std::memory_order_relaxed) };
+}
+
+#else
+
+bool AllocationStats::IsCounting()
+{
+    return false;
+}
+
+AllocationStats AllocationStats::Get()
+{
+    return AllocationStats {};
+}
+
+#endif
+
+size_t AllocationStats::GetPeakMemoryUsage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    // Kilobytes on Linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
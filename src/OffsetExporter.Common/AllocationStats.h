@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//! Counters of the replaced global operator new. Only built with OFFSET_EXPORTER_COUNT_ALLOCATIONS, which
+//! replaces operator new/delete with versions that count calls; the cost is one relaxed atomic add per allocation.
+struct AllocationStats
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+
+    //! Returns false if the build doesn't count allocations.
+    static bool IsCounting();
+
+    //! Returns the counters since process start, 0 if not counting.
+    static AllocationStats Get();
+
+    //! Returns the peak resident set size of the process in bytes, or 0 if unsupported.
+    static size_t GetPeakMemoryUsage();
+
+    AllocationStats operator-(const AllocationStats& other) const
+    {
+        return AllocationStats { count - other.count, bytes - other.bytes };
+    }
+};
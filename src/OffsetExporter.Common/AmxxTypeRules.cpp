@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fmt/format.h>
+#include "AmxxTypeRules.h"
+
+namespace
+{
+
+bool ParseKind(std::string_view name, AmxxTypeRules::Kind& kind)
+{
+    using Kind = AmxxTypeRules::Kind;
+
+    if (name == "type")
+        kind = Kind::Type;
+    else if (name == "typedef")
+        kind = Kind::Typedef;
+    else if (name == "pointee")
+        kind = Kind::Pointee;
+    else if (name == "pointee-typedef")
+        kind = Kind::PointeeTypedef;
+    else if (name == "field")
+        kind = Kind::Field;
+    else
+        return false;
+
+    return true;
+}
+
+//! Splits on spaces and tabs. Returns the number of tokens, up to tokens.size() + 1.
+size_t Tokenize(std::string_view line, std::array<std::string_view, 4>& tokens)
+{
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (true)
+    {
+        pos = line.find_first_not_of(" \t\r", pos);
+
+        if (pos == std::string_view::npos)
+            return count;
+
+        size_t end = std::min(line.find_first_of(" \t\r", pos), line.size());
+
+        if (count == tokens.size())
+            return count + 1;
+
+        tokens[count++] = line.substr(pos, end - pos);
+        pos = end;
+    }
+}
+
+} // namespace
+
+AmxxTypeRules::AmxxTypeRules()
+    : AmxxTypeRules(Parse(DEFAULT_RULES, "built-in rules"))
+{
+}
+
+AmxxTypeRules AmxxTypeRules::Parse(std::string_view text, std::string_view sourceName)
+{
+    AmxxTypeRules rules(nullptr);
+    size_t lineNumber = 0;
+
+    while (!text.empty())
+    {
+        size_t lineEnd = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, lineEnd);
+        text.remove_prefix(std::min(lineEnd + 1, text.size()));
+        lineNumber++;
+
+        line = line.substr(0, std::min(line.find('#'), line.size()));
+
+        std::array<std::string_view, 4> tokens;
+        size_t tokenCount = Tokenize(line, tokens);
+
+        if (tokenCount == 0)
+            continue;
+
+        auto fail = [&](std::string_view message) {
+            return std::runtime_error(fmt::format("{}:{}: {}", sourceName, lineNumber, message));
+        };
+
+        Kind kind;
+        if (!ParseKind(tokens[0], kind))
+            throw fail(fmt::format("unknown rule kind '{}'", tokens[0]));
+
+        const size_t expectedCount = kind == Kind::Field ? 4 : 3;
+        if (tokenCount != expectedCount)
+            throw fail(fmt::format("'{}' expects {} arguments", tokens[0], expectedCount - 1));
+
+        if (tokens[1] == "*")
+            throw fail("empty prefix");
+
+        Result result;
+        result.amxxType = rules.m_strings.Add(tokens[expectedCount - 1]);
+
+        if (kind == Kind::Field)
+            result.ifAmxxType = rules.m_strings.Add(tokens[2]);
+
+        rules.AddRule(kind, tokens[1], result);
+    }
+
+    return rules;
+}
+
+AmxxTypeRules AmxxTypeRules::LoadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+
+    if (!file)
+        throw std::runtime_error(fmt::format("Failed to open rules file {}", path));
+
+    std::stringstream text;
+    text << file.rdbuf();
+    return Parse(text.str(), path);
+}
+
+std::string_view AmxxTypeRules::Match(Kind kind, std::string_view name) const
+{
+    const Result* result = Find(kind, name);
+    return result ? m_strings.Get(result->amxxType) : std::string_view();
+}
+
+std::string_view AmxxTypeRules::MatchField(std::string_view fieldName, std::string_view amxxType) const
+{
+    const Result* result = Find(Kind::Field, fieldName);
+
+    if (!result || m_strings.Get(result->ifAmxxType) != amxxType)
+        return std::string_view();
+
+    return m_strings.Get(result->amxxType);
+}
+
+void AmxxTypeRules::AddRule(Kind kind, std::string_view pattern, Result result)
+{
+    Table& table = m_tables[static_cast<size_t>(kind)];
+
+    if (pattern.ends_with('*'))
+        table.prefixes.Add(pattern.substr(0, pattern.size() - 1), result);
+    else
+        table.exact.insert_or_assign(m_strings.Get(m_strings.Add(pattern)), result);
+
+    m_ruleCount++;
+}
+
+const AmxxTypeRules::Result* AmxxTypeRules::Find(Kind kind, std::string_view name) const
+{
+    const Table& table = m_tables[static_cast<size_t>(kind)];
+
+    if (!table.exact.empty())
+    {
+        auto it = table.exact.find(name);
+
+        if (it != table.exact.end())
+            return &it->second;
+    }
+
+    return table.prefixes.FindLongest(name);
+}
+
+void AmxxTypeRules::PrefixTrie::Add(std::string_view prefix, Result result)
+{
+    uint32_t node = 0;
+
+    for (char c : prefix)
+    {
+        uint64_t key = (static_cast<uint64_t>(node) << 8) | static_cast<uint8_t>(c);
+        auto [it, inserted] = edges.try_emplace(key, static_cast<uint32_t>(nodes.size()));
+
+        if (inserted)
+            nodes.emplace_back();
+
+        node = it->second;
+    }
+
+    nodes[node] = result;
+}
+
+const AmxxTypeRules::Result* AmxxTypeRules::PrefixTrie::FindLongest(std::string_view name) const
+{
+    if (edges.empty())
+        return nullptr;
+
+    const Result* longest = nullptr;
+    uint32_t node = 0;
+
+    for (char c : name)
+    {
+        auto it = edges.find((static_cast<uint64_t>(node) << 8) | static_cast<uint8_t>(c));
+
+        if (it == edges.end())
+            break;
+
+        node = it->second;
+
+        if (nodes[node].amxxType != StringPool::NONE)
+            longest = &nodes[node];
+    }
+
+    return longest;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "AmxxDefaultRules.h"
+#include "StringPool.h"
+
+//! Name-based rules that turn a C type into an amxxType, shared by both exporters.
+//!
+//! A rules file has one rule per line, `#` starts a comment:
+//!   type            <name>  <amxxType>            class or struct by value
+//!   typedef         <name>  <amxxType>            typedef by value (DWARF only, PDBs have no typedefs)
+//!   pointee         <name>  <amxxType>            pointer or reference to a class or struct
+//!   pointee-typedef <name>  <amxxType>            pointer or reference to a typedef (DWARF only)
+//!   field           <name>  <if> <amxxType>       field whose type was mapped to <if>. Only used where typedefs
+//!                                                 are missing (PDB), e.g. to find string_t by name
+//! A name ending in `*` is a prefix. Exact names win over prefixes, longer prefixes over shorter ones.
+//!
+//! Rules are compiled into a hash table of exact names and a prefix trie per kind,
+//! so a lookup costs one hash probe plus one trie step per character of the name.
+class AmxxTypeRules
+{
+public:
+    enum class Kind
+    {
+        Type,
+        Typedef,
+        Pointee,
+        PointeeTypedef,
+        Field,
+        Count,
+    };
+
+    //! Rules from DEFAULT_RULES.
+    AmxxTypeRules();
+    AmxxTypeRules(AmxxTypeRules&&) = default;
+    AmxxTypeRules& operator=(AmxxTypeRules&&) = default;
+
+    //! Throws std::runtime_error with the line number if the text is invalid.
+    static AmxxTypeRules Parse(std::string_view text, std::string_view sourceName);
+
+    //! Reads and parses a rules file.
+    static AmxxTypeRules LoadFile(const std::string& path);
+
+    //! Returns the amxxType for a type name or an empty view if no rule matches.
+    std::string_view Match(Kind kind, std::string_view name) const;
+
+    //! Returns the amxxType for a field whose type was mapped to amxxType or an empty view.
+    std::string_view MatchField(std::string_view fieldName, std::string_view amxxType) const;
+
+    size_t GetRuleCount() const { return m_ruleCount; }
+
+    //! test-data/amxx-type-rules.txt, compiled in by CMake.
+    static constexpr std::string_view DEFAULT_RULES = AMXX_DEFAULT_TYPE_RULES;
+
+private:
+    struct Result
+    {
+        StringPool::Id amxxType = StringPool::NONE;
+        StringPool::Id ifAmxxType = StringPool::NONE; //!< field rules only
+    };
+
+    //! Trie edges of all nodes in one table, keyed by (node << 8) | character.
+    struct PrefixTrie
+    {
+        std::unordered_map<uint64_t, uint32_t> edges;
+        std::vector<Result> nodes = { Result() }; //!< node 0 is the root
+
+        void Add(std::string_view prefix, Result result);
+        const Result* FindLongest(std::string_view name) const;
+    };
+
+    struct Table
+    {
+        std::unordered_map<std::string_view, Result> exact;
+        PrefixTrie prefixes;
+    };
+
+    StringPool m_strings;
+    std::array<Table, static_cast<size_t>(Kind::Count)> m_tables;
+    size_t m_ruleCount = 0;
+
+    explicit AmxxTypeRules(std::nullptr_t) {}
+
+    void AddRule(Kind kind, std::string_view pattern, Result result);
+    const Result* Find(Kind kind, std::string_view name) const;
+};
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <fmt/format.h>
+#include "ClassList.h"
+
+namespace
+{
+
+//! Finalizer of MurmurHash3.
+uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+//! Large buckets should find free slots within a few hundred tries. This only guards against a broken hash.
+constexpr int32_t MAX_DISPLACEMENT = 1 << 24;
+
+} // namespace
+
+ClassList ClassList::LoadFile(const std::string& path)
+{
+    std::ifstream file(path);
+
+    if (!file)
+        throw std::runtime_error(fmt::format("Failed to open class list {}", path));
+
+    std::vector<std::string> lines;
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (!line.empty())
+            lines.push_back(std::move(line));
+    }
+
+    ClassList classList;
+    classList.Build(std::vector<std::string_view>(lines.begin(), lines.end()));
+    return classList;
+}
+
+void ClassList::Build(const std::vector<std::string_view>& names)
+{
+    m_names.clear();
+    m_slots.clear();
+    m_displacements.clear();
+    m_lengths.reset();
+    m_firstBytes.reset();
+
+    std::vector<std::string_view> unique;
+    std::unordered_set<std::string_view> seen;
+
+    for (std::string_view name : names)
+    {
+        if (!name.empty() && seen.insert(name).second)
+            unique.push_back(name);
+    }
+
+    const size_t count = unique.size();
+    if (count == 0)
+        return;
+
+    std::vector<uint64_t> hashes(count);
+    std::vector<std::vector<uint32_t>> buckets(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        hashes[i] = HashName(unique[i]);
+        buckets[hashes[i] % count].push_back(i);
+    }
+
+    // Place the largest buckets first while most slots are still free
+    std::vector<uint32_t> bucketOrder(count);
+    for (uint32_t i = 0; i < count; i++)
+        bucketOrder[i] = i;
+
+    std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    constexpr uint32_t FREE = UINT32_MAX;
+    std::vector<uint32_t> slotNames(count, FREE);
+    std::vector<size_t> candidateSlots;
+    m_displacements.assign(count, 0);
+    size_t nextFreeSlot = 0;
+
+    for (uint32_t bucket : bucketOrder)
+    {
+        const std::vector<uint32_t>& bucketNames = buckets[bucket];
+
+        if (bucketNames.empty())
+            break;
+
+        if (bucketNames.size() == 1)
+        {
+            // No need to search, any free slot will do
+            while (slotNames[nextFreeSlot] != FREE)
+                nextFreeSlot++;
+
+            slotNames[nextFreeSlot] = bucketNames[0];
+            m_displacements[bucket] = -static_cast<int32_t>(nextFreeSlot) - 1;
+            continue;
+        }
+
+        for (int32_t displacement = 1;; displacement++)
+        {
+            if (displacement == MAX_DISPLACEMENT)
+                throw std::logic_error("Failed to build the class list hash");
+
+            candidateSlots.clear();
+
+            for (uint32_t name : bucketNames)
+            {
+                size_t slot = GetSlot(hashes[name], displacement, count);
+
+                if (slotNames[slot] != FREE || std::find(candidateSlots.begin(), candidateSlots.end(), slot) != candidateSlots.end())
+                    break;
+
+                candidateSlots.push_back(slot);
+            }
+
+            if (candidateSlots.size() != bucketNames.size())
+                continue;
+
+            for (size_t i = 0; i < bucketNames.size(); i++)
+                slotNames[candidateSlots[i]] = bucketNames[i];
+
+            m_displacements[bucket] = displacement;
+            break;
+        }
+    }
+
+    m_slots.resize(count);
+
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        std::string_view name = unique[slotNames[slot]];
+        m_slots[slot] = Slot { static_cast<uint32_t>(m_names.size()), static_cast<uint32_t>(name.size()), LoadPrefix(name) };
+        m_names.append(name);
+        m_lengths.set(std::min<size_t>(name.size(), 255));
+        m_firstBytes.set(GetFirstBytesKey(name));
+    }
+}
+
+bool ClassList::Contains(std::string_view name) const
+{
+    if (name.empty() || m_slots.empty())
+        return false;
+
+    if (!m_lengths.test(std::min<size_t>(name.size(), 255)) || !m_firstBytes.test(GetFirstBytesKey(name)))
+        return false;
+
+    const uint64_t hash = HashName(name);
+    const Slot& slot = m_slots[GetSlot(hash, m_displacements[hash % m_slots.size()], m_slots.size())];
+
+    return slot.length == name.size() && slot.prefix == LoadPrefix(name) &&
+        std::memcmp(m_names.data() + slot.offset, name.data(), name.size()) == 0;
+}
+
+uint64_t ClassList::HashName(std::string_view name)
+{
+    // FNV-1a, mixed so that the low bits used for the bucket are good
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char c : name)
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+
+    return Mix(hash);
+}
+
+uint64_t ClassList::LoadPrefix(std::string_view name)
+{
+    uint64_t prefix = 0;
+    std::memcpy(&prefix, name.data(), std::min<size_t>(name.size(), sizeof(prefix)));
+    return prefix;
+}
+
+uint32_t ClassList::GetFirstBytesKey(std::string_view name)
+{
+    uint32_t key = static_cast<uint8_t>(name[0]) << 8;
+
+    if (name.size() > 1)
+        key |= static_cast<uint8_t>(name[1]);
+
+    return key;
+}
+
+size_t ClassList::GetSlot(uint64_t hash, int32_t displacement, size_t count)
+{
+    if (displacement < 0)
+        return static_cast<size_t>(-(displacement + 1));
+
+    return Mix(hash ^ (static_cast<uint64_t>(displacement) * 0x9e3779b97f4a7c15ull)) % count;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Set of class names to export, compiled into a minimal perfect hash.
+//!
+//! Both exporters test every class record of the input against the list, and most of them are not
+//! in it. A lookup first rejects names by length and first two bytes using bitmaps of the list.
+//! Names that pass are hashed once; the hash selects a displacement that gives the only slot the
+//! name can be in, which is confirmed by length, the first 8 bytes and finally a memcmp.
+class ClassList
+{
+public:
+    //! One class name per line. Empty lines and trailing CRs are ignored.
+    //! Throws std::runtime_error if the file can't be read.
+    static ClassList LoadFile(const std::string& path);
+
+    //! Builds the hash. Duplicates are ignored.
+    void Build(const std::vector<std::string_view>& names);
+
+    bool Contains(std::string_view name) const;
+
+    size_t GetCount() const { return m_slots.size(); }
+    std::string_view GetName(size_t i) const { return std::string_view(m_names.data() + m_slots[i].offset, m_slots[i].length); }
+
+private:
+    struct Slot
+    {
+        uint32_t offset;
+        uint32_t length;
+        uint64_t prefix; //!< first 8 bytes, zero-padded
+    };
+
+    std::string m_names;
+    std::vector<Slot> m_slots;
+
+    //! Per hash bucket: >0 is the displacement to rehash with, <0 is -(slot + 1) for single-name buckets.
+    std::vector<int32_t> m_displacements;
+
+    std::bitset<256> m_lengths;       //!< lengths of the names, clamped to 255
+    std::bitset<65536> m_firstBytes;  //!< first two bytes of the names
+
+    static uint64_t HashName(std::string_view name);
+    static uint64_t LoadPrefix(std::string_view name);
+    static uint32_t GetFirstBytesKey(std::string_view name);
+    static size_t GetSlot(uint64_t hash, int32_t displacement, size_t count);
+};
@@ -0,0 +1,93 @@
+#include <stdexcept>
+#include <string>
+#include "AllocationStats.h"
+#include "Declarator.h"
+#include "Stopwatch.h"
+
+namespace
+{
+
+constexpr int ITERATIONS = 100000;
+
+//! The way both exporters used to build names: one fmt::format per level.
+std::string FormatChain(std::string_view name, int depth)
+{
+    if (depth == 0)
+        return fmt::format("{} {}", "CBaseEntity", name);
+
+    switch (depth % 3)
+    {
+    case 0: return FormatChain(fmt::format("*{}", name), depth - 1);
+    case 1: return FormatChain(fmt::format("const {}", name), depth - 1);
+    default: return FormatChain(fmt::format("{}[{}]", name, depth), depth - 1);
+    }
+}
+
+void BuildChain(Declarator& decl, int depth)
+{
+    for (; depth > 0; depth--)
+    {
+        switch (depth % 3)
+        {
+        case 0: decl.Prepend("*"); break;
+        case 1: decl.Prepend("const "); break;
+        default: decl.AppendFormat("[{}]", depth); break;
+        }
+    }
+
+    decl.Prepend(" ");
+    decl.Prepend("CBaseEntity");
+}
+
+} // namespace
+
+void RunDeclaratorBenchmark()
+{
+    fmt::println("Type name benchmark ({} iterations)", ITERATIONS);
+    fmt::println("{:<6} {:>12} {:>14} {:>12} {:>16}", "depth", "format ns", "format allocs", "renderer ns", "renderer allocs");
+
+    fmt::memory_buffer out;
+    size_t checksum = 0;
+
+    for (int depth : { 1, 4, 16, 64 })
+    {
+        // Both must render the same declaration
+        Declarator check("m_pEntity");
+        BuildChain(check, depth);
+        out.clear();
+        check.WriteTo(out);
+
+        if (std::string_view(out.data(), out.size()) != FormatChain("m_pEntity", depth))
+            throw std::logic_error("Declarator output differs from fmt::format");
+
+        AllocationStats allocsBefore = AllocationStats::Get();
+        Stopwatch timer;
+
+        for (int i = 0; i < ITERATIONS; i++)
+            checksum += FormatChain("m_pEntity", depth).size();
+
+        double formatNs = timer.ElapsedMs() * 1e6 / ITERATIONS;
+        AllocationStats formatAllocs = AllocationStats::Get() - allocsBefore;
+
+        allocsBefore = AllocationStats::Get();
+        timer.Restart();
+
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            Declarator decl("m_pEntity");
+            BuildChain(decl, depth);
+            out.clear();
+            decl.WriteTo(out);
+            checksum += out.size();
+        }
+
+        double rendererNs = timer.ElapsedMs() * 1e6 / ITERATIONS;
+        AllocationStats rendererAllocs = AllocationStats::Get() - allocsBefore;
+
+        fmt::println("{:<6} {:>12.1f} {:>14.2f} {:>12.1f} {:>16.2f}",
+            depth, formatNs, static_cast<double>(formatAllocs.count) / ITERATIONS,
+            rendererNs, static_cast<double>(rendererAllocs.count) / ITERATIONS);
+    }
+
+    fmt::println("checksum: {}", checksum);
+}
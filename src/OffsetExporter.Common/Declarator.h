@@ -0,0 +1,67 @@
+#pragma once
+#include <iterator>
+#include <string_view>
+#include <fmt/format.h>
+
+//! Builds a C declaration such as "const char *m_szNames[4][32]" from the inside out.
+//!
+//! Debug info describes a declarator starting at the name: every pointer, modifier or array level
+//! adds text before or after everything built so far. Instead of formatting a new string per level,
+//! text before is stored reversed, so prepending is an append too, and the declaration is assembled
+//! once in WriteTo. Both buffers have inline storage, so typical declarations don't allocate.
+class Declarator
+{
+public:
+    explicit Declarator(std::string_view name = {})
+    {
+        Reset(name);
+    }
+
+    //! Discards everything and starts again from name.
+    void Reset(std::string_view name)
+    {
+        m_reversedPrefix.clear();
+        m_suffix.clear();
+        m_suffix.append(name.data(), name.data() + name.size());
+    }
+
+    bool IsEmpty() const
+    {
+        return m_reversedPrefix.size() == 0 && m_suffix.size() == 0;
+    }
+
+    //! Adds text before the declarator, e.g. "*" or "const ".
+    void Prepend(std::string_view text)
+    {
+        for (size_t i = text.size(); i-- > 0;)
+            m_reversedPrefix.push_back(text[i]);
+    }
+
+    //! Adds text after the declarator, e.g. "[5]".
+    void Append(std::string_view text)
+    {
+        m_suffix.append(text.data(), text.data() + text.size());
+    }
+
+    template <typename... T>
+    void AppendFormat(fmt::format_string<T...> format, T&&... args)
+    {
+        fmt::format_to(std::back_inserter(m_suffix), format, std::forward<T>(args)...);
+    }
+
+    //! Appends the declaration to out.
+    void WriteTo(fmt::memory_buffer& out) const
+    {
+        for (size_t i = m_reversedPrefix.size(); i-- > 0;)
+            out.push_back(m_reversedPrefix[i]);
+
+        out.append(m_suffix.data(), m_suffix.data() + m_suffix.size());
+    }
+
+private:
+    fmt::basic_memory_buffer<char, 128> m_reversedPrefix;
+    fmt::basic_memory_buffer<char, 128> m_suffix;
+};
+
+//! Compares Declarator to formatting a new string per level on synthetic declarator chains.
+void RunDeclaratorBenchmark();
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "ElfImage.h"
+
+namespace
+{
+
+constexpr uint8_t ELF_MAGIC[] = { 0x7F, 'E', 'L', 'F' };
+constexpr uint8_t ELFCLASS32 = 1;
+constexpr uint8_t ELFCLASS64 = 2;
+constexpr uint8_t ELFDATA2LSB = 1;
+constexpr size_t EI_CLASS = 4;
+constexpr size_t EI_DATA = 5;
+constexpr uint16_t SHN_XINDEX = 0xFFFF;
+constexpr uint32_t NT_GNU_BUILD_ID = 3;
+
+} // namespace
+
+ElfImage::ElfImage(const void* data, size_t size)
+    : m_data(static_cast<const uint8_t*>(data))
+    , m_size(size)
+{
+    if (!IsElf(data, size) || size < 0x34)
+        throw std::runtime_error("not an ELF file");
+
+    if (m_data[EI_DATA] != ELFDATA2LSB)
+        throw std::runtime_error("big-endian ELF files are not supported");
+
+    uint64_t shoff;
+    uint16_t shentsize;
+    uint32_t shnum;
+    uint32_t shstrndx;
+
+    switch (m_data[EI_CLASS])
+    {
+    case ELFCLASS32:
+        m_is64Bit = false;
+        shoff = Read<uint32_t>(32);
+        shentsize = Read<uint16_t>(46);
+        shnum = Read<uint16_t>(48);
+        shstrndx = Read<uint16_t>(50);
+        break;
+    case ELFCLASS64:
+        m_is64Bit = true;
+        shoff = Read<uint64_t>(40);
+        shentsize = Read<uint16_t>(58);
+        shnum = Read<uint16_t>(60);
+        shstrndx = Read<uint16_t>(62);
+        break;
+    default:
+        throw std::runtime_error("unknown ELF class");
+    }
+
+    if (shoff == 0)
+        return;
+
+    if (shentsize < (m_is64Bit ? 64 : 40))
+        throw std::runtime_error("ELF section header size invalid");
+
+    // More than SHN_LORESERVE sections: real counts are stored in the null section
+    uint32_t nameOffset;
+    Section nullSection = ReadSectionHeader(shoff, nameOffset);
+
+    if (shnum == 0)
+        shnum = static_cast<uint32_t>(nullSection.size);
+
+    if (shstrndx == SHN_XINDEX)
+        shstrndx = nullSection.link;
+
+    if (shoff + static_cast<uint64_t>(shnum) * shentsize > m_size)
+        throw std::runtime_error("ELF section headers out of bounds");
+
+    std::vector<uint32_t> nameOffsets(shnum);
+    m_sections.reserve(shnum);
+
+    for (uint32_t i = 0; i < shnum; i++)
+        m_sections.push_back(ReadSectionHeader(shoff + static_cast<uint64_t>(i) * shentsize, nameOffsets[i]));
+
+    if (shstrndx >= m_sections.size())
+        return;
+
+    std::string_view strtab = GetSectionData(m_sections[shstrndx]);
+
+    for (uint32_t i = 0; i < shnum; i++)
+    {
+        if (nameOffsets[i] >= strtab.size())
+            continue;
+
+        std::string_view name = strtab.substr(nameOffsets[i]);
+        m_sections[i].name = name.substr(0, name.find('\0'));
+    }
+}
+
+const ElfImage::Section* ElfImage::FindSection(std::string_view name) const
+{
+    for (const Section& section : m_sections)
+    {
+        if (section.name == name)
+            return &section;
+    }
+
+    return nullptr;
+}
+
+std::string_view ElfImage::GetSectionData(const Section& section) const
+{
+    if (section.type == SHT_NOBITS)
+        return {};
+
+    if (section.offset > m_size || section.size > m_size - section.offset)
+        throw std::runtime_error("ELF section out of bounds");
+
+    return std::string_view(reinterpret_cast<const char*>(m_data + section.offset), section.size);
+}
+
+std::string_view ElfImage::GetBuildId() const
+{
+    // Usually in .note.gnu.build-id, but linker scripts may merge notes into one section
+    for (const Section& section : m_sections)
+    {
+        if (section.type != SHT_NOTE)
+            continue;
+
+        std::string_view notes = GetSectionData(section);
+        size_t pos = 0;
+
+        // Elf32_Nhdr and Elf64_Nhdr are the same, name and descriptor are padded to 4 bytes
+        while (notes.size() - pos >= 12)
+        {
+            uint32_t nameSize, descSize, type;
+            std::memcpy(&nameSize, notes.data() + pos, 4);
+            std::memcpy(&descSize, notes.data() + pos + 4, 4);
+            std::memcpy(&type, notes.data() + pos + 8, 4);
+
+            uint64_t descOffset = pos + 12 + ((static_cast<uint64_t>(nameSize) + 3) & ~uint64_t(3));
+            uint64_t next = descOffset + ((static_cast<uint64_t>(descSize) + 3) & ~uint64_t(3));
+
+            if (descOffset + descSize > notes.size())
+                break;
+
+            if (type == NT_GNU_BUILD_ID && nameSize == 4 && notes.substr(pos + 12, 4) == std::string_view("GNU\0", 4))
+                return notes.substr(descOffset, descSize);
+
+            pos = static_cast<size_t>(std::min<uint64_t>(next, notes.size()));
+        }
+    }
+
+    return {};
+}
+
+bool ElfImage::IsElf(const void* data, size_t size)
+{
+    return size >= sizeof(ELF_MAGIC) && std::memcmp(data, ELF_MAGIC, sizeof(ELF_MAGIC)) == 0;
+}
+
+template <typename T>
+T ElfImage::Read(uint64_t offset) const
+{
+    if (offset > m_size || sizeof(T) > m_size - offset)
+        throw std::runtime_error("ELF read out of bounds");
+
+    T value;
+    std::memcpy(&value, m_data + offset, sizeof(T));
+    return value;
+}
+
+ElfImage::Section ElfImage::ReadSectionHeader(uint64_t offset, uint32_t& nameOffset) const
+{
+    Section section;
+    nameOffset = Read<uint32_t>(offset);
+    section.type = Read<uint32_t>(offset + 4);
+
+    if (m_is64Bit)
+    {
+        section.flags = Read<uint64_t>(offset + 8);
+        section.addr = Read<uint64_t>(offset + 16);
+        section.offset = Read<uint64_t>(offset + 24);
+        section.size = Read<uint64_t>(offset + 32);
+        section.link = Read<uint32_t>(offset + 40);
+        section.info = Read<uint32_t>(offset + 44);
+        section.addralign = Read<uint64_t>(offset + 48);
+        section.entsize = Read<uint64_t>(offset + 56);
+    }
+    else
+    {
+        section.flags = Read<uint32_t>(offset + 8);
+        section.addr = Read<uint32_t>(offset + 12);
+        section.offset = Read<uint32_t>(offset + 16);
+        section.size = Read<uint32_t>(offset + 20);
+        section.link = Read<uint32_t>(offset + 24);
+        section.info = Read<uint32_t>(offset + 28);
+        section.addralign = Read<uint32_t>(offset + 32);
+        section.entsize = Read<uint32_t>(offset + 36);
+    }
+
+    return section;
+}
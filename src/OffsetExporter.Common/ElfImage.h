@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//! Read-only view of the section headers of a little-endian ELF32/ELF64 file in memory.
+//! The memory must outlive the image.
+class ElfImage
+{
+public:
+    struct Section
+    {
+        std::string_view name;
+        uint32_t type = 0;
+        uint64_t flags = 0;
+        uint64_t addr = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t link = 0;
+        uint32_t info = 0;
+        uint64_t addralign = 0;
+        uint64_t entsize = 0;
+    };
+
+    //! Section type of sections that occupy no space in the file (.bss).
+    static constexpr uint32_t SHT_NOBITS = 8;
+
+    //! Section type of note sections.
+    static constexpr uint32_t SHT_NOTE = 7;
+
+    //! Parses the headers. Throws std::runtime_error if the file is not a supported ELF.
+    ElfImage(const void* data, size_t size);
+
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    bool Is64Bit() const { return m_is64Bit; }
+
+    //! Returns all sections including the null section at index 0.
+    const std::vector<Section>& GetSections() const { return m_sections; }
+
+    //! Returns the first section with the given name or nullptr.
+    const Section* FindSection(std::string_view name) const;
+
+    //! Returns the contents of a section. Empty for SHT_NOBITS sections.
+    //! Throws std::runtime_error if the section extends past the end of the file.
+    std::string_view GetSectionData(const Section& section) const;
+
+    //! Returns the descriptor of the NT_GNU_BUILD_ID note (usually 20 bytes of SHA-1) or an empty view if there is none.
+    std::string_view GetBuildId() const;
+
+    //! Checks whether the buffer starts with the ELF magic.
+    static bool IsElf(const void* data, size_t size);
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_is64Bit = false;
+    std::vector<Section> m_sections;
+
+    template <typename T>
+    T Read(uint64_t offset) const;
+
+    Section ReadSectionHeader(uint64_t offset, uint32_t& nameOffset) const;
+};
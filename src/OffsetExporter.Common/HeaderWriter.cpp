@@ -0,0 +1,214 @@
+#include <string>
+#include <unordered_set>
+#include <fmt/format.h>
+#include "HeaderWriter.h"
+
+namespace
+{
+
+constexpr std::string_view HEADER_PREAMBLE = R"(#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifndef AMXX_OFFSETS_COMMON
+#define AMXX_OFFSETS_COMMON
+
+struct edict_s;
+struct entvars_s;
+
+namespace amxx_offsets
+{
+
+//! Layout of Vector.
+struct Vector3
+{
+    float x, y, z;
+};
+
+//! Layout of EHANDLE.
+struct EHandle
+{
+    edict_s* edict;
+    int32_t serialNumber;
+};
+
+//! Member at a fixed offset whose type is not known.
+template <std::size_t Offset>
+struct Opaque
+{
+    static constexpr std::size_t offset = Offset;
+
+    static void* Address(void* self) { return static_cast<char*>(self) + Offset; }
+    static const void* Address(const void* self) { return static_cast<const char*>(self) + Offset; }
+};
+
+//! Member of type T (may be an array type) at a fixed offset.
+template <typename T, std::size_t Offset>
+struct Member : Opaque<Offset>
+{
+    using type = T;
+
+    static T& Get(void* self) { return *static_cast<T*>(Opaque<Offset>::Address(self)); }
+    static const T& Get(const void* self) { return *static_cast<const T*>(Opaque<Offset>::Address(self)); }
+};
+
+//! Vtable slot.
+template <int Index>
+struct VirtualMethod
+{
+    static constexpr int index = Index;
+
+    static void* Get(const void* self) { return (*static_cast<void* const* const*>(self))[Index]; }
+};
+
+} // namespace amxx_offsets
+
+#endif // AMXX_OFFSETS_COMMON
+)";
+
+//! Returns the C++ type for a field or an empty string if it should be opaque.
+std::string GetMemberType(std::string_view amxxType, LayoutModel::Signedness signedness, uint64_t arraySize)
+{
+    const bool isUnsigned = signedness == LayoutModel::Signedness::Unsigned;
+    std::string_view type;
+
+    if (amxxType == "character")
+        type = isUnsigned ? "uint8_t" : "int8_t";
+    else if (amxxType == "short")
+        type = isUnsigned ? "uint16_t" : "int16_t";
+    else if (amxxType == "integer")
+        type = isUnsigned ? "uint32_t" : "int32_t";
+    else if (amxxType == "long long")
+        type = isUnsigned ? "uint64_t" : "int64_t";
+    else if (amxxType == "float")
+        type = "float";
+    else if (amxxType == "double")
+        type = "double";
+    else if (amxxType == "stringint")
+        type = "int32_t";
+    else if (amxxType == "stringptr")
+        type = "const char*";
+    else if (amxxType == "string")
+        type = "char";
+    else if (amxxType == "entvars")
+        type = "entvars_s*";
+    else if (amxxType == "edict")
+        type = "edict_s*";
+    else if (amxxType == "classptr" || amxxType == "pointer")
+        type = "void*";
+    else if (amxxType == "vector")
+        type = "Vector3";
+    else if (amxxType == "ehandle")
+        type = "EHandle";
+    else
+        return {}; // function, structure: size and layout are compiler-specific
+
+    if (arraySize != LayoutModel::NO_ARRAY_SIZE)
+        return fmt::format("{}[{}]", type, arraySize);
+
+    return std::string(type);
+}
+
+//! Turns member and class names into identifiers. Destructors become "destructor".
+std::string MakeIdentifier(std::string_view name)
+{
+    if (name.starts_with('~'))
+        return "destructor";
+
+    std::string result;
+    result.reserve(name.size() + 1);
+
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+        result.push_back('_');
+
+    for (char c : name)
+    {
+        bool isIdentChar = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        result.push_back(isIdentChar ? c : '_');
+    }
+
+    return result;
+}
+
+//! Appends _1, _2, ... to names already used in the namespace (overloads).
+std::string MakeUnique(std::unordered_set<std::string>& used, std::string name)
+{
+    if (used.insert(name).second)
+        return name;
+
+    for (int i = 1;; i++)
+    {
+        std::string candidate = fmt::format("{}_{}", name, i);
+
+        if (used.insert(candidate).second)
+            return candidate;
+    }
+}
+
+} // namespace
+
+void WriteLayoutHeader(const LayoutModel& model, HeaderPlatform platform, std::string_view generator, std::ostream& out)
+{
+    fmt::memory_buffer buf;
+    auto it = std::back_inserter(buf);
+
+    fmt::format_to(it, "// Generated by {}. Do not edit.\n", generator);
+    fmt::format_to(it, "{}\n", HEADER_PREAMBLE);
+    fmt::format_to(it, "{}\n\n", platform == HeaderPlatform::Windows ? "#ifdef _WIN32" : "#ifndef _WIN32");
+
+    if (model.GetBinaryIdKind() != LayoutModel::BinaryIdKind::None)
+    {
+        fmt::format_to(it, "namespace amxx_offsets\n{{\n");
+        fmt::format_to(it, "    //! {} of the binary the offsets were taken from\n", LayoutModel::GetBinaryIdKindName(model.GetBinaryIdKind()));
+        fmt::format_to(it, "    inline constexpr char binaryId[] = \"{}\";\n", model.GetBinaryId());
+        fmt::format_to(it, "}}\n\n");
+    }
+
+    for (uint32_t cls = 0; cls < model.GetClassCount(); cls++)
+    {
+        // Fields share the class namespace with the vtable namespace
+        std::unordered_set<std::string> usedNames = { "vtable", "layoutHash" };
+        std::unordered_set<std::string> usedMethodNames;
+
+        fmt::format_to(it, "namespace amxx_offsets::{}\n{{\n", MakeIdentifier(model.GetString(model.GetClassName(cls))));
+        fmt::format_to(it, "    inline constexpr std::uint64_t layoutHash = 0x{:016x}ull;\n\n", model.GetLayoutHash(cls));
+
+        LayoutModel::Range fields = model.GetFields(cls);
+
+        for (uint32_t f = fields.begin; f < fields.end; f++)
+        {
+            if (model.IsNestedField(f))
+                continue;
+
+            std::string name = MakeUnique(usedNames, MakeIdentifier(model.GetString(model.GetFieldName(f))));
+            std::string type = GetMemberType(model.GetString(model.GetFieldAmxxType(f)), model.GetFieldSignedness(f), model.GetFieldArraySize(f));
+
+            if (type.empty())
+                fmt::format_to(it, "    using {} = Opaque<{}>;", name, model.GetFieldOffset(f));
+            else
+                fmt::format_to(it, "    using {} = Member<{}, {}>;", name, type, model.GetFieldOffset(f));
+
+            fmt::format_to(it, " // {}\n", model.GetString(model.GetFieldType(f)));
+        }
+
+        LayoutModel::Range vtable = model.GetVTable(cls);
+
+        if (vtable.begin != vtable.end)
+        {
+            fmt::format_to(it, "\n    namespace vtable\n    {{\n");
+
+            for (uint32_t m = vtable.begin; m < vtable.end; m++)
+            {
+                std::string name = MakeUnique(usedMethodNames, MakeIdentifier(model.GetString(model.GetVirtualMethodName(m))));
+                fmt::format_to(it, "        using {} = VirtualMethod<{}>;\n", name, model.GetVirtualMethodIndex(m));
+            }
+
+            fmt::format_to(it, "    }}\n");
+        }
+
+        fmt::format_to(it, "}}\n\n");
+    }
+
+    fmt::format_to(it, "{}\n", platform == HeaderPlatform::Windows ? "#endif // _WIN32" : "#endif // !_WIN32");
+    out.write(buf.data(), buf.size());
+}
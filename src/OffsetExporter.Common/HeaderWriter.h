@@ -0,0 +1,23 @@
+#pragma once
+#include <ostream>
+#include <string_view>
+#include "LayoutModel.h"
+
+enum class HeaderPlatform
+{
+    Windows, //!< section is compiled if _WIN32 is defined
+    Linux,   //!< section is compiled if _WIN32 is not defined
+};
+
+//! Writes a C++ header with the layout of every class in the model.
+//!
+//! Each field becomes `using <name> = Member<T, offset>` in `namespace amxx_offsets::<class>`,
+//! where T is derived from amxxType, signedness and array size. Member::offset is constexpr and
+//! Member::Get(self) is an inline accessor, so the offset is folded into the caller's code.
+//! Vtable entries become `using <name> = VirtualMethod<index>`.
+//! `layoutHash` is the same hash as in JSON output, `amxx_offsets::binaryId` the build-id or GUID and age
+//! of the binary, so plugins can check at startup that they were built against the running binary.
+//!
+//! The platform section is wrapped in #ifdef _WIN32 / #ifndef _WIN32, and the shared templates have
+//! their own guard, so the headers produced by both exporters can be included side by side.
+void WriteLayoutHeader(const LayoutModel& model, HeaderPlatform platform, std::string_view generator, std::ostream& out);
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <unordered_set>
+#include <fmt/format.h>
+#include "InheritanceGraph.h"
+
+bool InheritanceGraph::AddClass(std::string_view name, uint64_t location)
+{
+    return m_locations.try_emplace(name, location).second;
+}
+
+void InheritanceGraph::AddBase(std::string_view derived, std::string_view base)
+{
+    m_derived[base].push_back(derived);
+}
+
+std::vector<InheritanceGraph::Class> InheritanceGraph::CollectDerived(const std::vector<std::string>& roots) const
+{
+    std::vector<Class> result;
+    std::unordered_set<std::string_view> visited;
+    std::vector<std::string_view> stack;
+
+    for (const std::string& root : roots)
+    {
+        auto it = m_locations.find(root);
+
+        if (it == m_locations.end())
+        {
+            fmt::println("Root class {} is not defined", root);
+            continue;
+        }
+
+        // Views must point into the debug info, not into roots
+        if (visited.insert(it->first).second)
+            stack.push_back(it->first);
+    }
+
+    while (!stack.empty())
+    {
+        std::string_view name = stack.back();
+        stack.pop_back();
+
+        auto location = m_locations.find(name);
+        if (location != m_locations.end())
+            result.push_back(Class { name, location->second });
+
+        auto derived = m_derived.find(name);
+        if (derived == m_derived.end())
+            continue;
+
+        for (std::string_view derivedName : derived->second)
+        {
+            if (visited.insert(derivedName).second)
+                stack.push_back(derivedName);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Class& a, const Class& b) { return a.location < b.location; });
+    return result;
+}
+
+std::vector<InheritanceGraph::Class> InheritanceGraph::CollectDerived(const std::vector<std::string>& roots,
+    const std::vector<std::string_view>& classes) const
+{
+    std::vector<Class> result = CollectDerived(roots);
+    std::unordered_set<std::string_view> names;
+
+    for (const Class& cls : result)
+        names.insert(cls.name);
+
+    for (std::string_view name : classes)
+    {
+        auto it = m_locations.find(name);
+
+        // Views must point into the debug info, not into the class list
+        if (it != m_locations.end() && names.insert(it->first).second)
+            result.push_back(Class { it->first, it->second });
+    }
+
+    std::sort(result.begin(), result.end(), [](const Class& a, const Class& b) { return a.location < b.location; });
+    return result;
+}
+
+std::vector<std::string> InheritanceGraph::ParseNameList(std::string_view list)
+{
+    std::vector<std::string> names;
+
+    while (!list.empty())
+    {
+        size_t end = std::min(list.find(','), list.size());
+        std::string_view name = list.substr(0, end);
+        list.remove_prefix(std::min(end + 1, list.size()));
+
+        while (!name.empty() && name.front() == ' ')
+            name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ')
+            name.remove_suffix(1);
+
+        if (!name.empty())
+            names.emplace_back(name);
+    }
+
+    return names;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//! Base -> derived index of the classes in the debug info, used by --roots to find the classes to export.
+//! Names are views into the debug info and must outlive the graph.
+class InheritanceGraph
+{
+public:
+    struct Class
+    {
+        std::string_view name;
+        uint64_t location; //!< where the exporter finds the definition (type index, DIE offset)
+    };
+
+    //! Records a class definition. Returns false if the class was already added:
+    //! like extraction, the graph only uses the first definition of a name.
+    bool AddClass(std::string_view name, uint64_t location);
+
+    //! Adds an edge from a base class to a class passed to AddClass.
+    void AddBase(std::string_view derived, std::string_view base);
+
+    //! Returns the roots and all classes derived from them, directly or not, ordered by location.
+    //! Roots that are not defined are reported and skipped.
+    std::vector<Class> CollectDerived(const std::vector<std::string>& roots) const;
+
+    //! Like CollectDerived, plus the given classes themselves (--class-list with --roots), so that the exporter
+    //! can extract all of them from their locations. Classes that are not defined are skipped.
+    std::vector<Class> CollectDerived(const std::vector<std::string>& roots, const std::vector<std::string_view>& classes) const;
+
+    size_t GetClassCount() const { return m_locations.size(); }
+
+    //! Splits "CBaseEntity,CGameRules".
+    static std::vector<std::string> ParseNameList(std::string_view list);
+
+private:
+    std::unordered_map<std::string_view, uint64_t> m_locations;
+    std::unordered_map<std::string_view, std::vector<std::string_view>> m_derived;
+};
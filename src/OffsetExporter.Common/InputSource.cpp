@@ -0,0 +1,729 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include <zstd.h>
+#include "InputSource.h"
+
+namespace
+{
+
+constexpr std::string_view STDIN_SPEC = "-";
+constexpr std::string_view ARCHIVE_EXTENSIONS[] = { ".tar", ".tar.zst", ".tar.zstd", ".tzst" };
+
+struct InputSpec
+{
+    std::string_view path;
+    std::string_view member;
+};
+
+//! Splits "archive.tar:member" at the colon after the archive extension.
+//! Drive letters and colons in member names are left alone.
+std::optional<InputSpec> ParseSpec(std::string_view spec)
+{
+    if (spec == STDIN_SPEC)
+        return InputSpec { spec, {} };
+
+    for (size_t colon = spec.find(':'); colon != std::string_view::npos; colon = spec.find(':', colon + 1))
+    {
+        std::string_view path = spec.substr(0, colon);
+        bool isArchive = path == STDIN_SPEC;
+
+        for (std::string_view ext : ARCHIVE_EXTENSIONS)
+            isArchive = isArchive || path.ends_with(ext);
+
+        if (isArchive && colon + 1 < spec.size())
+            return InputSpec { path, spec.substr(colon + 1) };
+    }
+
+    return std::nullopt;
+}
+
+//! Strips "./" and "/" prefixes so that names written by different tar implementations compare equal.
+std::string_view NormalizeMemberName(std::string_view name)
+{
+    while (true)
+    {
+        if (name.starts_with("./"))
+            name.remove_prefix(2);
+        else if (name.starts_with("/"))
+            name.remove_prefix(1);
+        else
+            return name;
+    }
+}
+
+//! Owns a file descriptor of the input. Standard input is never closed.
+class InputFile
+{
+public:
+    explicit InputFile(std::string_view path)
+    {
+        if (path == STDIN_SPEC)
+        {
+#ifdef _WIN32
+            _setmode(0, _O_BINARY);
+#endif
+            m_file = 0;
+            return;
+        }
+
+        std::string pathStr(path);
+#ifdef _WIN32
+        m_file = _open(pathStr.c_str(), _O_RDONLY | _O_BINARY);
+#else
+        m_file = open(pathStr.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+
+        if (m_file == -1)
+            throw std::runtime_error(fmt::format("Cannot open {}", path));
+    }
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    ~InputFile()
+    {
+        if (m_file > 0)
+        {
+#ifdef _WIN32
+            _close(m_file);
+#else
+            close(m_file);
+#endif
+        }
+    }
+
+    //! Fills the buffer unless the end of the input is reached. Returns the number of bytes read.
+    size_t Read(char* buffer, size_t size)
+    {
+        size_t total = 0;
+
+        while (total < size)
+        {
+#ifdef _WIN32
+            int bytesRead = _read(m_file, buffer + total, static_cast<unsigned>(std::min<size_t>(size - total, 1u << 30)));
+#else
+            ssize_t bytesRead = read(m_file, buffer + total, size - total);
+
+            if (bytesRead < 0 && errno == EINTR)
+                continue;
+#endif
+
+            if (bytesRead < 0)
+                throw std::runtime_error("Failed to read input");
+
+            if (bytesRead == 0)
+                break;
+
+            total += static_cast<size_t>(bytesRead);
+        }
+
+        return total;
+    }
+
+private:
+    int m_file = -1;
+};
+
+//! Reads the input on a separate thread so that the next chunk is read while the current one is decompressed.
+class ChunkReader
+{
+public:
+    explicit ChunkReader(InputFile& file)
+        : m_file(file)
+        , m_thread([this] { Run(); })
+    {
+    }
+
+    ~ChunkReader()
+    {
+        Stop();
+    }
+
+    //! Returns the next chunk or an empty one at the end of the input. Rethrows read errors.
+    std::vector<char> Next()
+    {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] { return !m_queue.empty() || m_eof; });
+
+        if (!m_queue.empty())
+        {
+            std::vector<char> chunk = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_cv.notify_all();
+            return chunk;
+        }
+
+        if (!m_error.empty())
+            throw std::runtime_error(m_error);
+
+        return {};
+    }
+
+    //! Stops reading. Blocks until a read that is in progress returns.
+    void Stop()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_cv.notify_all();
+
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+    static constexpr size_t MAX_QUEUED_CHUNKS = 4;
+
+    InputFile& m_file;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::vector<char>> m_queue;
+    std::string m_error;
+    bool m_eof = false;
+    bool m_stop = false;
+
+    // Must be last, the thread starts in the constructor
+    std::thread m_thread;
+
+    void Run()
+    {
+        while (true)
+        {
+            std::vector<char> chunk(CHUNK_SIZE);
+            std::string error;
+
+            try
+            {
+                chunk.resize(m_file.Read(chunk.data(), chunk.size()));
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+                chunk.clear();
+            }
+
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_queue.size() < MAX_QUEUED_CHUNKS || m_stop; });
+
+            if (m_stop)
+                return;
+
+            if (chunk.empty())
+            {
+                m_error = std::move(error);
+                m_eof = true;
+                m_cv.notify_all();
+                return;
+            }
+
+            m_queue.push_back(std::move(chunk));
+            m_cv.notify_all();
+        }
+    }
+};
+
+//! Growable anonymous memory the input is written to. Backed by a memfd on Linux so that
+//! it can be mapped with the requested IoStrategy like a regular file.
+class MemorySink
+{
+public:
+    MemorySink()
+    {
+#ifdef _WIN32
+        m_base = static_cast<char*>(VirtualAlloc(nullptr, MAX_SIZE, MEM_RESERVE, PAGE_NOACCESS));
+
+        if (!m_base)
+            throw std::runtime_error("Failed to reserve memory for the input");
+#else
+        m_file = memfd_create("offset-exporter-input", MFD_CLOEXEC);
+
+        if (m_file == -1)
+            throw std::runtime_error("memfd_create failed");
+#endif
+    }
+
+    MemorySink(const MemorySink&) = delete;
+    MemorySink& operator=(const MemorySink&) = delete;
+
+    ~MemorySink()
+    {
+#ifdef _WIN32
+        if (m_base)
+            VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+        if (m_file != -1)
+            close(m_file);
+#endif
+    }
+
+    size_t GetSize() const { return m_size; }
+
+    void Append(const char* data, size_t size)
+    {
+#ifdef _WIN32
+        if (size > MAX_SIZE - m_size)
+            throw std::runtime_error("Input is too large");
+
+        if (m_size + size > m_committed)
+        {
+            size_t newCommitted = std::min(MAX_SIZE, (m_size + size + COMMIT_STEP - 1) / COMMIT_STEP * COMMIT_STEP);
+
+            if (!VirtualAlloc(m_base + m_committed, newCommitted - m_committed, MEM_COMMIT, PAGE_READWRITE))
+                throw std::runtime_error("Failed to commit memory for the input");
+
+            m_committed = newCommitted;
+        }
+
+        std::memcpy(m_base + m_size, data, size);
+        m_size += size;
+#else
+        while (size > 0)
+        {
+            ssize_t written = write(m_file, data, size);
+
+            if (written < 0 && errno == EINTR)
+                continue;
+
+            if (written <= 0)
+                throw std::runtime_error("Failed to write to memfd");
+
+            data += written;
+            size -= static_cast<size_t>(written);
+            m_size += static_cast<size_t>(written);
+        }
+#endif
+    }
+
+    //! Hands the memory over to a MemoryMappedFile handle. The sink is empty afterwards.
+    MemoryMappedFile::Handle Finish(MemoryMappedFile::IoStrategy strategy)
+    {
+#ifdef _WIN32
+        // Already in memory, the strategy doesn't matter
+        (void)strategy;
+        char* base = std::exchange(m_base, nullptr);
+        return MemoryMappedFile::Handle { INVALID_HANDLE_VALUE, nullptr, base, m_size, true };
+#else
+        return MemoryMappedFile::Adopt(std::exchange(m_file, -1), strategy);
+#endif
+    }
+
+private:
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    static constexpr size_t MAX_SIZE = sizeof(void*) == 8 ? (size_t(1) << 36) : (size_t(1) << 30);
+    static constexpr size_t COMMIT_STEP = 64 << 20;
+
+    char* m_base = nullptr;
+    size_t m_committed = 0;
+#else
+    int m_file = -1;
+#endif
+};
+
+//! Extracts one member of a tar archive as the archive is streamed through it.
+//! Supports ustar, GNU long names and pax path/size records.
+class TarExtractor
+{
+public:
+    TarExtractor(std::string_view member, MemorySink& sink)
+        : m_member(NormalizeMemberName(member))
+        , m_sink(sink)
+    {
+    }
+
+    bool IsDone() const { return m_done; }
+
+    void Feed(const char* data, size_t size)
+    {
+        while (size > 0 && !m_done && m_state != State::End)
+        {
+            if (m_state == State::Header)
+            {
+                size_t n = std::min(size, BLOCK_SIZE - m_headerSize);
+                std::memcpy(m_header + m_headerSize, data, n);
+                m_headerSize += n;
+                data += n;
+                size -= n;
+
+                if (m_headerSize == BLOCK_SIZE)
+                {
+                    m_headerSize = 0;
+                    OnHeader();
+                }
+            }
+            else if (m_remaining > 0)
+            {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(size, m_remaining));
+
+                if (m_entryKind == EntryKind::Member)
+                    m_sink.Append(data, n);
+                else if (m_entryKind == EntryKind::LongName || m_entryKind == EntryKind::Pax)
+                    m_extra.append(data, n);
+
+                m_remaining -= n;
+                data += n;
+                size -= n;
+
+                if (m_remaining == 0)
+                    OnEntryData();
+            }
+            else
+            {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(size, m_padding));
+                m_padding -= n;
+                data += n;
+                size -= n;
+
+                if (m_padding == 0)
+                    m_state = State::Header;
+            }
+        }
+    }
+
+    //! Throws if the member was not found or the archive ended in the middle of it.
+    void Finish() const
+    {
+        if (!m_found)
+            throw std::runtime_error(fmt::format("{} not found in archive", m_member));
+
+        if (!m_done)
+            throw std::runtime_error(fmt::format("Archive is truncated in the middle of {}", m_member));
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 512;
+
+    enum class State
+    {
+        Header,
+        Data,
+        End,
+    };
+
+    enum class EntryKind
+    {
+        Skip,
+        Member,
+        LongName,
+        Pax,
+    };
+
+    std::string m_member;
+    MemorySink& m_sink;
+    State m_state = State::Header;
+    EntryKind m_entryKind = EntryKind::Skip;
+    char m_header[BLOCK_SIZE];
+    size_t m_headerSize = 0;
+    uint64_t m_remaining = 0;
+    uint64_t m_padding = 0;
+    std::string m_extra;
+    std::string m_nextName;
+    std::optional<uint64_t> m_nextSize;
+    bool m_found = false;
+    bool m_done = false;
+
+    std::string_view GetField(size_t offset, size_t size) const
+    {
+        std::string_view field(m_header + offset, size);
+        return field.substr(0, field.find('\0'));
+    }
+
+    uint64_t ParseNumber(size_t offset, size_t size) const
+    {
+        const uint8_t* field = reinterpret_cast<const uint8_t*>(m_header + offset);
+        uint64_t value = 0;
+
+        if (field[0] & 0x80)
+        {
+            // GNU base-256 for values that don't fit in octal
+            for (size_t i = 1; i < size; i++)
+                value = (value << 8) | field[i];
+
+            return value;
+        }
+
+        for (size_t i = 0; i < size; i++)
+        {
+            if (field[i] >= '0' && field[i] <= '7')
+                value = value * 8 + (field[i] - '0');
+            else if (field[i] != ' ' || value != 0)
+                break;
+        }
+
+        return value;
+    }
+
+    void OnHeader()
+    {
+        if (std::all_of(m_header, m_header + BLOCK_SIZE, [](char c) { return c == 0; }))
+        {
+            m_state = State::End;
+            return;
+        }
+
+        // Checksum is calculated with the checksum field itself set to spaces
+        uint64_t checksum = 8 * ' ';
+
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            if (i < 148 || i >= 156)
+                checksum += static_cast<uint8_t>(m_header[i]);
+        }
+
+        if (checksum != ParseNumber(148, 8))
+            throw std::runtime_error("Input is not a tar archive or is corrupted");
+
+        std::string name;
+
+        if (!m_nextName.empty())
+            name = std::exchange(m_nextName, {});
+        else if (GetField(257, 5) == "ustar" && !GetField(345, 155).empty())
+            name = fmt::format("{}/{}", GetField(345, 155), GetField(0, 100));
+        else
+            name = GetField(0, 100);
+
+        uint64_t size = ParseNumber(124, 12);
+
+        if (m_nextSize)
+            size = *std::exchange(m_nextSize, std::nullopt);
+
+        switch (m_header[156])
+        {
+        case '0':
+        case '\0':
+        case '7':
+            m_entryKind = NormalizeMemberName(name) == m_member ? EntryKind::Member : EntryKind::Skip;
+            break;
+        case 'L':
+            m_entryKind = EntryKind::LongName;
+            break;
+        case 'x':
+            m_entryKind = EntryKind::Pax;
+            break;
+        default:
+            // Directories, links, global pax headers
+            m_entryKind = EntryKind::Skip;
+            break;
+        }
+
+        if (m_entryKind == EntryKind::Member)
+            m_found = true;
+
+        m_extra.clear();
+        m_remaining = size;
+        m_padding = (BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE;
+        m_state = State::Data;
+
+        if (m_remaining == 0)
+        {
+            OnEntryData();
+
+            if (m_padding == 0)
+                m_state = State::Header;
+        }
+    }
+
+    void OnEntryData()
+    {
+        switch (m_entryKind)
+        {
+        case EntryKind::Member:
+            // The rest of the archive is not needed
+            m_done = true;
+            break;
+        case EntryKind::LongName:
+            m_nextName = m_extra.substr(0, m_extra.find('\0'));
+            break;
+        case EntryKind::Pax:
+            ParsePaxRecords();
+            break;
+        default:
+            break;
+        }
+    }
+
+    //! Parses "<length> <key>=<value>\n" records.
+    void ParsePaxRecords()
+    {
+        std::string_view records = m_extra;
+
+        while (!records.empty())
+        {
+            size_t space = records.find(' ');
+
+            if (space == std::string_view::npos)
+                break;
+
+            size_t length = 0;
+
+            for (char c : records.substr(0, space))
+                length = length * 10 + (c - '0');
+
+            if (length <= space + 1 || length > records.size())
+                break;
+
+            std::string_view record = records.substr(space + 1, length - space - 2);
+            size_t equals = record.find('=');
+
+            if (equals != std::string_view::npos)
+            {
+                std::string_view key = record.substr(0, equals);
+                std::string_view value = record.substr(equals + 1);
+
+                if (key == "path")
+                {
+                    m_nextName = value;
+                }
+                else if (key == "size")
+                {
+                    uint64_t size = 0;
+
+                    for (char c : value)
+                        size = size * 10 + (c - '0');
+
+                    m_nextSize = size;
+                }
+            }
+
+            records.remove_prefix(length);
+        }
+    }
+};
+
+//! Decompresses a stream of zstd frames.
+class ZstdDecoder
+{
+public:
+    ZstdDecoder()
+        : m_ctx(ZSTD_createDCtx())
+        , m_output(ZSTD_DStreamOutSize())
+    {
+        if (!m_ctx)
+            throw std::runtime_error("ZSTD_createDCtx failed");
+    }
+
+    ZstdDecoder(const ZstdDecoder&) = delete;
+    ZstdDecoder& operator=(const ZstdDecoder&) = delete;
+
+    ~ZstdDecoder()
+    {
+        ZSTD_freeDCtx(m_ctx);
+    }
+
+    static bool IsZstd(const std::vector<char>& data)
+    {
+        constexpr uint8_t ZSTD_MAGIC[] = { 0x28, 0xB5, 0x2F, 0xFD };
+        return data.size() >= sizeof(ZSTD_MAGIC) && std::memcmp(data.data(), ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0;
+    }
+
+    //! Whether the input so far ended on a frame boundary.
+    bool IsFrameComplete() const { return m_lastResult == 0; }
+
+    template <typename F>
+    void Feed(const char* data, size_t size, F&& consume)
+    {
+        ZSTD_inBuffer input = { data, size, 0 };
+        bool isOutputFull = false;
+
+        // A full output buffer means zstd may still hold decoded data, even with the input consumed
+        while (input.pos < input.size || isOutputFull)
+        {
+            ZSTD_outBuffer output = { m_output.data(), m_output.size(), 0 };
+            m_lastResult = ZSTD_decompressStream(m_ctx, &output, &input);
+
+            if (ZSTD_isError(m_lastResult))
+                throw std::runtime_error(fmt::format("zstd: {}", ZSTD_getErrorName(m_lastResult)));
+
+            consume(m_output.data(), output.pos);
+            isOutputFull = output.pos == output.size;
+        }
+    }
+
+private:
+    ZSTD_DCtx* m_ctx;
+    std::vector<char> m_output;
+    size_t m_lastResult = 0;
+};
+
+void StreamInto(MemorySink& sink, const InputSpec& spec)
+{
+    InputFile file(spec.path);
+    ChunkReader reader(file);
+    std::optional<TarExtractor> tar;
+    std::optional<ZstdDecoder> zstd;
+
+    if (!spec.member.empty())
+        tar.emplace(spec.member, sink);
+
+    auto consume = [&](const char* data, size_t size)
+    {
+        if (tar)
+            tar->Feed(data, size);
+        else
+            sink.Append(data, size);
+    };
+
+    for (bool first = true; !tar || !tar->IsDone(); first = false)
+    {
+        std::vector<char> chunk = reader.Next();
+
+        if (chunk.empty())
+            break;
+
+        if (first && ZstdDecoder::IsZstd(chunk))
+            zstd.emplace();
+
+        if (zstd)
+            zstd->Feed(chunk.data(), chunk.size(), consume);
+        else
+            consume(chunk.data(), chunk.size());
+    }
+
+    reader.Stop();
+
+    if (tar)
+        tar->Finish();
+    else if (zstd && !zstd->IsFrameComplete())
+        throw std::runtime_error("zstd stream is truncated");
+}
+
+} // namespace
+
+bool InputSource::IsStreamed(std::string_view spec)
+{
+    return ParseSpec(spec).has_value();
+}
+
+MemoryMappedFile::Handle InputSource::Open(const std::string& spec, MemoryMappedFile::IoStrategy strategy)
+{
+    std::optional<InputSpec> inputSpec = ParseSpec(spec);
+
+    if (!inputSpec)
+        return MemoryMappedFile::Open(spec.c_str(), strategy);
+
+    MemorySink sink;
+    StreamInto(sink, *inputSpec);
+    return sink.Finish(strategy);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "MemoryMappedFile.h"
+
+//! Opens exporter inputs that are not plain files on disk.
+//!
+//! Supported specs:
+//!   path                 - a file, opened with MemoryMappedFile::Open
+//!   -                    - standard input
+//!   archive.tar:member   - a member of a tar archive
+//!   -:member             - a member of a tar archive read from standard input
+//!
+//! Streamed inputs may be zstd-compressed (detected from the magic), so `hl.tar.zst:hl.so` works.
+//! They are decompressed and extracted in a single pass into anonymous memory (a memfd on Linux)
+//! without temporary files. Reading the compressed input runs on a separate thread so that it
+//! overlaps with decompression.
+namespace InputSource
+{
+    //! Returns whether the spec is stdin or an archive member.
+    bool IsStreamed(std::string_view spec);
+
+    //! Opens the input. Throws std::runtime_error if a streamed input can't be read or extracted.
+    //! Like MemoryMappedFile::Open, returns a handle with a null baseAddress if the result can't be mapped.
+    MemoryMappedFile::Handle Open(const std::string& spec, MemoryMappedFile::IoStrategy strategy);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+//! Opens the file with every MemoryMappedFile::IoStrategy, touches every page and prints the timings.
+//! Each strategy is measured once with the file evicted from the page cache and then warm.
+//! Cold numbers are only printed if the platform can evict the file.
+void RunIoBenchmark(const char* path, int iterations);
@@ -0,0 +1,32 @@
+#pragma once
+#include <iterator>
+#include <string_view>
+#include <fmt/format.h>
+
+//! Appends a quoted and escaped JSON string.
+inline void AppendJsonString(fmt::memory_buffer& buf, std::string_view str)
+{
+    buf.push_back('"');
+
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': fmt::format_to(std::back_inserter(buf), "\\\""); break;
+        case '\\': fmt::format_to(std::back_inserter(buf), "\\\\"); break;
+        case '\b': fmt::format_to(std::back_inserter(buf), "\\b"); break;
+        case '\f': fmt::format_to(std::back_inserter(buf), "\\f"); break;
+        case '\n': fmt::format_to(std::back_inserter(buf), "\\n"); break;
+        case '\r': fmt::format_to(std::back_inserter(buf), "\\r"); break;
+        case '\t': fmt::format_to(std::back_inserter(buf), "\\t"); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                fmt::format_to(std::back_inserter(buf), "\\u{:04x}", static_cast<unsigned>(c));
+            else
+                buf.push_back(c);
+            break;
+        }
+    }
+
+    buf.push_back('"');
+}
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/format.h>
+#include "LayoutModel.h"
+
+namespace
+{
+
+//! FNV-1a, 64-bit, over NUL-terminated tokens. Null strings are the token "\x01".
+class LayoutHasher
+{
+public:
+    void Add(std::string_view token)
+    {
+        for (char c : token)
+            AddByte(static_cast<uint8_t>(c));
+
+        AddByte(0);
+    }
+
+    void Add(uint64_t value) { Add(std::string_view(fmt::format_int(value).c_str())); }
+    void Add(int64_t value) { Add(std::string_view(fmt::format_int(value).c_str())); }
+
+    void Add(const LayoutModel& model, LayoutModel::StringId id)
+    {
+        Add(id == LayoutModel::NO_STRING ? std::string_view("\x01") : model.GetString(id));
+    }
+
+    uint64_t GetHash() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 14695981039346656037ull;
+
+    void AddByte(uint8_t byte) { m_hash = (m_hash ^ byte) * 1099511628211ull; }
+};
+
+} // namespace
+
+uint32_t LayoutModel::BeginClass(std::string_view name)
+{
+    uint32_t cls = GetClassCount();
+    StringId nameId = AddName(name);
+    m_classIndex.try_emplace(nameId, cls);
+    m_classNames.push_back(nameId);
+    m_classBases.push_back(NO_STRING);
+    m_classSizes.push_back(0);
+    m_classFirstField.push_back(GetFieldCount());
+    m_classFirstVm.push_back(GetVirtualMethodCount());
+    m_classFlatFields.push_back(Range { UINT32_MAX, UINT32_MAX });
+    m_classSlots.push_back(Range { UINT32_MAX, UINT32_MAX });
+    return cls;
+}
+
+void LayoutModel::SetBaseClass(std::string_view name)
+{
+    if (m_classNames.empty())
+        throw std::logic_error("SetBaseClass called before BeginClass");
+
+    m_classBases.back() = AddName(name);
+}
+
+void LayoutModel::SetClassSize(uint64_t size)
+{
+    if (m_classNames.empty())
+        throw std::logic_error("SetClassSize called before BeginClass");
+
+    m_classSizes.back() = size;
+}
+
+void LayoutModel::AddField(const FieldDesc& field)
+{
+    AddField(field, AddName(field.name), false);
+}
+
+void LayoutModel::AddField(const FieldDesc& field, StringId nameId, bool isNested)
+{
+    if (m_classNames.empty())
+        throw std::logic_error("AddField called before BeginClass");
+
+    m_fieldNames.push_back(nameId);
+    m_fieldOffsets.push_back(field.offset);
+    m_fieldArraySizes.push_back(field.arraySize);
+    m_fieldSizes.push_back(field.size);
+    m_fieldAlignments.push_back(field.alignment);
+    m_fieldTypes.push_back(m_strings.Add(field.type));
+    m_fieldAmxxTypes.push_back(m_strings.Add(field.amxxType));
+    m_fieldSignedness.push_back(field.signedness);
+    m_fieldNested.push_back(isNested);
+}
+
+void LayoutModel::AddNestedField(const FieldDesc& field)
+{
+    AddField(field, m_strings.Add(field.name), true);
+}
+
+void LayoutModel::AddVirtualMethod(const VirtualMethodDesc& method)
+{
+    if (m_classNames.empty())
+        throw std::logic_error("AddVirtualMethod called before BeginClass");
+
+    m_vmNames.push_back(AddName(method.name));
+    m_vmLinkNames.push_back(method.linkName ? AddName(*method.linkName) : NO_STRING);
+    m_vmRvas.push_back(method.rva);
+    m_vmIndices.push_back(method.index);
+    m_vmSignatures.push_back(method.signature);
+}
+
+uint32_t LayoutModel::FindClass(std::string_view name) const
+{
+    auto it = m_classIndex.find(m_strings.Find(name));
+    return it != m_classIndex.end() ? it->second : UINT32_MAX;
+}
+
+template <typename T>
+std::vector<uint32_t> LayoutModel::GetUnresolvedChain(uint32_t cls, T&& isDone, uint32_t& resolvedBase) const
+{
+    std::vector<uint32_t> chain;
+    uint32_t base = cls;
+
+    while (base != UINT32_MAX && !isDone(base))
+    {
+        // Debug info can't have cycles, but a class may name itself if the base wasn't resolved
+        if (std::find(chain.begin(), chain.end(), base) != chain.end())
+        {
+            base = UINT32_MAX;
+            break;
+        }
+
+        chain.push_back(base);
+        base = m_classBases[base] != NO_STRING ? FindClass(GetString(m_classBases[base])) : UINT32_MAX;
+    }
+
+    resolvedBase = base;
+    return chain;
+}
+
+LayoutModel::Range LayoutModel::Flatten(uint32_t cls)
+{
+    // Walk up to the first base that is already flattened or not in the model
+    uint32_t base;
+    std::vector<uint32_t> chain = GetUnresolvedChain(cls, [this](uint32_t c) { return IsFlattened(c); }, base);
+    Range baseFields = base != UINT32_MAX ? m_classFlatFields[base] : Range { 0, 0 };
+
+    // Then flatten the chain top-down, each class on top of its base
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+    {
+        Range ownFields = GetFields(*it);
+        uint32_t begin = static_cast<uint32_t>(m_flatFields.size());
+        m_flatFields.reserve(m_flatFields.size() + (baseFields.end - baseFields.begin) + (ownFields.end - ownFields.begin));
+
+        for (uint32_t i = baseFields.begin; i < baseFields.end; i++)
+            m_flatFields.push_back(m_flatFields[i]);
+
+        for (uint32_t i = ownFields.begin; i < ownFields.end; i++)
+        {
+            if (!m_fieldNested[i])
+                m_flatFields.push_back(i);
+        }
+
+        baseFields = Range { begin, static_cast<uint32_t>(m_flatFields.size()) };
+        m_classFlatFields[*it] = baseFields;
+    }
+
+    return m_classFlatFields[cls];
+}
+
+LayoutModel::Range LayoutModel::ResolveVTable(uint32_t cls)
+{
+    uint32_t base;
+    std::vector<uint32_t> chain = GetUnresolvedChain(cls, [this](uint32_t c) { return IsVTableResolved(c); }, base);
+    Range baseSlots = base != UINT32_MAX ? m_classSlots[base] : Range { 0, 0 };
+
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+    {
+        uint32_t begin = static_cast<uint32_t>(m_slotMethods.size());
+
+        for (uint32_t i = baseSlots.begin; i < baseSlots.end; i++)
+        {
+            m_slotMethods.push_back(m_slotMethods[i]);
+            m_slotIntroClasses.push_back(m_slotIntroClasses[i]);
+        }
+
+        Range vtable = GetVTable(*it);
+
+        for (uint32_t i = vtable.begin; i < vtable.end; i++)
+        {
+            if (m_vmIndices[i] < 0)
+                continue;
+
+            uint32_t slot = begin + static_cast<uint32_t>(m_vmIndices[i]);
+
+            // Slots of a base that is not in the model are unknown
+            if (slot >= m_slotMethods.size())
+            {
+                m_slotMethods.resize(slot + 1, NO_METHOD);
+                m_slotIntroClasses.resize(slot + 1, UINT32_MAX);
+            }
+
+            // The first declaration wins for slots listed twice
+            if (m_slotMethods[slot] != NO_METHOD && GetVirtualMethodClass(m_slotMethods[slot]) == *it)
+                continue;
+
+            // New slots, and overrides of slots of a base that is not in the model
+            if (m_slotMethods[slot] == NO_METHOD)
+                m_slotIntroClasses[slot] = *it;
+
+            m_slotMethods[slot] = i;
+        }
+
+        baseSlots = Range { begin, static_cast<uint32_t>(m_slotMethods.size()) };
+        m_classSlots[*it] = baseSlots;
+    }
+
+    return m_classSlots[cls];
+}
+
+int32_t LayoutModel::FindVirtualMethodSlot(uint32_t cls, std::string_view name, uint64_t signature) const
+{
+    Range slots = m_classSlots[cls];
+
+    // A destructor overrides the destructor of the base, which has a different name
+    const bool isDestructor = name.starts_with('~');
+
+    for (uint32_t i = slots.begin; i < slots.end; i++)
+    {
+        uint32_t method = m_slotMethods[i];
+
+        if (method == NO_METHOD)
+            continue;
+
+        std::string_view methodName = GetString(m_vmNames[method]);
+
+        if (isDestructor ? methodName.starts_with('~') : m_vmSignatures[method] == signature && methodName == name)
+            return static_cast<int32_t>(i - slots.begin);
+    }
+
+    return -1;
+}
+
+uint32_t LayoutModel::GetFieldClass(uint32_t field) const
+{
+    // Classes without fields share the first field of the next one, the last of them owns it
+    auto it = std::upper_bound(m_classFirstField.begin(), m_classFirstField.end(), field);
+    return static_cast<uint32_t>(it - m_classFirstField.begin()) - 1;
+}
+
+uint32_t LayoutModel::GetVirtualMethodClass(uint32_t method) const
+{
+    auto it = std::upper_bound(m_classFirstVm.begin(), m_classFirstVm.end(), method);
+    return static_cast<uint32_t>(it - m_classFirstVm.begin()) - 1;
+}
+
+uint64_t LayoutModel::GetLayoutHash(uint32_t cls) const
+{
+    LayoutHasher hasher;
+    hasher.Add(*this, m_classBases[cls]);
+
+    Range fields = GetFields(cls);
+
+    for (uint32_t i = fields.begin; i < fields.end; i++)
+    {
+        if (m_fieldNested[i])
+            continue;
+
+        hasher.Add("field");
+        hasher.Add(*this, m_fieldNames[i]);
+        hasher.Add(m_fieldOffsets[i]);
+
+        if (m_fieldArraySizes[i] == NO_ARRAY_SIZE)
+            hasher.Add(*this, NO_STRING);
+        else
+            hasher.Add(m_fieldArraySizes[i]);
+
+        hasher.Add(*this, m_fieldTypes[i]);
+        hasher.Add(*this, m_fieldAmxxTypes[i]);
+
+        switch (m_fieldSignedness[i])
+        {
+        case Signedness::Signed: hasher.Add("signed"); break;
+        case Signedness::Unsigned: hasher.Add("unsigned"); break;
+        default: hasher.Add(*this, NO_STRING); break;
+        }
+    }
+
+    if (IsVTableResolved(cls))
+    {
+        Range slots = m_classSlots[cls];
+
+        for (uint32_t i = slots.begin; i < slots.end; i++)
+        {
+            uint32_t method = m_slotMethods[i];
+
+            if (method == NO_METHOD)
+                continue;
+
+            uint32_t introClass = m_slotIntroClasses[i];
+            uint32_t implClass = GetVirtualMethodClass(method);
+
+            hasher.Add("slot");
+            hasher.Add(static_cast<uint64_t>(i - slots.begin));
+            hasher.Add(*this, m_vmNames[method]);
+            hasher.Add(*this, m_vmLinkNames[method]);
+            hasher.Add(*this, m_classNames[introClass]);
+            hasher.Add(*this, implClass != introClass ? m_classNames[implClass] : NO_STRING);
+        }
+    }
+    else
+    {
+        Range vtable = GetVTable(cls);
+
+        for (uint32_t i = vtable.begin; i < vtable.end; i++)
+        {
+            hasher.Add("vm");
+            hasher.Add(*this, m_vmNames[i]);
+            hasher.Add(*this, m_vmLinkNames[i]);
+            hasher.Add(static_cast<int64_t>(m_vmIndices[i]));
+        }
+    }
+
+    return hasher.GetHash();
+}
+
+std::string_view LayoutModel::GetBinaryIdKindName(BinaryIdKind kind)
+{
+    switch (kind)
+    {
+    case BinaryIdKind::ElfBuildId: return "elf-build-id";
+    case BinaryIdKind::PdbGuidAge: return "pdb-guid-age";
+    default: return {};
+    }
+}
+
+void LayoutModel::Reserve(size_t classCount, size_t fieldCount, size_t vtableCount)
+{
+    m_classNames.reserve(classCount);
+    m_classBases.reserve(classCount);
+    m_classSizes.reserve(classCount);
+    m_classFirstField.reserve(classCount);
+    m_classFirstVm.reserve(classCount);
+    m_classFlatFields.reserve(classCount);
+    m_classSlots.reserve(classCount);
+
+    m_fieldNames.reserve(fieldCount);
+    m_fieldOffsets.reserve(fieldCount);
+    m_fieldArraySizes.reserve(fieldCount);
+    m_fieldSizes.reserve(fieldCount);
+    m_fieldAlignments.reserve(fieldCount);
+    m_fieldTypes.reserve(fieldCount);
+    m_fieldAmxxTypes.reserve(fieldCount);
+    m_fieldSignedness.reserve(fieldCount);
+    m_fieldNested.reserve(fieldCount);
+
+    m_vmNames.reserve(vtableCount);
+    m_vmLinkNames.reserve(vtableCount);
+    m_vmRvas.reserve(vtableCount);
+    m_vmIndices.reserve(vtableCount);
+    m_vmSignatures.reserve(vtableCount);
+}
+
+LayoutModel::Range LayoutModel::GetFields(uint32_t cls) const
+{
+    uint32_t end = cls + 1 < GetClassCount() ? m_classFirstField[cls + 1] : GetFieldCount();
+    return Range { m_classFirstField[cls], end };
+}
+
+LayoutModel::Range LayoutModel::GetVTable(uint32_t cls) const
+{
+    uint32_t end = cls + 1 < GetClassCount() ? m_classFirstVm[cls + 1] : GetVirtualMethodCount();
+    return Range { m_classFirstVm[cls], end };
+}
+
+size_t LayoutModel::GetMemoryUsage() const
+{
+    auto bytes = [](const auto& v) { return v.capacity() * sizeof(v[0]); };
+
+    return m_strings.GetCapacity() + m_strings.GetCount() * (sizeof(std::string_view) * 2 + sizeof(StringId)) +
+        bytes(m_classNames) + bytes(m_classBases) + bytes(m_classSizes) + bytes(m_classFirstField) + bytes(m_classFirstVm) +
+        bytes(m_classFlatFields) + bytes(m_classSlots) +
+        bytes(m_fieldNames) + bytes(m_fieldOffsets) + bytes(m_fieldArraySizes) + bytes(m_fieldSizes) + bytes(m_fieldAlignments) + bytes(m_fieldTypes) +
+        bytes(m_fieldAmxxTypes) + bytes(m_fieldSignedness) + bytes(m_fieldNested) +
+        bytes(m_vmNames) + bytes(m_vmLinkNames) + bytes(m_vmRvas) + bytes(m_vmIndices) + bytes(m_vmSignatures) +
+        bytes(m_flatFields) + bytes(m_slotMethods) + bytes(m_slotIntroClasses);
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "StringPool.h"
+
+//! Class layouts extracted from debug info, shared by both exporters.
+//! Classes, fields and vtable entries are stored as parallel arrays. Fields and vtable entries
+//! of a class are contiguous, so a class only stores ranges into them. All strings live in one pool.
+class LayoutModel
+{
+public:
+    using StringId = StringPool::Id;
+
+    static constexpr StringId NO_STRING = StringPool::NONE;
+    static constexpr uint64_t NO_ARRAY_SIZE = UINT64_MAX;
+    static constexpr uint64_t NO_RVA = UINT64_MAX;
+    static constexpr uint32_t NO_METHOD = UINT32_MAX;
+
+    //! How the binary the layouts were extracted from is identified.
+    enum class BinaryIdKind : uint8_t
+    {
+        None,
+        ElfBuildId, //!< NT_GNU_BUILD_ID note, hex
+        PdbGuidAge, //!< GUID followed by the age, hex, as used by symbol servers
+    };
+
+    enum class Signedness : uint8_t
+    {
+        Unknown,
+        Signed,
+        Unsigned,
+    };
+
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    //! Field as passed to AddField.
+    struct FieldDesc
+    {
+        std::string_view name;
+        uint64_t offset = 0;
+        uint64_t arraySize = NO_ARRAY_SIZE;
+        uint64_t size = 0; //!< in bytes, of the whole array for arrays. 0 if unknown
+        uint32_t alignment = 0; //!< natural alignment of the type in bytes, 0 if unknown
+        std::string_view type;
+        std::string_view amxxType;
+        Signedness signedness = Signedness::Unknown;
+    };
+
+    //! Vtable entry as passed to AddVirtualMethod.
+    struct VirtualMethodDesc
+    {
+        std::string_view name;
+        std::optional<std::string_view> linkName;
+        uint64_t rva = NO_RVA;
+        int32_t index = -1;
+        uint64_t signature = 0; //!< tells overloads apart in FindVirtualMethodSlot (PDB: LF_ARGLIST type index)
+    };
+
+    //! Whether vtable entries have an "rva" key. Only PDBs have addresses.
+    void SetHasRva(bool hasRva) { m_hasRva = hasRva; }
+    bool HasRva() const { return m_hasRva; }
+
+    //! Identity of the binary, written to every output so that consumers can check it against the binary they
+    //! are loaded with before trusting any offset.
+    void SetBinaryId(BinaryIdKind kind, std::string_view id)
+    {
+        m_binaryIdKind = kind;
+        m_binaryId = id;
+    }
+
+    BinaryIdKind GetBinaryIdKind() const { return m_binaryIdKind; }
+    std::string_view GetBinaryId() const { return m_binaryId; } //!< empty if unknown
+
+    //! "elf-build-id" or "pdb-guid-age" as written to text outputs. Empty for None.
+    static std::string_view GetBinaryIdKindName(BinaryIdKind kind);
+
+    //! If set, names of classes, fields and vtable entries are referenced instead of copied into the pool.
+    //! The exporters pass views into the mapped debug info, which stays mapped until output is written.
+    void SetBorrowNames(bool borrowNames) { m_borrowNames = borrowNames; }
+
+    //! Starts a new class. Fields and vtable entries added until the next BeginClass belong to it.
+    uint32_t BeginClass(std::string_view name);
+    void SetBaseClass(std::string_view name);
+    void SetClassSize(uint64_t size);
+    void AddField(const FieldDesc& field);
+
+    //! Adds a member of an aggregate field, expanded by --expand-nested. The name is copied even if
+    //! names are borrowed, since it is built by the exporter. Nested fields overlap their parent, so
+    //! they are not part of the flattened layout, the layout hash, headers and offset databases.
+    void AddNestedField(const FieldDesc& field);
+    void AddVirtualMethod(const VirtualMethodDesc& method);
+
+    //! Returns the index of the class or UINT32_MAX if not in the model.
+    uint32_t FindClass(std::string_view name) const;
+
+    //! Computes the flattened layout of a complete class: the fields of its bases in the model, outermost
+    //! base first, followed by its own. Results are memoized, so each base is flattened once and derived
+    //! classes extend its layout instead of walking the chain again. Bases must be complete when this is
+    //! called, which is why exporters extract them first with --flatten.
+    Range Flatten(uint32_t cls);
+
+    //! Computes the complete vtable of a complete class: the slots of its base, with the ones the class
+    //! overrides replaced, followed by the ones it introduces. Memoized like Flatten, with the same
+    //! requirement on bases.
+    Range ResolveVTable(uint32_t cls);
+
+    //! Returns the slot of a method in the resolved vtable of cls by name and signature, or -1.
+    //! Destructors (`~` names) match the destructor slot regardless of name and signature.
+    int32_t FindVirtualMethodSlot(uint32_t cls, std::string_view name, uint64_t signature) const;
+
+    //! 64-bit structural hash of what the text formats write for a class: its base class, the name, offset, array
+    //! size, types and signedness of its own fields, and its resolved vtable slots (or declared vtable entries if
+    //! not resolved) without RVAs. scripts/diff_layouts.py computes the same hash from JSON output, see there for
+    //! the exact encoding. Classes with equal hashes have the same offsets in two builds.
+    uint64_t GetLayoutHash(uint32_t cls) const;
+
+    //! Preallocates for the expected number of classes.
+    void Reserve(size_t classCount, size_t fieldCount, size_t vtableCount);
+
+    const StringPool& GetStrings() const { return m_strings; }
+    std::string_view GetString(StringId id) const { return m_strings.Get(id); }
+
+    // Classes
+    uint32_t GetClassCount() const { return static_cast<uint32_t>(m_classNames.size()); }
+    StringId GetClassName(uint32_t cls) const { return m_classNames[cls]; }
+    StringId GetBaseClass(uint32_t cls) const { return m_classBases[cls]; }
+    uint64_t GetClassSize(uint32_t cls) const { return m_classSizes[cls]; } //!< 0 if unknown
+    Range GetFields(uint32_t cls) const;
+    Range GetVTable(uint32_t cls) const;
+    bool IsFlattened(uint32_t cls) const { return m_classFlatFields[cls].begin != UINT32_MAX; }
+    Range GetFlattenedFields(uint32_t cls) const { return m_classFlatFields[cls]; } //!< range for GetFlattenedField
+    bool IsVTableResolved(uint32_t cls) const { return m_classSlots[cls].begin != UINT32_MAX; }
+    Range GetResolvedVTable(uint32_t cls) const { return m_classSlots[cls]; } //!< range for GetSlot*, slot i is at begin + i
+
+    // Fields
+    uint32_t GetFieldCount() const { return static_cast<uint32_t>(m_fieldNames.size()); }
+    StringId GetFieldName(uint32_t field) const { return m_fieldNames[field]; }
+    uint64_t GetFieldOffset(uint32_t field) const { return m_fieldOffsets[field]; }
+    uint64_t GetFieldArraySize(uint32_t field) const { return m_fieldArraySizes[field]; }
+    uint64_t GetFieldSize(uint32_t field) const { return m_fieldSizes[field]; }
+    uint32_t GetFieldAlignment(uint32_t field) const { return m_fieldAlignments[field]; }
+    StringId GetFieldType(uint32_t field) const { return m_fieldTypes[field]; }
+    StringId GetFieldAmxxType(uint32_t field) const { return m_fieldAmxxTypes[field]; }
+    Signedness GetFieldSignedness(uint32_t field) const { return m_fieldSignedness[field]; }
+    bool IsNestedField(uint32_t field) const { return m_fieldNested[field] != 0; }
+    uint32_t GetFieldClass(uint32_t field) const;
+
+    // Flattened layouts
+    uint32_t GetFlattenedField(uint32_t i) const { return m_flatFields[i]; } //!< index of the field
+
+    // Vtable entries
+    uint32_t GetVirtualMethodCount() const { return static_cast<uint32_t>(m_vmNames.size()); }
+    StringId GetVirtualMethodName(uint32_t method) const { return m_vmNames[method]; }
+    StringId GetVirtualMethodLinkName(uint32_t method) const { return m_vmLinkNames[method]; }
+    uint64_t GetVirtualMethodRva(uint32_t method) const { return m_vmRvas[method]; }
+    int32_t GetVirtualMethodIndex(uint32_t method) const { return m_vmIndices[method]; }
+    uint32_t GetVirtualMethodClass(uint32_t method) const;
+
+    // Resolved vtable slots
+    uint32_t GetSlotMethod(uint32_t i) const { return m_slotMethods[i]; } //!< implementation, NO_METHOD if the slot is unknown
+    uint32_t GetSlotIntroClass(uint32_t i) const { return m_slotIntroClasses[i]; } //!< class that introduced the slot
+
+    //! Approximate heap usage of the arrays and the string pool.
+    size_t GetMemoryUsage() const;
+
+private:
+    StringPool m_strings;
+    bool m_hasRva = false;
+    bool m_borrowNames = false;
+    BinaryIdKind m_binaryIdKind = BinaryIdKind::None;
+    std::string m_binaryId;
+
+    std::vector<StringId> m_classNames;
+    std::vector<StringId> m_classBases;
+    std::vector<uint64_t> m_classSizes;
+    std::vector<uint32_t> m_classFirstField;
+    std::vector<uint32_t> m_classFirstVm;
+    std::vector<Range> m_classFlatFields;
+    std::vector<Range> m_classSlots;
+    std::unordered_map<StringId, uint32_t> m_classIndex;
+
+    std::vector<StringId> m_fieldNames;
+    std::vector<uint64_t> m_fieldOffsets;
+    std::vector<uint64_t> m_fieldArraySizes;
+    std::vector<uint64_t> m_fieldSizes;
+    std::vector<uint32_t> m_fieldAlignments;
+    std::vector<StringId> m_fieldTypes;
+    std::vector<StringId> m_fieldAmxxTypes;
+    std::vector<Signedness> m_fieldSignedness;
+    std::vector<uint8_t> m_fieldNested;
+
+    std::vector<StringId> m_vmNames;
+    std::vector<StringId> m_vmLinkNames;
+    std::vector<uint64_t> m_vmRvas;
+    std::vector<int32_t> m_vmIndices;
+    std::vector<uint64_t> m_vmSignatures;
+
+    std::vector<uint32_t> m_flatFields;
+
+    std::vector<uint32_t> m_slotMethods;
+    std::vector<uint32_t> m_slotIntroClasses;
+
+    //! Classes from cls up to the first base that is already done (per isDone) or not in the model, and that base.
+    template <typename T>
+    std::vector<uint32_t> GetUnresolvedChain(uint32_t cls, T&& isDone, uint32_t& resolvedBase) const;
+
+    void AddField(const FieldDesc& field, StringId nameId, bool isNested);
+
+    StringId AddName(std::string_view name)
+    {
+        return m_borrowNames ? m_strings.AddBorrowed(name) : m_strings.Add(name);
+    }
+};
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include <fmt/format.h>
+#include "Json.h"
+#include "LayoutOptimizer.h"
+
+namespace
+{
+
+constexpr uint64_t CACHE_LINE_SIZE = 64;
+
+enum class SkipReason
+{
+    None,
+    NoFields,
+    UnknownClassSize,
+    UnknownField,
+};
+
+//! A field together with the fields that overlap it.
+struct Block
+{
+    uint32_t field;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t alignment;
+    size_t rank;
+    uint64_t newOffset = 0;
+};
+
+struct Proposal
+{
+    SkipReason skipReason = SkipReason::None;
+    uint32_t unknownField = UINT32_MAX;
+    uint64_t size = 0;
+    bool isChanged = false;
+    std::vector<Block> blocks; //!< in proposed order
+};
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t GetCacheLines(uint64_t size)
+{
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+}
+
+//! Largest alignment of the fields of the bases of cls in the model.
+uint64_t GetBaseAlignment(const LayoutModel& model, uint32_t cls)
+{
+    uint64_t alignment = 1;
+    LayoutModel::StringId base = model.GetBaseClass(cls);
+    uint32_t c = base != LayoutModel::NO_STRING ? model.FindClass(model.GetString(base)) : UINT32_MAX;
+
+    // Bounded in case a class names itself as its base
+    for (uint32_t depth = 0; c != UINT32_MAX && depth < model.GetClassCount(); depth++)
+    {
+        LayoutModel::Range fields = model.GetFields(c);
+
+        for (uint32_t i = fields.begin; i < fields.end; i++)
+            alignment = std::max<uint64_t>(alignment, model.GetFieldAlignment(i));
+
+        base = model.GetBaseClass(c);
+        c = base != LayoutModel::NO_STRING ? model.FindClass(model.GetString(base)) : UINT32_MAX;
+    }
+
+    return alignment;
+}
+
+Proposal ProposeLayout(const LayoutModel& model, const HotFieldList& hotFields, uint32_t cls)
+{
+    Proposal proposal;
+    const uint64_t classSize = model.GetClassSize(cls);
+    proposal.size = classSize;
+
+    LayoutModel::Range range = model.GetFields(cls);
+    std::vector<uint32_t> fields;
+
+    for (uint32_t i = range.begin; i < range.end; i++)
+        fields.push_back(i);
+
+    if (fields.empty())
+    {
+        proposal.skipReason = SkipReason::NoFields;
+        return proposal;
+    }
+
+    if (classSize == 0)
+    {
+        proposal.skipReason = SkipReason::UnknownClassSize;
+        return proposal;
+    }
+
+    std::stable_sort(fields.begin(), fields.end(), [&](uint32_t a, uint32_t b) { return model.GetFieldOffset(a) < model.GetFieldOffset(b); });
+
+    std::string_view className = model.GetString(model.GetClassName(cls));
+    std::vector<Block> blocks;
+
+    for (uint32_t field : fields)
+    {
+        const uint64_t offset = model.GetFieldOffset(field);
+        const uint64_t size = model.GetFieldSize(field);
+        const uint64_t alignment = model.GetFieldAlignment(field);
+        const size_t rank = hotFields.GetRank(className, model.GetString(model.GetFieldName(field)));
+
+        if (!blocks.empty() && offset < blocks.back().offset + blocks.back().size)
+        {
+            Block& block = blocks.back();
+            block.size = std::max(block.size, offset + size - block.offset);
+            block.alignment = std::max(block.alignment, alignment);
+            block.rank = std::min(block.rank, rank);
+            continue;
+        }
+
+        if (size == 0 || alignment == 0)
+        {
+            proposal.skipReason = SkipReason::UnknownField;
+            proposal.unknownField = field;
+            return proposal;
+        }
+
+        blocks.push_back(Block { field, offset, size, alignment, rank });
+    }
+
+    uint64_t classAlignment = GetBaseAlignment(model, cls);
+
+    for (const Block& block : blocks)
+        classAlignment = std::max(classAlignment, block.alignment);
+
+    std::vector<Block> cold;
+
+    for (const Block& block : blocks)
+    {
+        if (block.rank == HotFieldList::NOT_HOT)
+            cold.push_back(block);
+        else
+            proposal.blocks.push_back(block);
+    }
+
+    const bool hasHotFields = !proposal.blocks.empty();
+
+    std::stable_sort(proposal.blocks.begin(), proposal.blocks.end(), [](const Block& a, const Block& b) { return a.rank < b.rank; });
+    std::stable_sort(cold.begin(), cold.end(), [](const Block& a, const Block& b)
+    {
+        return a.alignment != b.alignment ? a.alignment > b.alignment : a.size > b.size;
+    });
+
+    uint64_t cursor = blocks.front().offset;
+
+    for (Block& block : proposal.blocks)
+    {
+        block.newOffset = AlignUp(cursor, block.alignment);
+        cursor = block.newOffset + block.size;
+    }
+
+    // The most aligned field that needs the least padding
+    while (!cold.empty())
+    {
+        auto it = std::min_element(cold.begin(), cold.end(), [&](const Block& a, const Block& b)
+        {
+            return AlignUp(cursor, a.alignment) < AlignUp(cursor, b.alignment);
+        });
+
+        Block block = *it;
+        cold.erase(it);
+
+        block.newOffset = AlignUp(cursor, block.alignment);
+        cursor = block.newOffset + block.size;
+        proposal.blocks.push_back(block);
+    }
+
+    proposal.size = AlignUp(cursor, classAlignment);
+    proposal.isChanged = std::any_of(proposal.blocks.begin(), proposal.blocks.end(), [](const Block& block) { return block.newOffset != block.offset; });
+
+    // Without hot fields only smaller layouts are worth proposing
+    if (!proposal.isChanged || (!hasHotFields && proposal.size >= classSize))
+    {
+        for (Block& block : blocks)
+            block.newOffset = block.offset;
+
+        proposal.blocks = std::move(blocks);
+        proposal.size = classSize;
+        proposal.isChanged = false;
+    }
+
+    return proposal;
+}
+
+void WriteText(const LayoutModel& model, const HotFieldList& hotFields, std::ostream& out)
+{
+    fmt::memory_buffer buf;
+    auto it = std::back_inserter(buf);
+    size_t changedCount = 0;
+    int64_t savedBytes = 0;
+    int64_t savedLines = 0;
+
+    for (uint32_t cls = 0; cls < model.GetClassCount(); cls++)
+    {
+        Proposal proposal = ProposeLayout(model, hotFields, cls);
+        std::string_view className = model.GetString(model.GetClassName(cls));
+        const uint64_t size = model.GetClassSize(cls);
+
+        switch (proposal.skipReason)
+        {
+        case SkipReason::NoFields:
+            fmt::format_to(it, "{}: skipped, no fields\n", className);
+            continue;
+        case SkipReason::UnknownClassSize:
+            fmt::format_to(it, "{}: skipped, class size unknown\n", className);
+            continue;
+        case SkipReason::UnknownField:
+            fmt::format_to(it, "{}: skipped, size or alignment of {} unknown\n", className, model.GetString(model.GetFieldName(proposal.unknownField)));
+            continue;
+        case SkipReason::None:
+            break;
+        }
+
+        if (!proposal.isChanged)
+        {
+            fmt::format_to(it, "{}: {} bytes, {} cache lines, no better order\n", className, size, GetCacheLines(size));
+            continue;
+        }
+
+        changedCount++;
+        savedBytes += static_cast<int64_t>(size) - static_cast<int64_t>(proposal.size);
+        savedLines += static_cast<int64_t>(GetCacheLines(size)) - static_cast<int64_t>(GetCacheLines(proposal.size));
+
+        fmt::format_to(it, "{}: {} -> {} bytes ({} saved), {} -> {} cache lines ({} saved)\n", className,
+            size, proposal.size, static_cast<int64_t>(size) - static_cast<int64_t>(proposal.size),
+            GetCacheLines(size), GetCacheLines(proposal.size),
+            static_cast<int64_t>(GetCacheLines(size)) - static_cast<int64_t>(GetCacheLines(proposal.size)));
+
+        for (const Block& block : proposal.blocks)
+        {
+            fmt::format_to(it, "    0x{:X} {} ({} bytes, align {}, was 0x{:X}){}\n", block.newOffset,
+                model.GetString(model.GetFieldName(block.field)), block.size, block.alignment, block.offset,
+                block.rank != HotFieldList::NOT_HOT ? " hot" : "");
+        }
+    }
+
+    fmt::format_to(it, "{} classes, {} reordered, {} bytes and {} cache lines saved\n", model.GetClassCount(), changedCount, savedBytes, savedLines);
+    out.write(buf.data(), buf.size());
+}
+
+void WriteJson(const LayoutModel& model, const HotFieldList& hotFields, std::ostream& out)
+{
+    fmt::memory_buffer buf;
+    auto it = std::back_inserter(buf);
+
+    fmt::format_to(it, "{{\"cacheLineSize\":{},\"classes\":[", CACHE_LINE_SIZE);
+
+    for (uint32_t cls = 0; cls < model.GetClassCount(); cls++)
+    {
+        Proposal proposal = ProposeLayout(model, hotFields, cls);
+        const uint64_t size = model.GetClassSize(cls);
+
+        if (cls != 0)
+            buf.push_back(',');
+
+        fmt::format_to(it, "{{\"name\":");
+        AppendJsonString(buf, model.GetString(model.GetClassName(cls)));
+        fmt::format_to(it, ",\"size\":{},\"proposedSize\":{},\"cacheLines\":{},\"proposedCacheLines\":{},\"skipped\":",
+            size, proposal.size, GetCacheLines(size), GetCacheLines(proposal.size));
+
+        switch (proposal.skipReason)
+        {
+        case SkipReason::None:
+            fmt::format_to(it, "null");
+            break;
+        case SkipReason::NoFields:
+            fmt::format_to(it, "\"no fields\"");
+            break;
+        case SkipReason::UnknownClassSize:
+            fmt::format_to(it, "\"class size unknown\"");
+            break;
+        case SkipReason::UnknownField:
+            AppendJsonString(buf, fmt::format("size or alignment of {} unknown", model.GetString(model.GetFieldName(proposal.unknownField))));
+            break;
+        }
+
+        fmt::format_to(it, ",\"changed\":{},\"fields\":[", proposal.isChanged);
+
+        for (size_t i = 0; i < proposal.blocks.size(); i++)
+        {
+            const Block& block = proposal.blocks[i];
+
+            if (i != 0)
+                buf.push_back(',');
+
+            fmt::format_to(it, "{{\"name\":");
+            AppendJsonString(buf, model.GetString(model.GetFieldName(block.field)));
+            fmt::format_to(it, ",\"offset\":{},\"originalOffset\":{},\"size\":{},\"alignment\":{},\"hot\":{}}}",
+                block.newOffset, block.offset, block.size, block.alignment, block.rank != HotFieldList::NOT_HOT);
+        }
+
+        fmt::format_to(it, "]}}");
+    }
+
+    fmt::format_to(it, "]}}\n");
+    out.write(buf.data(), buf.size());
+}
+
+} // namespace
+
+HotFieldList HotFieldList::LoadFile(const std::string& path)
+{
+    std::ifstream file(path);
+
+    if (!file)
+        throw std::runtime_error(fmt::format("Failed to open hot field list {}", path));
+
+    HotFieldList list;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        std::string_view text = line;
+        text = text.substr(0, text.find('#'));
+
+        while (!text.empty() && (text.back() == '\r' || text.back() == ' ' || text.back() == '\t'))
+            text.remove_suffix(1);
+
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+
+        if (text.empty())
+            continue;
+
+        size_t separator = text.rfind("::");
+
+        if (separator == std::string_view::npos || separator == 0 || separator + 2 == text.size())
+            throw std::runtime_error(fmt::format("{}:{}: expected Class::field", path, lineNumber));
+
+        list.Add(text.substr(0, separator), text.substr(separator + 2));
+    }
+
+    return list;
+}
+
+void HotFieldList::Add(std::string_view className, std::string_view fieldName)
+{
+    m_ranks.try_emplace(fmt::format("{}::{}", className, fieldName), m_ranks.size());
+}
+
+size_t HotFieldList::GetRank(std::string_view className, std::string_view fieldName) const
+{
+    if (m_ranks.empty())
+        return NOT_HOT;
+
+    auto it = m_ranks.find(fmt::format("{}::{}", className, fieldName));
+    return it != m_ranks.end() ? it->second : NOT_HOT;
+}
+
+void WriteLayoutProposals(const LayoutModel& model, const HotFieldList& hotFields, LayoutReportFormat format, std::ostream& out)
+{
+    if (format == LayoutReportFormat::Json)
+        WriteJson(model, hotFields, out);
+    else
+        WriteText(model, hotFields, out);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "LayoutModel.h"
+#include "LayoutReport.h"
+
+//! Fields to pack first when proposing layouts, most important first.
+//! One `Class::field` per line. Empty lines are ignored, `#` starts a comment.
+class HotFieldList
+{
+public:
+    static constexpr size_t NOT_HOT = SIZE_MAX;
+
+    //! Throws std::runtime_error if the file can't be read.
+    static HotFieldList LoadFile(const std::string& path);
+
+    void Add(std::string_view className, std::string_view fieldName);
+
+    //! Position of the field in the list or NOT_HOT.
+    size_t GetRank(std::string_view className, std::string_view fieldName) const;
+
+    size_t GetCount() const { return m_ranks.size(); }
+
+private:
+    std::unordered_map<std::string, size_t> m_ranks; //!< keyed by "Class::field"
+};
+
+//! Proposes a reordering of the own fields of every class in the model that minimizes padding and the number of
+//! 64-byte cache lines, using field sizes and alignments from the debug info. Inherited fields stay where they are:
+//! own fields are placed from the offset of the first one. Hot fields go first in list order, the rest by
+//! decreasing alignment, each time taking the one that needs the least padding. Fields that overlap (unions,
+//! expanded nested members) move as one block. Classes with fields of unknown size or alignment are skipped.
+//! Writes the proposed order and the bytes and cache lines saved per class.
+void WriteLayoutProposals(const LayoutModel& model, const HotFieldList& hotFields, LayoutReportFormat format, std::ostream& out);
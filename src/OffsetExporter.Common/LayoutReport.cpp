@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <fmt/format.h>
+#include "Json.h"
+#include "LayoutReport.h"
+
+namespace
+{
+
+constexpr uint64_t CACHE_LINE_SIZE = 64;
+constexpr uint64_t MAX_VPTR_SIZE = 8;
+constexpr uint32_t NO_FIELD = UINT32_MAX;
+
+struct Hole
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t after; //!< field that ends where the hole starts, NO_FIELD after the vtable pointer
+};
+
+struct ClassLayout
+{
+    uint64_t cacheLines = 0;
+    uint64_t holeBytes = 0;
+    uint64_t padding = 0;
+    LayoutModel::StringId missingBase = LayoutModel::NO_STRING; //!< first base that is not in the model
+    std::vector<Hole> holes;
+    std::vector<uint32_t> straddling;
+};
+
+ClassLayout AnalyzeClass(const LayoutModel& model, uint32_t cls)
+{
+    ClassLayout layout;
+    const uint64_t size = model.GetClassSize(cls);
+    layout.cacheLines = (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+
+    // Fields of the class and its bases. Bounded in case a class names itself as its base.
+    std::vector<uint32_t> fields;
+    bool isPolymorphic = false;
+    uint32_t c = cls;
+
+    for (uint32_t depth = 0; c != UINT32_MAX && depth < model.GetClassCount(); depth++)
+    {
+        LayoutModel::Range classFields = model.GetFields(c);
+
+        for (uint32_t i = classFields.begin; i < classFields.end; i++)
+            fields.push_back(i);
+
+        LayoutModel::Range vtable = model.GetVTable(c);
+        isPolymorphic |= vtable.begin != vtable.end;
+
+        LayoutModel::StringId base = model.GetBaseClass(c);
+        c = base != LayoutModel::NO_STRING ? model.FindClass(model.GetString(base)) : UINT32_MAX;
+
+        if (base != LayoutModel::NO_STRING && c == UINT32_MAX)
+            layout.missingBase = base;
+    }
+
+    std::stable_sort(fields.begin(), fields.end(), [&](uint32_t a, uint32_t b) { return model.GetFieldOffset(a) < model.GetFieldOffset(b); });
+
+    // Polymorphic classes start with the vtable pointer
+    uint64_t end = 0;
+
+    if (isPolymorphic)
+        end = std::min(fields.empty() ? size : model.GetFieldOffset(fields.front()), MAX_VPTR_SIZE);
+
+    // The fields of a base that is not in the model are unknown, so the layout starts at the first known field
+    bool isEndKnown = layout.missingBase == LayoutModel::NO_STRING;
+    uint32_t lastField = NO_FIELD;
+
+    for (uint32_t field : fields)
+    {
+        const uint64_t offset = model.GetFieldOffset(field);
+        const uint64_t fieldSize = model.GetFieldSize(field);
+
+        if (offset > end && isEndKnown)
+        {
+            layout.holes.push_back(Hole { end, offset - end, lastField });
+            layout.holeBytes += offset - end;
+        }
+
+        // Members of expanded nested fields and unions are inside the range covered so far
+        if (offset + fieldSize >= end)
+        {
+            end = offset + fieldSize;
+            isEndKnown = fieldSize != 0;
+            lastField = field;
+        }
+
+        if (fieldSize != 0 && fieldSize <= CACHE_LINE_SIZE && offset / CACHE_LINE_SIZE != (offset + fieldSize - 1) / CACHE_LINE_SIZE)
+            layout.straddling.push_back(field);
+    }
+
+    if (isEndKnown && size > end)
+        layout.padding = size - end;
+
+    return layout;
+}
+
+void WriteText(const LayoutModel& model, std::ostream& out)
+{
+    fmt::memory_buffer buf;
+    auto it = std::back_inserter(buf);
+    size_t holeCount = 0;
+    uint64_t holeBytes = 0;
+    size_t straddlingCount = 0;
+
+    for (uint32_t cls = 0; cls < model.GetClassCount(); cls++)
+    {
+        ClassLayout layout = AnalyzeClass(model, cls);
+        holeCount += layout.holes.size();
+        holeBytes += layout.holeBytes;
+        straddlingCount += layout.straddling.size();
+
+        fmt::format_to(it, "{}: {} bytes, {} cache lines, {} holes ({} bytes), {} bytes of tail padding\n",
+            model.GetString(model.GetClassName(cls)), model.GetClassSize(cls), layout.cacheLines,
+            layout.holes.size(), layout.holeBytes, layout.padding);
+
+        if (layout.missingBase != LayoutModel::NO_STRING)
+            fmt::format_to(it, "    base {} is not exported, its part of the layout is not analyzed\n", model.GetString(layout.missingBase));
+
+        for (const Hole& hole : layout.holes)
+        {
+            if (hole.after == NO_FIELD)
+            {
+                fmt::format_to(it, "    hole of {} bytes at 0x{:X} after the vtable pointer\n", hole.size, hole.offset);
+            }
+            else
+            {
+                fmt::format_to(it, "    hole of {} bytes at 0x{:X} after {} ({})\n", hole.size, hole.offset,
+                    model.GetString(model.GetFieldName(hole.after)), model.GetString(model.GetClassName(model.GetFieldClass(hole.after))));
+            }
+        }
+
+        for (uint32_t field : layout.straddling)
+        {
+            uint64_t offset = model.GetFieldOffset(field);
+            uint64_t size = model.GetFieldSize(field);
+
+            fmt::format_to(it, "    {} ({}) at 0x{:X}, {} bytes, straddles cache lines {} and {}\n",
+                model.GetString(model.GetFieldName(field)), model.GetString(model.GetClassName(model.GetFieldClass(field))),
+                offset, size, offset / CACHE_LINE_SIZE, (offset + size - 1) / CACHE_LINE_SIZE);
+        }
+    }
+
+    fmt::format_to(it, "{} classes, {} holes ({} bytes), {} straddling fields\n", model.GetClassCount(), holeCount, holeBytes, straddlingCount);
+    out.write(buf.data(), buf.size());
+}
+
+void WriteJson(const LayoutModel& model, std::ostream& out)
+{
+    fmt::memory_buffer buf;
+    auto it = std::back_inserter(buf);
+
+    fmt::format_to(it, "{{\"cacheLineSize\":{},\"classes\":[", CACHE_LINE_SIZE);
+
+    for (uint32_t cls = 0; cls < model.GetClassCount(); cls++)
+    {
+        ClassLayout layout = AnalyzeClass(model, cls);
+
+        if (cls != 0)
+            buf.push_back(',');
+
+        fmt::format_to(it, "{{\"name\":");
+        AppendJsonString(buf, model.GetString(model.GetClassName(cls)));
+        fmt::format_to(it, ",\"size\":{},\"cacheLines\":{},\"holeBytes\":{},\"padding\":{},\"missingBase\":",
+            model.GetClassSize(cls), layout.cacheLines, layout.holeBytes, layout.padding);
+
+        if (layout.missingBase == LayoutModel::NO_STRING)
+            fmt::format_to(it, "null");
+        else
+            AppendJsonString(buf, model.GetString(layout.missingBase));
+
+        fmt::format_to(it, ",\"holes\":[");
+
+        for (size_t i = 0; i < layout.holes.size(); i++)
+        {
+            const Hole& hole = layout.holes[i];
+
+            if (i != 0)
+                buf.push_back(',');
+
+            fmt::format_to(it, "{{\"offset\":{},\"size\":{},\"after\":", hole.offset, hole.size);
+
+            if (hole.after == NO_FIELD)
+            {
+                fmt::format_to(it, "null,\"afterClass\":null}}");
+            }
+            else
+            {
+                AppendJsonString(buf, model.GetString(model.GetFieldName(hole.after)));
+                fmt::format_to(it, ",\"afterClass\":");
+                AppendJsonString(buf, model.GetString(model.GetClassName(model.GetFieldClass(hole.after))));
+                buf.push_back('}');
+            }
+        }
+
+        fmt::format_to(it, "],\"straddling\":[");
+
+        for (size_t i = 0; i < layout.straddling.size(); i++)
+        {
+            uint32_t field = layout.straddling[i];
+            uint64_t offset = model.GetFieldOffset(field);
+            uint64_t size = model.GetFieldSize(field);
+
+            if (i != 0)
+                buf.push_back(',');
+
+            fmt::format_to(it, "{{\"name\":");
+            AppendJsonString(buf, model.GetString(model.GetFieldName(field)));
+            fmt::format_to(it, ",\"class\":");
+            AppendJsonString(buf, model.GetString(model.GetClassName(model.GetFieldClass(field))));
+            fmt::format_to(it, ",\"offset\":{},\"size\":{},\"firstCacheLine\":{},\"lastCacheLine\":{}}}",
+                offset, size, offset / CACHE_LINE_SIZE, (offset + size - 1) / CACHE_LINE_SIZE);
+        }
+
+        fmt::format_to(it, "]}}");
+    }
+
+    fmt::format_to(it, "]}}\n");
+    out.write(buf.data(), buf.size());
+}
+
+} // namespace
+
+bool ParseLayoutReportFormat(std::string_view name, LayoutReportFormat& format)
+{
+    if (name == "text")
+        format = LayoutReportFormat::Text;
+    else if (name == "json")
+        format = LayoutReportFormat::Json;
+    else
+        return false;
+
+    return true;
+}
+
+void WriteLayoutReport(const LayoutModel& model, LayoutReportFormat format, std::ostream& out)
+{
+    if (format == LayoutReportFormat::Json)
+        WriteJson(model, out);
+    else
+        WriteText(model, out);
+}
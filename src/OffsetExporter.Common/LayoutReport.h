@@ -0,0 +1,21 @@
+#pragma once
+#include <ostream>
+#include <string_view>
+#include "LayoutModel.h"
+
+enum class LayoutReportFormat
+{
+    Text,
+    Json,
+};
+
+//! Parses the name used by --layout-report-format. Returns false if unknown.
+bool ParseLayoutReportFormat(std::string_view name, LayoutReportFormat& format);
+
+//! Writes a pahole-like report of the memory layout of every class in the model: its size, the number of
+//! 64-byte cache lines it spans, padding holes between fields, tail padding and fields of up to 64 bytes that
+//! straddle a cache line boundary. Fields of bases in the model are part of the layout of derived classes.
+//! Gaps after fields of unknown size are not reported, the vtable pointer is assumed to be at most 8 bytes.
+//! If a base is not in the model, the report names it and starts the layout at the first known field,
+//! since the fields of that base are unknown.
+void WriteLayoutReport(const LayoutModel& model, LayoutReportFormat format, std::ostream& out);
@@ -0,0 +1,624 @@
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <fmt/format.h>
+#include "Json.h"
+#include "LayoutWriter.h"
+#include "OffsetsDbWriter.h"
+
+namespace
+{
+
+using ::AppendJsonString;
+
+void AppendJsonString(fmt::memory_buffer& buf, const LayoutModel& model, LayoutModel::StringId id)
+{
+    if (id == LayoutModel::NO_STRING)
+        fmt::format_to(std::back_inserter(buf), "null");
+    else
+        AppendJsonString(buf, model.GetString(id));
+}
+
+//! Identity of the binary as passed to LayoutWriter::Create.
+struct BinaryId
+{
+    LayoutModel::BinaryIdKind kind;
+    std::string id;
+};
+
+//! Appends {"kind":...,"id":...} or null if the binary is unknown.
+void AppendBinaryId(fmt::memory_buffer& buf, const BinaryId& binaryId)
+{
+    if (binaryId.kind == LayoutModel::BinaryIdKind::None)
+    {
+        fmt::format_to(std::back_inserter(buf), "null");
+        return;
+    }
+
+    fmt::format_to(std::back_inserter(buf), "{{\"kind\":\"{}\",\"id\":", LayoutModel::GetBinaryIdKindName(binaryId.kind));
+    AppendJsonString(buf, binaryId.id);
+    buf.push_back('}');
+}
+
+//! Appends the keys of a field object without the braces.
+void AppendFieldMembers(fmt::memory_buffer& buf, const LayoutModel& model, uint32_t field)
+{
+    auto out = std::back_inserter(buf);
+
+    fmt::format_to(out, "\"name\":");
+    AppendJsonString(buf, model, model.GetFieldName(field));
+    fmt::format_to(out, ",\"offset\":{},\"arraySize\":", model.GetFieldOffset(field));
+
+    if (model.GetFieldArraySize(field) == LayoutModel::NO_ARRAY_SIZE)
+        fmt::format_to(out, "null");
+    else
+        fmt::format_to(out, "{}", model.GetFieldArraySize(field));
+
+    fmt::format_to(out, ",\"type\":");
+    AppendJsonString(buf, model, model.GetFieldType(field));
+    fmt::format_to(out, ",\"amxxType\":");
+    AppendJsonString(buf, model, model.GetFieldAmxxType(field));
+
+    switch (model.GetFieldSignedness(field))
+    {
+    case LayoutModel::Signedness::Signed: fmt::format_to(out, ",\"unsigned\":false"); break;
+    case LayoutModel::Signedness::Unsigned: fmt::format_to(out, ",\"unsigned\":true"); break;
+    default: fmt::format_to(out, ",\"unsigned\":null"); break;
+    }
+}
+
+//! Appends the name, link name and RVA of a vtable entry without the braces.
+void AppendVirtualMethodMembers(fmt::memory_buffer& buf, const LayoutModel& model, uint32_t method)
+{
+    auto out = std::back_inserter(buf);
+
+    fmt::format_to(out, "\"name\":");
+    AppendJsonString(buf, model, model.GetVirtualMethodName(method));
+    fmt::format_to(out, ",\"linkName\":");
+    AppendJsonString(buf, model, model.GetVirtualMethodLinkName(method));
+
+    if (model.HasRva())
+    {
+        if (model.GetVirtualMethodRva(method) == LayoutModel::NO_RVA)
+            fmt::format_to(out, ",\"rva\":null");
+        else
+            fmt::format_to(out, ",\"rva\":{}", model.GetVirtualMethodRva(method));
+    }
+}
+
+//! Appends the members of a class object without the braces.
+void AppendClassMembers(fmt::memory_buffer& buf, const LayoutModel& model, uint32_t cls)
+{
+    auto out = std::back_inserter(buf);
+
+    fmt::format_to(out, "\"layoutHash\":\"{:016x}\",\"baseClass\":", model.GetLayoutHash(cls));
+    AppendJsonString(buf, model, model.GetBaseClass(cls));
+    fmt::format_to(out, ",\"fields\":[");
+
+    LayoutModel::Range fields = model.GetFields(cls);
+    bool hasNested = false;
+    bool isFirstField = true;
+
+    for (uint32_t i = fields.begin; i < fields.end; i++)
+    {
+        if (model.IsNestedField(i))
+        {
+            hasNested = true;
+            continue;
+        }
+
+        if (!isFirstField)
+            buf.push_back(',');
+
+        isFirstField = false;
+        buf.push_back('{');
+        AppendFieldMembers(buf, model, i);
+        buf.push_back('}');
+    }
+
+    buf.push_back(']');
+
+    if (hasNested)
+    {
+        // Members of aggregate fields from --expand-nested, overlapping the fields above
+        fmt::format_to(out, ",\"nested\":[");
+        isFirstField = true;
+
+        for (uint32_t i = fields.begin; i < fields.end; i++)
+        {
+            if (!model.IsNestedField(i))
+                continue;
+
+            if (!isFirstField)
+                buf.push_back(',');
+
+            isFirstField = false;
+            buf.push_back('{');
+            AppendFieldMembers(buf, model, i);
+            buf.push_back('}');
+        }
+
+        buf.push_back(']');
+    }
+
+    fmt::format_to(out, ",\"vtable\":[");
+
+    LayoutModel::Range vtable = model.GetVTable(cls);
+
+    for (uint32_t i = vtable.begin; i < vtable.end; i++)
+    {
+        if (i != vtable.begin)
+            buf.push_back(',');
+
+        buf.push_back('{');
+        AppendVirtualMethodMembers(buf, model, i);
+        fmt::format_to(out, ",\"index\":{}}}", model.GetVirtualMethodIndex(i));
+    }
+
+    buf.push_back(']');
+
+    if (model.IsVTableResolved(cls))
+    {
+        // Complete vtable, slots of bases that were not exported are left out
+        fmt::format_to(out, ",\"slots\":[");
+
+        LayoutModel::Range slots = model.GetResolvedVTable(cls);
+        bool isFirst = true;
+
+        for (uint32_t i = slots.begin; i < slots.end; i++)
+        {
+            uint32_t method = model.GetSlotMethod(i);
+
+            if (method == LayoutModel::NO_METHOD)
+                continue;
+
+            if (!isFirst)
+                buf.push_back(',');
+
+            isFirst = false;
+            uint32_t introClass = model.GetSlotIntroClass(i);
+            uint32_t implClass = model.GetVirtualMethodClass(method);
+
+            fmt::format_to(out, "{{\"index\":{},", i - slots.begin);
+            AppendVirtualMethodMembers(buf, model, method);
+            fmt::format_to(out, ",\"introducedBy\":");
+            AppendJsonString(buf, model, model.GetClassName(introClass));
+            fmt::format_to(out, ",\"overriddenBy\":");
+            AppendJsonString(buf, model, implClass != introClass ? model.GetClassName(implClass) : LayoutModel::NO_STRING);
+            buf.push_back('}');
+        }
+
+        buf.push_back(']');
+    }
+
+    if (!model.IsFlattened(cls))
+        return;
+
+    // Fields of the class and its bases with the class that declares them
+    fmt::format_to(out, ",\"flattened\":[");
+
+    LayoutModel::Range flattened = model.GetFlattenedFields(cls);
+
+    for (uint32_t i = flattened.begin; i < flattened.end; i++)
+    {
+        uint32_t field = model.GetFlattenedField(i);
+
+        if (i != flattened.begin)
+            buf.push_back(',');
+
+        fmt::format_to(out, "{{\"class\":");
+        AppendJsonString(buf, model, model.GetClassName(model.GetFieldClass(field)));
+        buf.push_back(',');
+        AppendFieldMembers(buf, model, field);
+        buf.push_back('}');
+    }
+
+    buf.push_back(']');
+}
+
+constexpr size_t FLUSH_THRESHOLD = 256 * 1024;
+
+//! {"classes":{"<name>":{...},...},"binary":{...}}
+class JsonLayoutWriter : public LayoutWriter
+{
+public:
+    JsonLayoutWriter(std::ostream& out, bool flushEachClass, BinaryId binaryId)
+        : m_out(out)
+        , m_flushEachClass(flushEachClass)
+        , m_binaryId(std::move(binaryId))
+    {
+        fmt::format_to(std::back_inserter(m_buf), "{{\"classes\":{{");
+    }
+
+    void WriteClass(const LayoutModel& model, uint32_t cls) override
+    {
+        if (m_classCount++ != 0)
+            m_buf.push_back(',');
+
+        AppendJsonString(m_buf, model, model.GetClassName(cls));
+        fmt::format_to(std::back_inserter(m_buf), ":{{");
+        AppendClassMembers(m_buf, model, cls);
+        m_buf.push_back('}');
+
+        if (m_flushEachClass || m_buf.size() >= FLUSH_THRESHOLD)
+            Flush();
+    }
+
+    void Finish() override
+    {
+        fmt::format_to(std::back_inserter(m_buf), "}},\"binary\":");
+        AppendBinaryId(m_buf, m_binaryId);
+        fmt::format_to(std::back_inserter(m_buf), "}}\n");
+        Flush();
+    }
+
+private:
+    std::ostream& m_out;
+    bool m_flushEachClass;
+    BinaryId m_binaryId;
+    fmt::memory_buffer m_buf;
+    size_t m_classCount = 0;
+
+    void Flush()
+    {
+        m_out.write(m_buf.data(), m_buf.size());
+        m_buf.clear();
+
+        if (m_flushEachClass)
+            m_out.flush();
+    }
+};
+
+//! One {"name":"<name>","binary":{...},...} object per line.
+class NdjsonLayoutWriter : public LayoutWriter
+{
+public:
+    NdjsonLayoutWriter(std::ostream& out, BinaryId binaryId)
+        : m_out(out)
+        , m_binaryId(std::move(binaryId))
+    {
+    }
+
+    void WriteClass(const LayoutModel& model, uint32_t cls) override
+    {
+        // Every line has the binary, so that lines can be consumed on their own
+        fmt::format_to(std::back_inserter(m_buf), "{{\"name\":");
+        AppendJsonString(m_buf, model, model.GetClassName(cls));
+        fmt::format_to(std::back_inserter(m_buf), ",\"binary\":");
+        AppendBinaryId(m_buf, m_binaryId);
+        m_buf.push_back(',');
+        AppendClassMembers(m_buf, model, cls);
+        fmt::format_to(std::back_inserter(m_buf), "}}\n");
+
+        // Readers consume lines as they arrive
+        m_out.write(m_buf.data(), m_buf.size());
+        m_out.flush();
+        m_buf.clear();
+    }
+
+    void Finish() override
+    {
+        m_out.flush();
+    }
+
+private:
+    std::ostream& m_out;
+    BinaryId m_binaryId;
+    fmt::memory_buffer m_buf;
+};
+
+//! Collects the classes and writes the database on Finish, since its tables are sorted and hashed.
+class BinaryLayoutWriter : public LayoutWriter
+{
+public:
+    BinaryLayoutWriter(std::ostream& out, BinaryId binaryId)
+        : m_out(out)
+        , m_binaryId(std::move(binaryId))
+    {
+    }
+
+    void WriteClass(const LayoutModel& model, uint32_t cls) override
+    {
+        m_model = &model;
+        m_classes.push_back(cls);
+    }
+
+    void Finish() override
+    {
+        // Without classes there is no model to take the binary id from
+        LayoutModel empty;
+        empty.SetBinaryId(m_binaryId.kind, m_binaryId.id);
+        WriteOffsetsDb(m_model ? *m_model : empty, m_classes, true, m_out);
+        m_out.flush();
+    }
+
+private:
+    std::ostream& m_out;
+    BinaryId m_binaryId;
+    const LayoutModel* m_model = nullptr;
+    std::vector<uint32_t> m_classes;
+};
+
+//! Writes every class to its own file plus a manifest.
+class ShardedLayoutWriter : public LayoutWriter
+{
+public:
+    ShardedLayoutWriter(OutputFormat format, const std::filesystem::path& dir, BinaryId binaryId)
+        : m_format(format)
+        , m_dir(dir)
+        , m_binaryId(std::move(binaryId))
+    {
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void WriteClass(const LayoutModel& model, uint32_t cls) override
+    {
+        // Serialization waits for Finish so that it can run on all cores
+        m_model = &model;
+        m_shards.push_back({ cls, MakeFileName(model.GetString(model.GetClassName(cls))) });
+    }
+
+    void Finish() override
+    {
+        WriteShards();
+        WriteManifest();
+        size_t removedCount = RemoveStaleShards();
+        fmt::println("Wrote {} of {} shards to {}, removed {} stale shards", m_writtenCount.load(), m_shards.size(), m_dir.string(), removedCount);
+    }
+
+private:
+    struct Shard
+    {
+        uint32_t cls;
+        std::string fileName;
+        size_t size = 0;
+        uint64_t hash = 0;
+    };
+
+    OutputFormat m_format;
+    std::filesystem::path m_dir;
+    BinaryId m_binaryId;
+    const LayoutModel* m_model = nullptr;
+    std::vector<Shard> m_shards;
+    std::unordered_set<std::string> m_usedFileNames;
+    std::atomic<size_t> m_writtenCount = 0;
+
+    //! Class names may contain characters that are not allowed in file names, and NTFS is case-insensitive.
+    std::string MakeFileName(std::string_view className)
+    {
+        std::string base;
+
+        for (char c : className)
+        {
+            bool isSafe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            base.push_back(isSafe ? c : '_');
+        }
+
+        const std::string_view extension = m_format == OutputFormat::Bin ? ".bin" : ".json";
+        std::string name = fmt::format("{}{}", base, extension);
+
+        for (int i = 1; !m_usedFileNames.insert(ToLower(name)).second; i++)
+            name = fmt::format("{}_{}{}", base, i, extension);
+
+        return name;
+    }
+
+    static std::string ToLower(std::string str)
+    {
+        for (char& c : str)
+        {
+            if (c >= 'A' && c <= 'Z')
+                c = c - 'A' + 'a';
+        }
+
+        return str;
+    }
+
+    //! FNV-1a, 64-bit.
+    static uint64_t HashContent(std::string_view data)
+    {
+        uint64_t hash = 14695981039346656037ull;
+
+        for (char c : data)
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+
+        return hash;
+    }
+
+    void WriteShards()
+    {
+        std::atomic<size_t> next = 0;
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+
+        auto worker = [&]() {
+            std::string content;
+
+            for (size_t i = next++; i < m_shards.size(); i = next++)
+            {
+                try
+                {
+                    Shard& shard = m_shards[i];
+                    Serialize(shard.cls, content);
+                    shard.size = content.size();
+                    shard.hash = HashContent(content);
+
+                    if (WriteIfChanged(m_dir / shard.fileName, content))
+                        m_writtenCount++;
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(errorMutex);
+
+                    if (!firstError)
+                        firstError = std::current_exception();
+                }
+            }
+        };
+
+        size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), m_shards.size());
+        std::vector<std::thread> threads;
+
+        for (size_t i = 1; i < threadCount; i++)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        if (firstError)
+            std::rethrow_exception(firstError);
+    }
+
+    void Serialize(uint32_t cls, std::string& content) const
+    {
+        if (m_format == OutputFormat::Bin)
+        {
+            std::ostringstream stream(std::ios::out | std::ios::binary);
+            // Shards stay unchanged across builds with the same layout, the binary is in the manifest
+            WriteOffsetsDb(*m_model, { cls }, false, stream);
+            content = std::move(stream).str();
+        }
+        else
+        {
+            fmt::memory_buffer buf;
+            fmt::format_to(std::back_inserter(buf), "{{\"name\":");
+            AppendJsonString(buf, *m_model, m_model->GetClassName(cls));
+            buf.push_back(',');
+            AppendClassMembers(buf, *m_model, cls);
+            fmt::format_to(std::back_inserter(buf), "}}\n");
+            content.assign(buf.data(), buf.size());
+        }
+    }
+
+    //! Returns false if the file already has this content. Keeping its mtime lets incremental builds skip it.
+    static bool WriteIfChanged(const std::filesystem::path& path, std::string_view content)
+    {
+        std::error_code ec;
+
+        if (std::filesystem::file_size(path, ec) == content.size() && !ec)
+        {
+            std::ifstream existing(path, std::ios::in | std::ios::binary);
+            std::string existingContent(content.size(), '\0');
+
+            if (existing.read(existingContent.data(), existingContent.size()) && existingContent == content)
+                return false;
+        }
+
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        file.write(content.data(), content.size());
+
+        if (!file)
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+
+        return true;
+    }
+
+    //! Removes shards of earlier runs that are not in the manifest, e.g. of classes that are no longer exported.
+    //! Any .json or .bin file other than the manifest is a shard, since the directory belongs to the exporter.
+    size_t RemoveStaleShards() const
+    {
+        size_t removedCount = 0;
+
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_dir))
+        {
+            const std::filesystem::path& path = entry.path();
+            const std::string fileName = path.filename().string();
+            const bool isShard = path.extension() == ".json" || path.extension() == ".bin";
+
+            if (!entry.is_regular_file() || !isShard || fileName == "manifest.json" || m_usedFileNames.contains(ToLower(fileName)))
+                continue;
+
+            std::filesystem::remove(path);
+            removedCount++;
+        }
+
+        return removedCount;
+    }
+
+    void WriteManifest() const
+    {
+        fmt::memory_buffer buf;
+        auto out = std::back_inserter(buf);
+
+        fmt::format_to(out, "{{\"format\":\"{}\",\"binary\":", m_format == OutputFormat::Bin ? "bin" : "ndjson");
+        AppendBinaryId(buf, m_binaryId);
+        fmt::format_to(out, ",\"classes\":[");
+
+        for (size_t i = 0; i < m_shards.size(); i++)
+        {
+            const Shard& shard = m_shards[i];
+
+            if (i != 0)
+                buf.push_back(',');
+
+            fmt::format_to(out, "{{\"name\":");
+            AppendJsonString(buf, *m_model, m_model->GetClassName(shard.cls));
+            fmt::format_to(out, ",\"baseClass\":");
+            AppendJsonString(buf, *m_model, m_model->GetBaseClass(shard.cls));
+            fmt::format_to(out, ",\"file\":");
+            AppendJsonString(buf, shard.fileName);
+            fmt::format_to(out, ",\"size\":{},\"hash\":\"{:016x}\"}}", shard.size, shard.hash);
+        }
+
+        fmt::format_to(out, "]}}\n");
+
+        std::ofstream file(m_dir / "manifest.json", std::ios::out | std::ios::binary);
+        file.write(buf.data(), buf.size());
+
+        if (!file)
+            throw std::runtime_error(fmt::format("Failed to write {}", (m_dir / "manifest.json").string()));
+    }
+};
+
+} // namespace
+
+bool ParseOutputFormat(std::string_view name, OutputFormat& format)
+{
+    if (name == "json")
+        format = OutputFormat::Json;
+    else if (name == "ndjson")
+        format = OutputFormat::Ndjson;
+    else if (name == "bin")
+        format = OutputFormat::Bin;
+    else
+        return false;
+
+    return true;
+}
+
+std::ios::openmode GetOutputOpenMode(OutputFormat format)
+{
+    return format == OutputFormat::Bin ? std::ios::out | std::ios::binary : std::ios::out;
+}
+
+std::unique_ptr<LayoutWriter> LayoutWriter::Create(OutputFormat format, std::ostream& out, LayoutModel::BinaryIdKind binaryIdKind, std::string_view binaryId)
+{
+    BinaryId id { binaryIdKind, std::string(binaryId) };
+
+    switch (format)
+    {
+    case OutputFormat::Json:
+        return std::make_unique<JsonLayoutWriter>(out, true, std::move(id));
+    case OutputFormat::Ndjson:
+        return std::make_unique<NdjsonLayoutWriter>(out, std::move(id));
+    case OutputFormat::Bin:
+        return std::make_unique<BinaryLayoutWriter>(out, std::move(id));
+    default:
+        throw std::logic_error("Unknown output format");
+    }
+}
+
+std::unique_ptr<LayoutWriter> LayoutWriter::CreateSharded(OutputFormat format, const std::filesystem::path& dir, LayoutModel::BinaryIdKind binaryIdKind, std::string_view binaryId)
+{
+    return std::make_unique<ShardedLayoutWriter>(format, dir, BinaryId { binaryIdKind, std::string(binaryId) });
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include "LayoutModel.h"
+
+enum class OutputFormat
+{
+    Json,   //!< test-data/json-format.json
+    Ndjson, //!< one {"name": ..., "binary": ..., <class object>} per line
+    Bin,    //!< OffsetsDb.h, written once all classes are known
+};
+
+//! Parses the name used by --format. Returns false if unknown.
+bool ParseOutputFormat(std::string_view name, OutputFormat& format);
+
+//! Mode the output file has to be opened with.
+std::ios::openmode GetOutputOpenMode(OutputFormat format);
+
+//! Writes classes to a stream as they are extracted. Text formats buffer at most one class,
+//! so consumers can read the output while the exporter is still running.
+class LayoutWriter
+{
+public:
+    virtual ~LayoutWriter() = default;
+
+    //! Writes a class of the model and flushes the stream. The model must outlive the writer.
+    virtual void WriteClass(const LayoutModel& model, uint32_t cls) = 0;
+
+    //! Writes whatever follows the last class. Must be called once.
+    virtual void Finish() = 0;
+
+    //! The binary id is written even if no class is, so it is passed here instead of taken from the model.
+    static std::unique_ptr<LayoutWriter> Create(OutputFormat format, std::ostream& out, LayoutModel::BinaryIdKind binaryIdKind, std::string_view binaryId);
+
+    //! Creates a writer for --out-dir. Each class goes to its own shard: the NDJSON line for text formats,
+    //! a single-class database for bin. Shards are serialized and written in parallel on Finish, together
+    //! with manifest.json that lists the binary and the name, base class, file and content hash of every shard.
+    //! Shards whose content didn't change are not rewritten, files of shards that are not in the manifest are removed.
+    static std::unique_ptr<LayoutWriter> CreateSharded(OutputFormat format, const std::filesystem::path& dir, LayoutModel::BinaryIdKind binaryIdKind, std::string_view binaryId);
+};
@@ -0,0 +1,328 @@
+// Copyright 2011-2022, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+#include "MemoryMappedFile.h"
+
+namespace
+{
+
+struct IoStrategyName
+{
+	MemoryMappedFile::IoStrategy strategy;
+	const char* name;
+};
+
+constexpr IoStrategyName IO_STRATEGY_NAMES[] = {
+	{ MemoryMappedFile::IoStrategy::Mmap, "mmap" },
+	{ MemoryMappedFile::IoStrategy::Populate, "populate" },
+	{ MemoryMappedFile::IoStrategy::Madvise, "madvise" },
+	{ MemoryMappedFile::IoStrategy::HugePages, "hugepages" },
+	{ MemoryMappedFile::IoStrategy::Read, "read" },
+};
+
+#ifdef _WIN32
+void* ReadIntoBuffer(void* file, size_t fileSize)
+{
+	void* buffer = VirtualAlloc(nullptr, std::max<size_t>(fileSize, 1), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+	if (buffer == nullptr)
+		return nullptr;
+
+	size_t offset = 0;
+
+	while (offset < fileSize)
+	{
+		DWORD chunkSize = static_cast<DWORD>(std::min<size_t>(fileSize - offset, 1u << 30));
+		DWORD bytesRead = 0;
+
+		if (!ReadFile(file, static_cast<char*>(buffer) + offset, chunkSize, &bytesRead, nullptr) || bytesRead == 0)
+		{
+			VirtualFree(buffer, 0, MEM_RELEASE);
+			return nullptr;
+		}
+
+		offset += bytesRead;
+	}
+
+	return buffer;
+}
+#else
+void* ReadIntoBuffer(int file, size_t fileSize, bool hugePages)
+{
+	void* buffer = mmap(nullptr, std::max<size_t>(fileSize, 1), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (buffer == MAP_FAILED)
+		return nullptr;
+
+#ifdef MADV_HUGEPAGE
+	// Must be set before the pages are first touched by pread
+	if (hugePages)
+		madvise(buffer, fileSize, MADV_HUGEPAGE);
+#else
+	(void)hugePages;
+#endif
+
+	size_t offset = 0;
+
+	while (offset < fileSize)
+	{
+		ssize_t bytesRead = pread(file, static_cast<char*>(buffer) + offset, fileSize - offset, static_cast<off_t>(offset));
+
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+
+		if (bytesRead <= 0)
+		{
+			munmap(buffer, std::max<size_t>(fileSize, 1));
+			return nullptr;
+		}
+
+		offset += static_cast<size_t>(bytesRead);
+	}
+
+	// The buffer is never written to after this
+	mprotect(buffer, std::max<size_t>(fileSize, 1), PROT_READ);
+	return buffer;
+}
+#endif
+
+} // namespace
+
+bool MemoryMappedFile::ParseIoStrategy(std::string_view name, IoStrategy& strategy)
+{
+	for (const IoStrategyName& i : IO_STRATEGY_NAMES)
+	{
+		if (name == i.name)
+		{
+			strategy = i.strategy;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* MemoryMappedFile::GetIoStrategyName(IoStrategy strategy)
+{
+	for (const IoStrategyName& i : IO_STRATEGY_NAMES)
+	{
+		if (strategy == i.strategy)
+			return i.name;
+	}
+
+	return "unknown";
+}
+
+MemoryMappedFile::Handle MemoryMappedFile::Open(const char* path, IoStrategy strategy)
+{
+#ifdef _WIN32
+	void* file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return Handle { INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, nullptr, 0 };
+	}
+
+	LARGE_INTEGER fileSizeInfo;
+	if (!GetFileSizeEx(file, &fileSizeInfo))
+	{
+		CloseHandle(file);
+
+		return Handle { INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, nullptr, 0 };
+	}
+
+	const size_t fileSize = static_cast<size_t>(fileSizeInfo.QuadPart);
+
+	void* fileMapping = nullptr;
+	void* baseAddress = nullptr;
+
+	if (strategy != IoStrategy::Read && strategy != IoStrategy::HugePages)
+	{
+		fileMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (fileMapping != nullptr)
+		{
+			baseAddress = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+
+			if (baseAddress == nullptr)
+			{
+				CloseHandle(fileMapping);
+				fileMapping = nullptr;
+			}
+		}
+	}
+
+	if (baseAddress == nullptr)
+	{
+		// Requested or mapping failed
+		baseAddress = ReadIntoBuffer(file, fileSize);
+
+		if (baseAddress == nullptr)
+		{
+			CloseHandle(file);
+
+			return Handle { INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, nullptr, 0 };
+		}
+
+		return Handle { file, nullptr, baseAddress, fileSize, true };
+	}
+
+	return Handle { file, fileMapping, baseAddress, fileSize };
+#else
+	int file = open(path, O_RDONLY);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return Handle { INVALID_HANDLE_VALUE, nullptr, 0 };
+	}
+
+	return Adopt(file, strategy);
+#endif
+}
+
+
+#ifndef _WIN32
+MemoryMappedFile::Handle MemoryMappedFile::Adopt(int file, IoStrategy strategy)
+{
+	struct stat fileSb;
+
+	if (fstat(file, &fileSb) == -1)
+	{
+		close(file);
+
+		return Handle { INVALID_HANDLE_VALUE, nullptr, 0 };
+	}
+
+	const size_t fileSize = static_cast<size_t>(fileSb.st_size);
+	void* baseAddress = MAP_FAILED;
+
+	if (strategy != IoStrategy::Read && strategy != IoStrategy::HugePages)
+	{
+		int flags = MAP_PRIVATE;
+
+#ifdef MAP_POPULATE
+		if (strategy == IoStrategy::Populate)
+			flags |= MAP_POPULATE;
+#endif
+
+		baseAddress = mmap(nullptr, fileSize, PROT_READ, flags, file, 0);
+
+		if (baseAddress != MAP_FAILED && strategy == IoStrategy::Madvise)
+		{
+			madvise(baseAddress, fileSize, MADV_WILLNEED);
+			madvise(baseAddress, fileSize, MADV_SEQUENTIAL);
+		}
+	}
+
+	if (baseAddress == MAP_FAILED)
+	{
+		// Requested or mapping failed
+		baseAddress = ReadIntoBuffer(file, fileSize, strategy == IoStrategy::HugePages);
+
+		if (baseAddress == nullptr)
+		{
+			close(file);
+
+			return Handle { INVALID_HANDLE_VALUE, nullptr, 0 };
+		}
+
+		return Handle { file, baseAddress, fileSize, true };
+	}
+
+	return Handle { file, baseAddress, fileSize };
+}
+#endif
+
+
+void MemoryMappedFile::Close(Handle& handle)
+{
+#ifdef _WIN32
+	if (handle.isBuffer)
+	{
+		VirtualFree(handle.baseAddress, 0, MEM_RELEASE);
+	}
+	else
+	{
+		UnmapViewOfFile(handle.baseAddress);
+		CloseHandle(handle.fileMapping);
+	}
+
+	if (handle.file != INVALID_HANDLE_VALUE)
+		CloseHandle(handle.file);
+
+	handle.file = nullptr;
+	handle.fileMapping = nullptr;
+#else
+	munmap(handle.baseAddress, handle.isBuffer ? std::max<size_t>(handle.len, 1) : handle.len);
+	close(handle.file);
+
+	handle.file = 0;
+#endif
+
+	handle.baseAddress = nullptr;
+}
+
+MemoryMappedFile::Handle::~Handle()
+{
+	if (file)
+		Close(*this);
+}
+
+size_t MemoryMappedFile::GetPageCount(const Handle& handle)
+{
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	const size_t pageSize = systemInfo.dwPageSize;
+#else
+	const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+	return (handle.len + pageSize - 1) / pageSize;
+}
+
+size_t MemoryMappedFile::GetResidentPageCount(const Handle& handle)
+{
+#ifdef _WIN32
+	(void)handle;
+	return 0;
+#else
+	std::vector<unsigned char> residency(GetPageCount(handle));
+
+	if (mincore(handle.baseAddress, handle.len, residency.data()) != 0)
+		return 0;
+
+	size_t residentCount = 0;
+
+	for (unsigned char page : residency)
+		residentCount += page & 1;
+
+	return residentCount;
+#endif
+}
+
+bool MemoryMappedFile::EvictFromPageCache(const char* path)
+{
+#if defined(_WIN32) || !defined(POSIX_FADV_DONTNEED)
+	(void)path;
+	return false;
+#else
+	int file = open(path, O_RDONLY);
+
+	if (file == -1)
+		return false;
+
+	// Only clean pages are dropped, which is all of them for a file we never write
+	bool result = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(file);
+	return result;
+#endif
+}
@@ -0,0 +1,72 @@
+// Copyright 2011-2022, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define INVALID_HANDLE_VALUE ((long)-1)
+#endif
+
+namespace MemoryMappedFile
+{
+	// How the contents of the file are brought into memory.
+	enum class IoStrategy
+	{
+		Mmap,		// plain mmap, every page is faulted in on first touch
+		Populate,	// mmap with MAP_POPULATE, all pages are faulted in up front
+		Madvise,	// mmap with madvise(MADV_WILLNEED) and madvise(MADV_SEQUENTIAL)
+		HugePages,	// read into an anonymous buffer backed by transparent huge pages
+		Read,		// read into an anonymous buffer
+
+		Count
+	};
+
+	// Parses the name used by --io. Returns false if unknown.
+	bool ParseIoStrategy(std::string_view name, IoStrategy& strategy);
+	const char* GetIoStrategyName(IoStrategy strategy);
+
+	struct Handle
+	{
+#ifdef _WIN32
+		void* file;
+		void* fileMapping;
+#else
+		int   file;
+#endif
+		void* baseAddress;
+		size_t len;
+
+		// baseAddress is a buffer the file was read into instead of a mapping of the file
+		bool isBuffer = false;
+
+		~Handle();
+	};
+
+	// Opens a file using the given strategy. Strategies not supported by the platform use plain mmap.
+	// Falls back to reading into a buffer if the file can't be mapped.
+	Handle Open(const char* path, IoStrategy strategy = IoStrategy::Mmap);
+
+#ifndef _WIN32
+	// Same as Open for a file descriptor that is already open, e.g. a memfd. Takes ownership of it.
+	Handle Adopt(int file, IoStrategy strategy = IoStrategy::Mmap);
+#endif
+	void Close(Handle& handle);
+
+	// Returns the number of pages spanned by the mapping.
+	size_t GetPageCount(const Handle& handle);
+
+	// Returns the number of pages of the mapping that are resident in memory, or 0 if unsupported.
+	// On a cold page cache this is the number of pages touched so far.
+	size_t GetResidentPageCount(const Handle& handle);
+
+	// Drops the cached pages of a file so that the next access is a cold read. Returns false if unsupported.
+	bool EvictFromPageCache(const char* path);
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <fmt/format.h>
+#include "NameIndex.h"
+
+namespace
+{
+
+uint32_t AlignTo8(size_t value)
+{
+    return static_cast<uint32_t>((value + 7) & ~size_t(7));
+}
+
+} // namespace
+
+std::filesystem::path NameIndex::GetPath(const std::filesystem::path& dir, LayoutModel::BinaryIdKind kind, std::string_view id)
+{
+    return dir / fmt::format("{}-{}.idx", LayoutModel::GetBinaryIdKindName(kind), id);
+}
+
+void NameIndex::Builder::Add(std::string_view name, uint64_t location, uint64_t unit)
+{
+    m_entries.try_emplace(std::string(name), Entry { 0, 0, location, unit });
+}
+
+void NameIndex::Builder::Save(const std::filesystem::path& path) const
+{
+    std::vector<std::pair<std::string_view, Entry>> sorted;
+    sorted.reserve(m_entries.size());
+
+    for (const auto& [name, entry] : m_entries)
+        sorted.emplace_back(name, entry);
+
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::string strings;
+    std::vector<Entry> entries;
+    entries.reserve(sorted.size());
+
+    for (auto& [name, entry] : sorted)
+    {
+        entry.nameOffset = static_cast<uint32_t>(strings.size());
+        entry.nameLength = static_cast<uint32_t>(name.size());
+        strings.append(name);
+        strings.push_back('\0');
+        entries.push_back(entry);
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.entryTableOffset = AlignTo8(sizeof(Header));
+    header.stringPoolOffset = AlignTo8(header.entryTableOffset + entries.size() * sizeof(Entry));
+    header.stringPoolSize = static_cast<uint32_t>(strings.size());
+    header.fileSize = AlignTo8(static_cast<size_t>(header.stringPoolOffset) + strings.size());
+
+    std::string file(header.fileSize, '\0');
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    if (!entries.empty())
+        std::memcpy(file.data() + header.entryTableOffset, entries.data(), entries.size() * sizeof(Entry));
+
+    if (!strings.empty())
+        std::memcpy(file.data() + header.stringPoolOffset, strings.data(), strings.size());
+
+    // Parallel runs may build the same index, any of the complete files can win
+    std::filesystem::path temp = path;
+    temp += fmt::format(".tmp{:08x}", std::random_device()());
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    {
+        std::ofstream out(temp, std::ios::out | std::ios::binary);
+        out.write(file.data(), file.size());
+        out.close();
+
+        if (!out)
+        {
+            fmt::println("Failed to write name index {}", temp.string());
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temp, path, ec);
+
+    if (ec)
+    {
+        fmt::println("Failed to save name index {}: {}", path.string(), ec.message());
+        std::filesystem::remove(temp, ec);
+        return;
+    }
+
+    fmt::println("Saved name index {} with {} classes", path.string(), entries.size());
+}
+
+bool NameIndex::Reader::Open(const std::filesystem::path& path)
+{
+    m_header = nullptr;
+    m_file.reset();
+
+    std::error_code ec;
+
+    if (!std::filesystem::is_regular_file(path, ec))
+        return false;
+
+    // Constructed in place, since a copy of the handle would unmap the file when destroyed
+    std::unique_ptr<MemoryMappedFile::Handle> file(new MemoryMappedFile::Handle(MemoryMappedFile::Open(path.string().c_str())));
+    const uint8_t* data = static_cast<const uint8_t*>(file->baseAddress);
+    size_t size = file->len;
+
+    if (!data || size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+        return false;
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION || header->fileSize > size)
+        return false;
+
+    if (header->entryTableOffset % 8 != 0 || header->entryTableOffset > header->fileSize ||
+        header->entryCount > (header->fileSize - header->entryTableOffset) / sizeof(Entry) ||
+        header->stringPoolOffset > header->fileSize || header->stringPoolSize > header->fileSize - header->stringPoolOffset)
+        return false;
+
+    // Names are used without checks afterwards
+    const Entry* entries = reinterpret_cast<const Entry*>(data + header->entryTableOffset);
+
+    for (uint32_t i = 0; i < header->entryCount; i++)
+    {
+        if (entries[i].nameOffset > header->stringPoolSize || entries[i].nameLength > header->stringPoolSize - entries[i].nameOffset)
+            return false;
+    }
+
+    m_file = std::move(file);
+    m_header = header;
+    m_entries = entries;
+    m_strings = reinterpret_cast<const char*>(data + header->stringPoolOffset);
+    return true;
+}
+
+const NameIndex::Entry* NameIndex::Reader::Find(std::string_view name) const
+{
+    const Entry* end = m_entries + m_header->entryCount;
+    const Entry* it = std::lower_bound(m_entries, end, name, [&](const Entry& entry, std::string_view value) { return GetName(entry) < value; });
+
+    if (it == end || GetName(*it) != name)
+        return nullptr;
+
+    return it;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "LayoutModel.h"
+#include "MemoryMappedFile.h"
+
+//! Memory-mappable index of the class definitions of one binary, saved by the exporters in
+//! --name-index-dir on the first run. Later runs look up the classes of the class list in it
+//! instead of scanning the debug info for their definitions.
+//!
+//! The file is named after the build-id or PDB GUID and age, which identify the debug info, so an
+//! index never goes stale. It is written to a temporary file and renamed into place.
+//!
+//! Layout (little-endian, every table 8-byte aligned):
+//!   Header
+//!   Entry[entryCount]         sorted by name, one per name
+//!   char[stringPoolSize]      NUL-terminated names
+namespace NameIndex
+{
+
+constexpr char MAGIC[8] = { 'A', 'M', 'X', 'N', 'A', 'M', 'E', 'S' };
+constexpr uint32_t VERSION = 1;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t fileSize;
+    uint32_t entryTableOffset;
+    uint32_t stringPoolOffset;
+    uint32_t stringPoolSize;
+};
+
+struct Entry
+{
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint64_t location; //!< DIE offset (DWARF) or type index (PDB) of the first definition
+    uint64_t unit;     //!< offset of the DIE of its compile unit (DWARF), 0 for PDB
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(Entry) == 24);
+
+//! <dir>/<kind>-<id>.idx
+std::filesystem::path GetPath(const std::filesystem::path& dir, LayoutModel::BinaryIdKind kind, std::string_view id);
+
+class Builder
+{
+public:
+    //! Definitions are added in the order of the debug info. Only the first one of a name is kept.
+    void Add(std::string_view name, uint64_t location, uint64_t unit);
+
+    size_t GetCount() const { return m_entries.size(); }
+
+    //! Failures are printed, not thrown, since the run doesn't depend on the index.
+    void Save(const std::filesystem::path& path) const;
+
+private:
+    std::unordered_map<std::string, Entry> m_entries; //!< nameOffset and nameLength are set on Save
+};
+
+class Reader
+{
+public:
+    //! Maps and validates the file. Returns false if it doesn't exist or is not a valid index.
+    bool Open(const std::filesystem::path& path);
+
+    bool IsOpen() const { return m_header != nullptr; }
+    uint32_t GetCount() const { return m_header->entryCount; }
+
+    //! Returns nullptr if the binary has no definition of the class.
+    const Entry* Find(std::string_view name) const;
+
+private:
+    std::unique_ptr<MemoryMappedFile::Handle> m_file;
+    const Header* m_header = nullptr;
+    const Entry* m_entries = nullptr;
+    const char* m_strings = nullptr;
+
+    std::string_view GetName(const Entry& entry) const { return std::string_view(m_strings + entry.nameOffset, entry.nameLength); }
+};
+
+} // namespace NameIndex
@@ -0,0 +1,16 @@
+#include "NestedLayouts.h"
+
+void NestedLayouts::AddMember(const LayoutModel::FieldDesc& field, NestedType nestedType)
+{
+    Member member;
+    member.name = m_strings.Add(field.name);
+    member.type = m_strings.Add(field.type);
+    member.amxxType = m_strings.Add(field.amxxType);
+    member.offset = field.offset;
+    member.arraySize = field.arraySize;
+    member.size = field.size;
+    member.alignment = field.alignment;
+    member.signedness = field.signedness;
+    member.nestedType = nestedType;
+    m_members.push_back(member);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+#include "LayoutModel.h"
+#include "StringPool.h"
+
+//! Member layouts of aggregate types for --expand-nested.
+//! The direct members of a type are decoded once, keyed by the exporter's handle of the type (DIE offset,
+//! type index), and reused for every member of that type in any class and at any depth.
+class NestedLayouts
+{
+public:
+    static constexpr uint64_t NO_TYPE = UINT64_MAX;
+
+    //! Aggregate type of a member. For arrays, the element type.
+    struct NestedType
+    {
+        uint64_t key = NO_TYPE;
+        uint64_t elementSize = 0; //!< distance between array elements
+    };
+
+    //! maxDepth is the number of levels below the class member that are expanded.
+    explicit NestedLayouts(int maxDepth)
+        : m_maxDepth(maxDepth)
+    {
+    }
+
+    //! Adds a member of the type being decoded. Called by the decode function passed to Expand.
+    void AddMember(const LayoutModel::FieldDesc& field, NestedType nestedType);
+
+    //! Adds a model field for every member of an aggregate field, recursively up to the depth limit.
+    //! Names are paths like "m_dpv.preset" or "m_Route[2].vecLocation" and offsets are absolute.
+    //! decode(key) describes the direct members of a type not seen before with AddMember.
+    template <typename T>
+    void Expand(LayoutModel& model, const LayoutModel::FieldDesc& field, NestedType nestedType, T&& decode)
+    {
+        if (nestedType.key != NO_TYPE)
+            Expand(model, field.name, field.offset, field.arraySize, nestedType, 1, decode);
+    }
+
+    size_t GetTypeCount() const { return m_types.size(); }
+
+private:
+    struct Member
+    {
+        StringPool::Id name;
+        StringPool::Id type;
+        StringPool::Id amxxType;
+        uint64_t offset;
+        uint64_t arraySize;
+        uint64_t size;
+        uint32_t alignment;
+        LayoutModel::Signedness signedness;
+        NestedType nestedType;
+    };
+
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    int m_maxDepth;
+    StringPool m_strings;
+    std::vector<Member> m_members;
+    std::unordered_map<uint64_t, Range> m_types;
+
+    template <typename T>
+    Range GetMembers(uint64_t key, T&& decode)
+    {
+        auto it = m_types.find(key);
+
+        if (it != m_types.end())
+            return it->second;
+
+        // Members of one type are contiguous, decode doesn't recurse
+        uint32_t begin = static_cast<uint32_t>(m_members.size());
+        decode(key);
+        Range range { begin, static_cast<uint32_t>(m_members.size()) };
+        m_types.emplace(key, range);
+        return range;
+    }
+
+    template <typename T>
+    void Expand(LayoutModel& model, std::string_view path, uint64_t offset, uint64_t arraySize, NestedType nestedType, int depth, T&& decode)
+    {
+        if (depth > m_maxDepth)
+            return;
+
+        if (arraySize != LayoutModel::NO_ARRAY_SIZE)
+        {
+            // Elements are expanded at the same depth as the array
+            for (uint64_t i = 0; i < arraySize; i++)
+                Expand(model, fmt::format("{}[{}]", path, i), offset + i * nestedType.elementSize, LayoutModel::NO_ARRAY_SIZE, nestedType, depth, decode);
+
+            return;
+        }
+
+        Range members = GetMembers(nestedType.key, decode);
+
+        for (uint32_t i = members.begin; i < members.end; i++)
+        {
+            // m_members may grow while expanding deeper levels
+            Member member = m_members[i];
+            std::string memberPath = fmt::format("{}.{}", path, m_strings.Get(member.name));
+
+            LayoutModel::FieldDesc field;
+            field.name = memberPath;
+            field.offset = offset + member.offset;
+            field.arraySize = member.arraySize;
+            field.size = member.size;
+            field.alignment = member.alignment;
+            field.type = m_strings.Get(member.type);
+            field.amxxType = m_strings.Get(member.amxxType);
+            field.signedness = member.signedness;
+            model.AddNestedField(field);
+
+            if (member.nestedType.key != NO_TYPE)
+                Expand(model, memberPath, field.offset, member.arraySize, member.nestedType, depth + 1, decode);
+        }
+    }
+};
@@ -0,0 +1,345 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+//! Memory-mappable offsets database written by `--format bin`.
+//!
+//! This header is self-contained and can be copied into other projects. The reader validates the
+//! header and table bounds once in Open and never parses or allocates afterwards.
+//!
+//! Layout (little-endian, every table 8-byte aligned):
+//!   Header
+//!   ClassEntry[classCount]          sorted by name
+//!   FieldEntry[fieldCount]          fields of a class are contiguous
+//!   VirtualMethodEntry[vmCount]     vtable entries of a class are contiguous
+//!   Bucket[bucketCount]             open-addressing hash of (class, member) -> entry
+//!   char[stringPoolSize]            NUL-terminated strings referenced by StringRef
+namespace OffsetsDb
+{
+
+static_assert(std::endian::native == std::endian::little, "OffsetsDb is read in place and requires a little-endian host");
+
+constexpr char MAGIC[8] = { 'A', 'M', 'X', 'O', 'F', 'F', 'D', 'B' };
+//! 2: binaryId in the header, layoutHash in ClassEntry.
+constexpr uint32_t VERSION = 2;
+
+//! Absent index, string or value.
+constexpr uint32_t NONE = UINT32_MAX;
+
+enum HeaderFlags : uint32_t
+{
+    //! Vtable entries have RVAs (PDB).
+    FLAG_HAS_RVA = 1 << 0,
+
+    //! binaryId is the ELF build-id, hex.
+    FLAG_ELF_BUILD_ID = 1 << 1,
+
+    //! binaryId is the PDB GUID followed by the age, hex, as used by symbol servers.
+    FLAG_PDB_GUID_AGE = 1 << 2,
+};
+
+struct StringRef
+{
+    uint32_t offset; //!< NONE for null
+    uint32_t length;
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t fileSize;
+    uint32_t classCount;
+    uint32_t fieldCount;
+    uint32_t vmCount;
+    uint32_t bucketCount; //!< power of two
+    uint32_t classTableOffset;
+    uint32_t fieldTableOffset;
+    uint32_t vmTableOffset;
+    uint32_t bucketTableOffset;
+    uint32_t stringPoolOffset;
+    uint32_t stringPoolSize;
+    StringRef binaryId; //!< identity of the binary the layouts come from, see the flags. Null if unknown
+    uint32_t reserved;
+};
+
+struct ClassEntry
+{
+    StringRef name;
+    StringRef baseClass;
+    uint32_t baseClassIndex; //!< NONE if there's no base class or it was not exported
+    uint32_t firstField;
+    uint32_t fieldCount;
+    uint32_t firstVm;
+    uint32_t vmCount;
+    uint32_t reserved;
+    uint64_t layoutHash; //!< structural hash of the layout of the class, same as "layoutHash" in JSON output
+};
+
+enum class Signedness : uint8_t
+{
+    Unknown,
+    Signed,
+    Unsigned,
+};
+
+struct FieldEntry
+{
+    StringRef name;
+    StringRef type;
+    StringRef amxxType;
+    uint32_t classIndex;
+    uint32_t offset;
+    uint32_t arraySize; //!< NONE if not an array
+    Signedness signedness;
+    uint8_t reserved[3];
+};
+
+struct VirtualMethodEntry
+{
+    StringRef name;
+    StringRef linkName;
+    uint32_t classIndex;
+    uint32_t rva; //!< NONE if unknown
+    int32_t index;
+    uint32_t reserved;
+};
+
+enum class EntryKind : uint32_t
+{
+    Class = 0,
+    Field = 1,
+    VirtualMethod = 2,
+};
+
+struct Bucket
+{
+    uint32_t hash;
+    uint32_t ref; //!< (EntryKind << 30) | index, NONE if empty
+};
+
+static_assert(sizeof(Header) == 72);
+static_assert(sizeof(ClassEntry) == 48);
+static_assert(sizeof(FieldEntry) == 40);
+static_assert(sizeof(VirtualMethodEntry) == 32);
+static_assert(sizeof(Bucket) == 8);
+
+constexpr uint32_t MakeRef(EntryKind kind, uint32_t index)
+{
+    return (static_cast<uint32_t>(kind) << 30) | index;
+}
+
+constexpr EntryKind GetRefKind(uint32_t ref)
+{
+    return static_cast<EntryKind>(ref >> 30);
+}
+
+constexpr uint32_t GetRefIndex(uint32_t ref)
+{
+    return ref & ((1u << 30) - 1);
+}
+
+//! FNV-1a of "<className>\0<memberName>". Classes themselves are keyed with an empty member name.
+constexpr uint32_t Hash(std::string_view className, std::string_view memberName)
+{
+    uint32_t hash = 2166136261u;
+
+    for (char c : className)
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+
+    hash = (hash ^ 0) * 16777619u;
+
+    for (char c : memberName)
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+
+    return hash;
+}
+
+class Reader
+{
+public:
+    //! Validates the database. The memory must stay valid and 8-byte aligned (mmap is).
+    bool Open(const void* data, size_t size) noexcept
+    {
+        m_data = nullptr;
+
+        if (!data || size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+            return false;
+
+        const Header* header = static_cast<const Header*>(data);
+
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION || header->fileSize > size)
+            return false;
+
+        if (header->bucketCount == 0 || (header->bucketCount & (header->bucketCount - 1)) != 0)
+            return false;
+
+        if (!IsTableValid(header->classTableOffset, header->classCount, sizeof(ClassEntry), header->fileSize) ||
+            !IsTableValid(header->fieldTableOffset, header->fieldCount, sizeof(FieldEntry), header->fileSize) ||
+            !IsTableValid(header->vmTableOffset, header->vmCount, sizeof(VirtualMethodEntry), header->fileSize) ||
+            !IsTableValid(header->bucketTableOffset, header->bucketCount, sizeof(Bucket), header->fileSize) ||
+            !IsTableValid(header->stringPoolOffset, header->stringPoolSize, 1, header->fileSize))
+            return false;
+
+        // Member ranges are used without checks afterwards
+        const ClassEntry* classes = reinterpret_cast<const ClassEntry*>(static_cast<const uint8_t*>(data) + header->classTableOffset);
+
+        for (uint32_t i = 0; i < header->classCount; i++)
+        {
+            if (classes[i].firstField > header->fieldCount || classes[i].fieldCount > header->fieldCount - classes[i].firstField ||
+                classes[i].firstVm > header->vmCount || classes[i].vmCount > header->vmCount - classes[i].firstVm)
+                return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(data);
+        m_header = header;
+        return true;
+    }
+
+    bool IsOpen() const noexcept { return m_data != nullptr; }
+    const Header& GetHeader() const noexcept { return *m_header; }
+    bool HasRva() const noexcept { return m_header->flags & FLAG_HAS_RVA; }
+
+    //! ELF build-id or PDB GUID and age (see the flags) to compare with the running binary. Empty if unknown.
+    std::string_view GetBinaryId() const noexcept { return GetString(m_header->binaryId); }
+
+    //! All classes, sorted by name.
+    std::span<const ClassEntry> GetClasses() const noexcept
+    {
+        return { Table<ClassEntry>(m_header->classTableOffset), m_header->classCount };
+    }
+
+    std::span<const FieldEntry> GetFields(const ClassEntry& cls) const noexcept
+    {
+        return std::span<const FieldEntry>(Table<FieldEntry>(m_header->fieldTableOffset), m_header->fieldCount).subspan(cls.firstField, cls.fieldCount);
+    }
+
+    std::span<const VirtualMethodEntry> GetVTable(const ClassEntry& cls) const noexcept
+    {
+        return std::span<const VirtualMethodEntry>(Table<VirtualMethodEntry>(m_header->vmTableOffset), m_header->vmCount).subspan(cls.firstVm, cls.vmCount);
+    }
+
+    //! Returns an empty view for null strings.
+    std::string_view GetString(StringRef str) const noexcept
+    {
+        if (str.offset == NONE || str.offset > m_header->stringPoolSize || str.length > m_header->stringPoolSize - str.offset)
+            return {};
+
+        return std::string_view(reinterpret_cast<const char*>(m_data + m_header->stringPoolOffset + str.offset), str.length);
+    }
+
+    const ClassEntry* GetBaseClass(const ClassEntry& cls) const noexcept
+    {
+        return cls.baseClassIndex < m_header->classCount ? &GetClasses()[cls.baseClassIndex] : nullptr;
+    }
+
+    const ClassEntry* FindClass(std::string_view className) const noexcept
+    {
+        return Find<ClassEntry>(EntryKind::Class, className, {});
+    }
+
+    //! Finds a field declared in the class itself.
+    const FieldEntry* FindField(std::string_view className, std::string_view fieldName) const noexcept
+    {
+        return Find<FieldEntry>(EntryKind::Field, className, fieldName);
+    }
+
+    //! Finds a vtable entry declared in the class itself. Returns the first one for overloads.
+    const VirtualMethodEntry* FindVirtualMethod(std::string_view className, std::string_view methodName) const noexcept
+    {
+        return Find<VirtualMethodEntry>(EntryKind::VirtualMethod, className, methodName);
+    }
+
+    //! Finds a field in the class or the closest base class that declares it.
+    const FieldEntry* FindFieldInHierarchy(std::string_view className, std::string_view fieldName) const noexcept
+    {
+        const ClassEntry* cls = FindClass(className);
+
+        // Bounded in case of a corrupted base class cycle
+        for (uint32_t depth = 0; cls && depth < m_header->classCount; depth++)
+        {
+            if (const FieldEntry* field = FindField(GetString(cls->name), fieldName))
+                return field;
+
+            cls = GetBaseClass(*cls);
+        }
+
+        return nullptr;
+    }
+
+private:
+    const uint8_t* m_data = nullptr;
+    const Header* m_header = nullptr;
+
+    static bool IsTableValid(uint32_t offset, uint32_t count, size_t entrySize, uint32_t fileSize) noexcept
+    {
+        return offset % 8 == 0 && offset <= fileSize && static_cast<uint64_t>(count) * entrySize <= fileSize - offset;
+    }
+
+    template <typename T>
+    const T* Table(uint32_t offset) const noexcept
+    {
+        return reinterpret_cast<const T*>(m_data + offset);
+    }
+
+    template <typename T>
+    const T* Find(EntryKind kind, std::string_view className, std::string_view memberName) const noexcept
+    {
+        const uint32_t hash = Hash(className, memberName);
+        const uint32_t mask = m_header->bucketCount - 1;
+        const Bucket* buckets = Table<Bucket>(m_header->bucketTableOffset);
+
+        for (uint32_t i = hash & mask, probes = 0; probes <= mask; i = (i + 1) & mask, probes++)
+        {
+            const Bucket& bucket = buckets[i];
+
+            if (bucket.ref == NONE)
+                return nullptr;
+
+            if (bucket.hash != hash || GetRefKind(bucket.ref) != kind)
+                continue;
+
+            if (const T* entry = Match<T>(GetRefIndex(bucket.ref), className, memberName))
+                return entry;
+        }
+
+        return nullptr;
+    }
+
+    template <typename T>
+    const T* Match(uint32_t index, std::string_view className, std::string_view memberName) const noexcept
+    {
+        if constexpr (std::is_same_v<T, ClassEntry>)
+        {
+            if (index >= m_header->classCount)
+                return nullptr;
+
+            const ClassEntry& cls = GetClasses()[index];
+            return GetString(cls.name) == className ? &cls : nullptr;
+        }
+        else
+        {
+            const bool isField = std::is_same_v<T, FieldEntry>;
+            const uint32_t count = isField ? m_header->fieldCount : m_header->vmCount;
+            const uint32_t tableOffset = isField ? m_header->fieldTableOffset : m_header->vmTableOffset;
+
+            if (index >= count)
+                return nullptr;
+
+            const T& entry = Table<T>(tableOffset)[index];
+
+            if (entry.classIndex >= m_header->classCount || GetString(entry.name) != memberName)
+                return nullptr;
+
+            return GetString(GetClasses()[entry.classIndex].name) == className ? &entry : nullptr;
+        }
+    }
+};
+
+} // namespace OffsetsDb
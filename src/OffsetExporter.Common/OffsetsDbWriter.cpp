@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "OffsetsDb.h"
+#include "OffsetsDbWriter.h"
+
+namespace
+{
+
+class StringPoolBuilder
+{
+public:
+    OffsetsDb::StringRef Add(std::string_view str)
+    {
+        auto it = m_offsets.find(str);
+
+        if (it != m_offsets.end())
+            return OffsetsDb::StringRef { it->second, static_cast<uint32_t>(str.size()) };
+
+        uint32_t offset = static_cast<uint32_t>(m_data.size());
+        m_data.append(str);
+        m_data.push_back('\0');
+        m_offsets.emplace(str, offset);
+        return OffsetsDb::StringRef { offset, static_cast<uint32_t>(str.size()) };
+    }
+
+    OffsetsDb::StringRef Add(const LayoutModel& model, LayoutModel::StringId id)
+    {
+        if (id == LayoutModel::NO_STRING)
+            return OffsetsDb::StringRef { OffsetsDb::NONE, 0 };
+
+        return Add(model.GetString(id));
+    }
+
+    const std::string& GetData() const { return m_data; }
+
+private:
+    // Keys are views into the LayoutModel's pool, which outlives the builder
+    std::unordered_map<std::string_view, uint32_t> m_offsets;
+    std::string m_data;
+};
+
+uint32_t ToU32(uint64_t value, const char* what)
+{
+    if (value >= OffsetsDb::NONE)
+        throw std::runtime_error(std::string(what) + " does not fit into the offsets database");
+
+    return static_cast<uint32_t>(value);
+}
+
+uint32_t AlignTo8(size_t value)
+{
+    return ToU32((value + 7) & ~size_t(7), "File size");
+}
+
+} // namespace
+
+void WriteOffsetsDb(const LayoutModel& model, const std::vector<uint32_t>& classes, bool withBinaryId, std::ostream& out)
+{
+    using namespace OffsetsDb;
+
+    std::vector<uint32_t> sorted = classes;
+    std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b)
+    {
+        return model.GetString(model.GetClassName(a)) < model.GetString(model.GetClassName(b));
+    });
+
+    std::unordered_map<std::string_view, uint32_t> classIndices;
+
+    for (uint32_t i = 0; i < sorted.size(); i++)
+        classIndices.try_emplace(model.GetString(model.GetClassName(sorted[i])), i);
+
+    StringPoolBuilder strings;
+    std::vector<ClassEntry> classTable;
+    std::vector<FieldEntry> fieldTable;
+    std::vector<VirtualMethodEntry> vmTable;
+
+    for (uint32_t i = 0; i < sorted.size(); i++)
+    {
+        uint32_t cls = sorted[i];
+        LayoutModel::Range fields = model.GetFields(cls);
+        LayoutModel::Range vtable = model.GetVTable(cls);
+
+        ClassEntry entry = {};
+        entry.name = strings.Add(model, model.GetClassName(cls));
+        entry.baseClass = strings.Add(model, model.GetBaseClass(cls));
+        entry.baseClassIndex = NONE;
+        entry.firstField = static_cast<uint32_t>(fieldTable.size());
+        entry.firstVm = static_cast<uint32_t>(vmTable.size());
+        entry.vmCount = vtable.end - vtable.begin;
+        entry.layoutHash = model.GetLayoutHash(cls);
+
+        if (model.GetBaseClass(cls) != LayoutModel::NO_STRING)
+        {
+            auto it = classIndices.find(model.GetString(model.GetBaseClass(cls)));
+
+            if (it != classIndices.end())
+                entry.baseClassIndex = it->second;
+        }
+
+        for (uint32_t f = fields.begin; f < fields.end; f++)
+        {
+            if (model.IsNestedField(f))
+                continue;
+
+            FieldEntry field = {};
+            field.name = strings.Add(model, model.GetFieldName(f));
+            field.type = strings.Add(model, model.GetFieldType(f));
+            field.amxxType = strings.Add(model, model.GetFieldAmxxType(f));
+            field.classIndex = i;
+            field.offset = ToU32(model.GetFieldOffset(f), "Field offset");
+            field.arraySize = model.GetFieldArraySize(f) == LayoutModel::NO_ARRAY_SIZE ? NONE : ToU32(model.GetFieldArraySize(f), "Array size");
+            field.signedness = static_cast<Signedness>(model.GetFieldSignedness(f));
+            fieldTable.push_back(field);
+        }
+
+        entry.fieldCount = static_cast<uint32_t>(fieldTable.size()) - entry.firstField;
+        classTable.push_back(entry);
+
+        for (uint32_t m = vtable.begin; m < vtable.end; m++)
+        {
+            VirtualMethodEntry method = {};
+            method.name = strings.Add(model, model.GetVirtualMethodName(m));
+            method.linkName = strings.Add(model, model.GetVirtualMethodLinkName(m));
+            method.classIndex = i;
+            method.rva = model.GetVirtualMethodRva(m) == LayoutModel::NO_RVA ? NONE : ToU32(model.GetVirtualMethodRva(m), "RVA");
+            method.index = model.GetVirtualMethodIndex(m);
+            vmTable.push_back(method);
+        }
+    }
+
+    if (std::max({ classTable.size(), fieldTable.size(), vmTable.size() }) >= (1u << 30))
+        throw std::runtime_error("Too many entries for the offsets database");
+
+    // Load factor of at most 1/2 keeps probe sequences short
+    const size_t keyCount = classTable.size() + fieldTable.size() + vmTable.size();
+    const uint32_t bucketCount = std::bit_ceil(static_cast<uint32_t>(std::max<size_t>(keyCount * 2, 16)));
+    std::vector<Bucket> buckets(bucketCount, Bucket { 0, NONE });
+
+    auto insert = [&](uint32_t hash, uint32_t ref)
+    {
+        uint32_t i = hash & (bucketCount - 1);
+
+        while (buckets[i].ref != NONE)
+            i = (i + 1) & (bucketCount - 1);
+
+        buckets[i] = Bucket { hash, ref };
+    };
+
+    auto getString = [&](StringRef str) { return std::string_view(strings.GetData()).substr(str.offset, str.length); };
+
+    // Inserted in table order so that the first of duplicate names is found first
+    for (uint32_t i = 0; i < classTable.size(); i++)
+        insert(Hash(getString(classTable[i].name), {}), MakeRef(EntryKind::Class, i));
+
+    for (uint32_t i = 0; i < fieldTable.size(); i++)
+        insert(Hash(getString(classTable[fieldTable[i].classIndex].name), getString(fieldTable[i].name)), MakeRef(EntryKind::Field, i));
+
+    for (uint32_t i = 0; i < vmTable.size(); i++)
+        insert(Hash(getString(classTable[vmTable[i].classIndex].name), getString(vmTable[i].name)), MakeRef(EntryKind::VirtualMethod, i));
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = model.HasRva() ? static_cast<uint32_t>(FLAG_HAS_RVA) : 0u;
+    header.binaryId = StringRef { NONE, 0 };
+
+    // Added to the pool last, so the rest of the database is the same without it
+    if (withBinaryId && model.GetBinaryIdKind() != LayoutModel::BinaryIdKind::None)
+    {
+        header.flags |= model.GetBinaryIdKind() == LayoutModel::BinaryIdKind::ElfBuildId ? FLAG_ELF_BUILD_ID : FLAG_PDB_GUID_AGE;
+        header.binaryId = strings.Add(model.GetBinaryId());
+    }
+
+    header.classCount = static_cast<uint32_t>(classTable.size());
+    header.fieldCount = static_cast<uint32_t>(fieldTable.size());
+    header.vmCount = static_cast<uint32_t>(vmTable.size());
+    header.bucketCount = bucketCount;
+    header.classTableOffset = AlignTo8(sizeof(Header));
+    header.fieldTableOffset = AlignTo8(header.classTableOffset + classTable.size() * sizeof(ClassEntry));
+    header.vmTableOffset = AlignTo8(header.fieldTableOffset + fieldTable.size() * sizeof(FieldEntry));
+    header.bucketTableOffset = AlignTo8(header.vmTableOffset + vmTable.size() * sizeof(VirtualMethodEntry));
+    header.stringPoolOffset = AlignTo8(header.bucketTableOffset + buckets.size() * sizeof(Bucket));
+    header.stringPoolSize = ToU32(strings.GetData().size(), "String pool");
+    header.fileSize = AlignTo8(static_cast<size_t>(header.stringPoolOffset) + header.stringPoolSize);
+
+    std::string file(header.fileSize, '\0');
+    auto place = [&](uint32_t offset, const void* data, size_t size)
+    {
+        if (size != 0)
+            std::memcpy(file.data() + offset, data, size);
+    };
+
+    place(0, &header, sizeof(header));
+    place(header.classTableOffset, classTable.data(), classTable.size() * sizeof(ClassEntry));
+    place(header.fieldTableOffset, fieldTable.data(), fieldTable.size() * sizeof(FieldEntry));
+    place(header.vmTableOffset, vmTable.data(), vmTable.size() * sizeof(VirtualMethodEntry));
+    place(header.bucketTableOffset, buckets.data(), buckets.size() * sizeof(Bucket));
+    place(header.stringPoolOffset, strings.GetData().data(), strings.GetData().size());
+
+    out.write(file.data(), file.size());
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <ostream>
+#include <vector>
+#include "LayoutModel.h"
+
+//! Writes the given classes of the model as an OffsetsDb (see OffsetsDb.h).
+//! The binary id of the model is left out unless withBinaryId is set.
+//! Throws std::runtime_error if a value doesn't fit the format.
+void WriteOffsetsDb(const LayoutModel& model, const std::vector<uint32_t>& classes, bool withBinaryId, std::ostream& out);
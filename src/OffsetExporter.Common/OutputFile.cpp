@@ -0,0 +1,41 @@
+#include <stdexcept>
+#include <utility>
+#include <fmt/format.h>
+#include "OutputFile.h"
+
+OutputFile::OutputFile(std::filesystem::path path, std::ios::openmode mode)
+    : m_path(std::move(path))
+{
+    m_partialPath = m_path;
+    m_partialPath += ".partial";
+    m_stream.open(m_partialPath, mode | std::ios::trunc);
+
+    if (!m_stream)
+        throw std::runtime_error(fmt::format("Failed to create {}", m_partialPath.string()));
+}
+
+OutputFile::~OutputFile()
+{
+    if (m_isCommitted)
+        return;
+
+    std::error_code ec;
+    m_stream.close();
+    std::filesystem::remove(m_partialPath, ec);
+}
+
+void OutputFile::Commit()
+{
+    m_stream.close();
+
+    if (!m_stream)
+        throw std::runtime_error(fmt::format("Failed to write {}", m_partialPath.string()));
+
+    std::error_code ec;
+    std::filesystem::rename(m_partialPath, m_path, ec);
+
+    if (ec)
+        throw std::runtime_error(fmt::format("Failed to rename {} to {}: {}", m_partialPath.string(), m_path.string(), ec.message()));
+
+    m_isCommitted = true;
+}
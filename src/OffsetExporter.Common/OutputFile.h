@@ -0,0 +1,28 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+
+//! Output file that is only replaced once it is complete. It is written to <path>.partial,
+//! which can be followed while the exporter is running, and renamed to path by Commit.
+//! If the run fails before that, the partial file is removed and path is left as it was.
+class OutputFile
+{
+public:
+    //! Throws std::runtime_error if the file can't be created.
+    OutputFile(std::filesystem::path path, std::ios::openmode mode);
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    std::ostream& GetStream() { return m_stream; }
+
+    //! Closes the file and renames it into place. Throws std::runtime_error if writing failed.
+    void Commit();
+
+private:
+    std::filesystem::path m_path;
+    std::filesystem::path m_partialPath;
+    std::ofstream m_stream;
+    bool m_isCommitted = false;
+};
@@ -0,0 +1,176 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <fmt/format.h>
+#include "ResultCache.h"
+
+#ifndef OFFSET_EXPORTER_VERSION
+#define OFFSET_EXPORTER_VERSION "unknown"
+#endif
+
+namespace
+{
+
+//! FNV-1a 64
+uint64_t HashContent(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+bool ReadFile(const std::filesystem::path& path, std::string& content)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+
+    if (!file)
+        return false;
+
+    std::stringstream text;
+    text << file.rdbuf();
+    content = text.str();
+    return true;
+}
+
+std::filesystem::path GetExecutablePath()
+{
+#ifdef _WIN32
+    wchar_t path[MAX_PATH];
+    DWORD length = GetModuleFileNameW(nullptr, path, MAX_PATH);
+
+    if (length == 0 || length == MAX_PATH)
+        throw std::runtime_error("Failed to get the path of the executable");
+
+    return std::filesystem::path(path, path + length);
+#else
+    return "/proc/self/exe";
+#endif
+}
+
+} // namespace
+
+std::string_view ResultCache::GetToolVersion()
+{
+    // git describe only changes when cmake runs again, the executable changes on every rebuild
+    static const std::string version = []
+    {
+        std::string content;
+
+        if (!ReadFile(GetExecutablePath(), content))
+            throw std::runtime_error("Failed to read the executable");
+
+        return fmt::format("{}-{:016x}", OFFSET_EXPORTER_VERSION, HashContent(content.data(), content.size()));
+    }();
+
+    return version;
+}
+
+ResultCache::ResultCache(std::filesystem::path dir, std::vector<Output> outputs)
+    : m_dir(std::move(dir))
+    , m_outputs(std::move(outputs))
+{
+    AddKey("tool", GetToolVersion());
+
+    // An entry has exactly the outputs of the run that stored it
+    for (const Output& output : m_outputs)
+        AddKey("output", output.name);
+}
+
+void ResultCache::AddKey(std::string_view name, std::string_view value)
+{
+    fmt::format_to(std::back_inserter(m_key), "{}={}\n", name, value);
+}
+
+void ResultCache::AddKeyFile(std::string_view name, const std::string& path)
+{
+    std::string content;
+
+    if (!ReadFile(path, content))
+        throw std::runtime_error(fmt::format("Failed to open {}", path));
+
+    AddKey(name, fmt::format("{:016x}", HashContent(content.data(), content.size())));
+}
+
+void ResultCache::AddKeyBinary(LayoutModel::BinaryIdKind kind, std::string_view id, const void* data, size_t size)
+{
+    if (kind != LayoutModel::BinaryIdKind::None && !id.empty())
+        AddKey(LayoutModel::GetBinaryIdKindName(kind), id);
+    else
+        AddKey("binary-hash", fmt::format("{:016x}-{}", HashContent(data, size), size));
+}
+
+std::string ResultCache::GetEntryName() const
+{
+    return fmt::format("{:016x}", HashContent(m_key.data(), m_key.size()));
+}
+
+bool ResultCache::Restore() const
+{
+    std::filesystem::path entry = m_dir / GetEntryName();
+    std::string key;
+
+    if (!ReadFile(entry / "key.txt", key) || key != m_key)
+        return false;
+
+    for (const Output& output : m_outputs)
+    {
+        std::error_code ec;
+        std::filesystem::copy_file(entry / output.name, output.path, std::filesystem::copy_options::overwrite_existing, ec);
+
+        // Removed by someone cleaning the cache. Whatever was copied is overwritten by the run
+        if (ec)
+            return false;
+    }
+
+    return true;
+}
+
+void ResultCache::Store() const
+{
+    std::string name = GetEntryName();
+    std::filesystem::path entry = m_dir / name;
+    std::filesystem::path temp = m_dir / fmt::format("{}.tmp{:08x}", name, std::random_device()());
+    std::error_code ec;
+
+    if (std::filesystem::exists(entry, ec))
+        return;
+
+    try
+    {
+        std::filesystem::create_directories(temp);
+
+        for (const Output& output : m_outputs)
+            std::filesystem::copy_file(output.path, temp / output.name);
+
+        std::ofstream keyFile(temp / "key.txt", std::ios::out | std::ios::binary);
+        keyFile.write(m_key.data(), m_key.size());
+        keyFile.close();
+
+        if (!keyFile)
+            throw std::runtime_error(fmt::format("Failed to write {}", (temp / "key.txt").string()));
+    }
+    catch (const std::exception& e)
+    {
+        fmt::println("Failed to store result in cache: {}", e.what());
+        std::filesystem::remove_all(temp, ec);
+        return;
+    }
+
+    // Fails if a parallel run stored the entry first, since the existing entry is not empty
+    std::filesystem::rename(temp, entry, ec);
+
+    if (ec)
+        std::filesystem::remove_all(temp, ec);
+    else
+        fmt::println("Stored result in cache as {}", name);
+}
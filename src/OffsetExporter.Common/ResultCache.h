@@ -0,0 +1,54 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LayoutModel.h"
+
+//! Cache of whole exporter runs in a directory that parallel jobs can share.
+//!
+//! The key is a list of `name=value` lines: the tool version, the outputs, the binary identity and
+//! every option and input file that changes the output. An entry is the directory <dir>/<hash of
+//! the key> with a copy of each output and key.txt, which is compared on lookup so that hash
+//! collisions are misses. Entries are written to a temporary directory and renamed into place,
+//! so a lookup either finds a complete entry or none. If two jobs store the same entry, the
+//! first rename wins and the other one is discarded.
+class ResultCache
+{
+public:
+    //! A file written by the run, stored in the entry under name.
+    struct Output
+    {
+        std::string name;
+        std::string path;
+    };
+
+    //! Version of the exporters: git describe at configure time and the hash of the running executable.
+    //! Throws std::runtime_error if the executable can't be read.
+    static std::string_view GetToolVersion();
+
+    ResultCache(std::filesystem::path dir, std::vector<Output> outputs);
+
+    //! Adds a line to the key.
+    void AddKey(std::string_view name, std::string_view value);
+
+    //! Adds the hash of the content of the file. Throws std::runtime_error if it can't be read.
+    void AddKeyFile(std::string_view name, const std::string& path);
+
+    //! Adds the identity of the binary, or the hash of its content if it has none.
+    void AddKeyBinary(LayoutModel::BinaryIdKind kind, std::string_view id, const void* data, size_t size);
+
+    //! Name of the entry directory.
+    std::string GetEntryName() const;
+
+    //! Copies the outputs of the entry to their paths. Returns false if there is no entry.
+    bool Restore() const;
+
+    //! Copies the outputs into a new entry. Failures are printed, not thrown, since the outputs are already written.
+    void Store() const;
+
+private:
+    std::filesystem::path m_dir;
+    std::vector<Output> m_outputs;
+    std::string m_key;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+
+//! Measures wall time since construction or the last Restart().
+class Stopwatch
+{
+public:
+    Stopwatch()
+        : m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    void Restart()
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    double ElapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstring>
+#include "StringPool.h"
+
+StringPool::Id StringPool::Add(std::string_view str)
+{
+    auto it = m_ids.find(str);
+
+    if (it != m_ids.end())
+        return it->second;
+
+    std::string_view stored = Store(str);
+    Id id = static_cast<Id>(m_strings.size());
+    m_strings.push_back(stored);
+    m_ids.emplace(stored, id);
+    return id;
+}
+
+StringPool::Id StringPool::AddBorrowed(std::string_view str)
+{
+    auto it = m_ids.find(str);
+
+    if (it != m_ids.end())
+        return it->second;
+
+    Id id = static_cast<Id>(m_strings.size());
+    m_strings.push_back(str);
+    m_ids.emplace(str, id);
+    m_borrowedSize += str.size();
+    return id;
+}
+
+std::string_view StringPool::Store(std::string_view str)
+{
+    if (str.size() > m_chunkRemaining)
+    {
+        // Oversized strings get a chunk of their own so that the current one isn't wasted
+        size_t size = std::max(str.size(), CHUNK_SIZE);
+        m_chunks.push_back(std::make_unique_for_overwrite<char[]>(size));
+        m_capacity += size;
+
+        if (str.size() >= CHUNK_SIZE)
+        {
+            std::memcpy(m_chunks.back().get(), str.data(), str.size());
+            return std::string_view(m_chunks.back().get(), str.size());
+        }
+
+        m_chunkPos = m_chunks.back().get();
+        m_chunkRemaining = size;
+    }
+
+    std::memcpy(m_chunkPos, str.data(), str.size());
+    std::string_view stored(m_chunkPos, str.size());
+    m_chunkPos += str.size();
+    m_chunkRemaining -= str.size();
+    return stored;
+}
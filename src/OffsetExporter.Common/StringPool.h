@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//! Interns strings into large chunks. Views returned by Get stay valid for the lifetime of the pool.
+class StringPool
+{
+public:
+    using Id = uint32_t;
+
+    //! Id of an absent string (JSON null).
+    static constexpr Id NONE = UINT32_MAX;
+
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    //! Returns the id of the string, adding it if it's not in the pool yet.
+    Id Add(std::string_view str);
+
+    //! Like Add, but a new string is referenced instead of copied.
+    //! The caller guarantees that the memory outlives the pool (e.g. it's in the mapped input).
+    Id AddBorrowed(std::string_view str);
+
+    //! Returns the id of the string or NONE if it's not in the pool.
+    Id Find(std::string_view str) const
+    {
+        auto it = m_ids.find(str);
+        return it != m_ids.end() ? it->second : NONE;
+    }
+
+    std::string_view Get(Id id) const
+    {
+        return m_strings[id];
+    }
+
+    size_t GetCount() const { return m_strings.size(); }
+
+    //! Total bytes in all chunks.
+    size_t GetCapacity() const { return m_capacity; }
+
+    //! Total length of the strings added with AddBorrowed.
+    size_t GetBorrowedSize() const { return m_borrowedSize; }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_chunkPos = nullptr;
+    size_t m_chunkRemaining = 0;
+    size_t m_capacity = 0;
+    size_t m_borrowedSize = 0;
+
+    std::vector<std::string_view> m_strings;
+    std::unordered_map<std::string_view, Id> m_ids;
+
+    std::string_view Store(std::string_view str);
+};
@@ -73,7 +73,8 @@ inline bool HasAttr(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half attrNum)
     return true;
 }
 
-inline std::string GetStringAttr(Dwarf_Die die, Dwarf_Half attrNum, bool allowOptional = false)
+//! Returns a view into the string section, valid until dwarf_finish.
+inline std::string_view GetStringAttr(Dwarf_Die die, Dwarf_Half attrNum, bool allowOptional = false)
 {
     int res;
     Dwarf_Error error;
@@ -82,7 +83,7 @@ inline std::string GetStringAttr(Dwarf_Die die, Dwarf_Half attrNum, bool allowOp
     res = dwarf_die_text(die, attrNum, &buf, &error);
 
     if (allowOptional && res == DW_DLV_NO_ENTRY)
-        return std::string();
+        return std::string_view();
 
     CheckError(res, error);
     return buf;
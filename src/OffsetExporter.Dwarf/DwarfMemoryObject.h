@@ -0,0 +1,130 @@
+#pragma once
+#include "ElfImage.h"
+
+//! Exposes an ELF file that is already in memory to libdwarf through the object access interface,
+//! so sections are read from the buffer that MemoryMappedFile loaded instead of being read again.
+class DwarfMemoryObject
+{
+public:
+    DwarfMemoryObject(const void* data, size_t size)
+        : m_image(data, size)
+    {
+        m_interface.ai_object = this;
+        m_interface.ai_methods = &METHODS;
+    }
+
+    DwarfMemoryObject(const DwarfMemoryObject&) = delete;
+    DwarfMemoryObject& operator=(const DwarfMemoryObject&) = delete;
+
+    const ElfImage& GetImage() const { return m_image; }
+
+    //! Returns whether the DWARF is in the file itself and not split off with .gnu_debuglink.
+    bool HasDebugInfo() const
+    {
+        return m_image.FindSection(".debug_info") != nullptr;
+    }
+
+    //! Creates a Dwarf_Debug for the object. The object must outlive it.
+    int Init(Dwarf_Debug* dbg, Dwarf_Error* error)
+    {
+        return dwarf_object_init_b(&m_interface, nullptr, nullptr, DW_GROUPNUMBER_ANY, dbg, error);
+    }
+
+private:
+    ElfImage m_image;
+    Dwarf_Obj_Access_Interface_a m_interface = {};
+
+    static DwarfMemoryObject& Self(void* obj)
+    {
+        return *static_cast<DwarfMemoryObject*>(obj);
+    }
+
+    static int GetSectionInfo(void* obj, Dwarf_Unsigned sectionIndex, Dwarf_Obj_Access_Section_a* returnSection, int* error)
+    {
+        const std::vector<ElfImage::Section>& sections = Self(obj).m_image.GetSections();
+
+        if (sectionIndex >= sections.size())
+        {
+            *error = DW_DLE_MDE;
+            return DW_DLV_ERROR;
+        }
+
+        // Names are views into the mapped .shstrtab, which is NUL-terminated
+        const ElfImage::Section& section = sections[sectionIndex];
+        returnSection->as_name = section.name.data() ? section.name.data() : "";
+        returnSection->as_type = section.type;
+        returnSection->as_flags = section.flags;
+        returnSection->as_addr = section.addr;
+        returnSection->as_offset = section.offset;
+        returnSection->as_size = section.size;
+        returnSection->as_link = section.link;
+        returnSection->as_info = section.info;
+        returnSection->as_addralign = section.addralign;
+        returnSection->as_entrysize = section.entsize;
+        return DW_DLV_OK;
+    }
+
+    static Dwarf_Small GetByteOrder(void*)
+    {
+        // ElfImage rejects big-endian files
+        return DW_END_little;
+    }
+
+    static Dwarf_Small GetLengthSize(void*)
+    {
+        // 64-bit DWARF is detected by libdwarf from the unit headers
+        return 4;
+    }
+
+    static Dwarf_Small GetPointerSize(void* obj)
+    {
+        return Self(obj).m_image.Is64Bit() ? 8 : 4;
+    }
+
+    static Dwarf_Unsigned GetFileSize(void* obj)
+    {
+        return Self(obj).m_image.GetSize();
+    }
+
+    static Dwarf_Unsigned GetSectionCount(void* obj)
+    {
+        return Self(obj).m_image.GetSections().size();
+    }
+
+    static int LoadSection(void* obj, Dwarf_Unsigned sectionIndex, Dwarf_Small** returnData, int* error)
+    {
+        const ElfImage& image = Self(obj).m_image;
+
+        if (sectionIndex >= image.GetSections().size())
+        {
+            *error = DW_DLE_MDE;
+            return DW_DLV_ERROR;
+        }
+
+        const ElfImage::Section& section = image.GetSections()[sectionIndex];
+
+        if (section.type == ElfImage::SHT_NOBITS || section.size == 0)
+            return DW_DLV_NO_ENTRY;
+
+        if (section.offset > image.GetSize() || section.size > image.GetSize() - section.offset)
+        {
+            *error = DW_DLE_ELF_SECT_ERR;
+            return DW_DLV_ERROR;
+        }
+
+        // libdwarf only writes to sections when relocating, which is not needed for shared objects
+        *returnData = const_cast<Dwarf_Small*>(image.GetData() + section.offset);
+        return DW_DLV_OK;
+    }
+
+    static constexpr Dwarf_Obj_Access_Methods_a METHODS = {
+        &GetSectionInfo,
+        &GetByteOrder,
+        &GetLengthSize,
+        &GetPointerSize,
+        &GetFileSize,
+        &GetSectionCount,
+        &LoadSection,
+        nullptr, // om_relocate_a_section
+    };
+};
@@ -1,21 +1,45 @@
-#include <boost/json.hpp>
 #include <boost/program_options.hpp>
+#include "AllocationStats.h"
+#include "AmxxTypeRules.h"
+#include "ClassList.h"
+#include "Declarator.h"
 #include "DwarfAttributes.h"
 #include "DwarfCommon.h"
+#include "DwarfMemoryObject.h"
 #include "DwarfTraverse.h"
+#include "HeaderWriter.h"
+#include "InheritanceGraph.h"
+#include "InputSource.h"
+#include "IoBenchmark.h"
+#include "LayoutModel.h"
+#include "LayoutOptimizer.h"
+#include "LayoutReport.h"
+#include "LayoutWriter.h"
+#include "MemoryMappedFile.h"
+#include "NameIndex.h"
+#include "NestedLayouts.h"
+#include "OutputFile.h"
+#include "ResultCache.h"
+#include "Stopwatch.h"
 
 namespace po = boost::program_options;
 
 namespace
 {
 
-std::set<std::string> g_ClassList;
-std::set<std::string> g_ProcessedClasses;
+ClassList g_ClassList;
+bool g_FlattenLayouts = false;
+std::optional<NestedLayouts> g_NestedLayouts;
 
-static std::string ConvertTypeToCString(
+//! Largest alignment of a scalar type inside a structure. The i386 SysV ABI aligns double, long long
+//! and long double (12 bytes) to 4, x86-64 aligns scalars to their size.
+uint64_t g_MaxScalarAlignment = UINT64_MAX;
+
+//! Completes the declarator with the type. Every level adds to decl, the result is only built at the end.
+static void AppendTypeDeclarator(
     Dwarf_Debug dbg,
     Dwarf_Die typeDie,
-    std::string_view name)
+    Declarator& decl)
 {
     switch (GetDieTag(typeDie))
     {
@@ -27,36 +51,44 @@ static std::string ConvertTypeToCString(
     case DW_TAG_class_type:
     case DW_TAG_enumeration_type:
     case DW_TAG_template_alias:
-        return fmt::format("{} {}", GetStringAttr(typeDie, DW_AT_name), name);
+        decl.Prepend(" ");
+        decl.Prepend(GetStringAttr(typeDie, DW_AT_name));
+        return;
     case DW_TAG_const_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToCString(dbg, utype, fmt::format("const {}", name));
+        decl.Prepend("const ");
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_pointer_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToCString(dbg, utype, fmt::format("*{}", name));
+        decl.Prepend("*");
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_reference_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToCString(dbg, utype, fmt::format("&{}", name));
+        decl.Prepend("&");
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_restrict_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToCString(dbg, utype, fmt::format("restrict {}", name));
+        decl.Prepend("restrict ");
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_rvalue_reference_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToCString(dbg, utype, fmt::format("&&{}", name));
+        decl.Prepend("&&");
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_volatile_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToCString(dbg, utype, fmt::format("volatile {}", name));
+        decl.Prepend("volatile ");
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_array_type:
     {
@@ -75,17 +107,38 @@ static std::string ConvertTypeToCString(
             }
         });
 
-        return ConvertTypeToCString(dbg, utype, fmt::format("{}[{}]", name, size));
+        decl.AppendFormat("[{}]", size);
+        return AppendTypeDeclarator(dbg, utype, decl);
     }
     case DW_TAG_subroutine_type:
-        return fmt::format("__subroutine {}", name);
+        decl.Prepend("__subroutine ");
+        return;
     case DW_TAG_ptr_to_member_type:
-        return fmt::format("__member_func *{}", name);
+        decl.Prepend("__member_func *");
+        return;
     default:
-        return fmt::format("unk_{} {}", GetDieTagString(typeDie), name);
+        decl.Prepend(" ");
+        decl.Prepend(GetDieTagString(typeDie));
+        decl.Prepend("unk_");
+        return;
     }
 }
 
+//! Renders the declaration of name into out, which is reused between calls.
+static std::string_view ConvertTypeToCString(
+    fmt::memory_buffer& out,
+    Dwarf_Debug dbg,
+    Dwarf_Die typeDie,
+    std::string_view name)
+{
+    Declarator decl(name);
+    AppendTypeDeclarator(dbg, typeDie, decl);
+
+    out.clear();
+    decl.WriteTo(out);
+    return std::string_view(out.data(), out.size());
+}
+
 static Dwarf_Die ClearModifiers(
     Dwarf_Debug dbg,
     Dwarf_Die typeDie,
@@ -153,6 +206,7 @@ static std::optional<int64_t> FindArraySize(
 
 static std::string_view ConvertTypeToAmxx(
     Dwarf_Debug dbg,
+    const AmxxTypeRules& rules,
     Dwarf_Die typeDie,
     std::string_view name,
     std::optional<bool>& outUnsigned)
@@ -230,14 +284,10 @@ static std::string_view ConvertTypeToAmxx(
         }
         case DW_TAG_class_type:
         {
-            std::string classname = GetStringAttr(utype, DW_AT_name);
+            std::string_view amxxType = rules.Match(AmxxTypeRules::Kind::Pointee, GetStringAttr(utype, DW_AT_name));
 
-            if (classname == "entvars_s")
-                return "entvars";
-            if (classname == "edict_s")
-                return "edict";
-            if (classname[0] == 'C')
-                return "classptr";
+            if (!amxxType.empty())
+                return amxxType;
 
             break;
         }
@@ -245,12 +295,10 @@ static std::string_view ConvertTypeToAmxx(
             return "function";
         case DW_TAG_typedef:
         {
-            std::string typedefName = GetStringAttr(utype, DW_AT_name);
+            std::string_view amxxType = rules.Match(AmxxTypeRules::Kind::PointeeTypedef, GetStringAttr(utype, DW_AT_name));
 
-            if (typedefName == "entvars_t")
-                return "entvars";
-            if (typedefName == "edict_t")
-                return "edict";
+            if (!amxxType.empty())
+                return amxxType;
         }
         }
 
@@ -258,37 +306,31 @@ static std::string_view ConvertTypeToAmxx(
     }
     case DW_TAG_typedef:
     {
-        std::string typeName = GetStringAttr(typeDie, DW_AT_name);
+        std::string_view amxxType = rules.Match(AmxxTypeRules::Kind::Typedef, GetStringAttr(typeDie, DW_AT_name));
 
-        if (typeName == "string_t")
-            return "stringint";
+        if (!amxxType.empty())
+            return amxxType;
 
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        return ConvertTypeToAmxx(dbg, utype, name, outUnsigned);
+        return ConvertTypeToAmxx(dbg, rules, utype, name, outUnsigned);
     }
     case DW_TAG_structure_type:
     case DW_TAG_class_type:
     {
-        std::string classname = GetStringAttr(typeDie, DW_AT_name, true);
-
-        if (classname == "Vector")
-            return "vector";
-        if (classname == "EHANDLE")
-            return "ehandle";
-
-        return "structure";
+        std::string_view amxxType = rules.Match(AmxxTypeRules::Kind::Type, GetStringAttr(typeDie, DW_AT_name, true));
+        return !amxxType.empty() ? amxxType : "structure";
     }
     case DW_TAG_ptr_to_member_type:
         return "function";
     case DW_TAG_array_type:
     {
         Dwarf_Die utype = FollowReference(dbg, typeDie, DW_AT_type);
-        std::string utypeName = GetStringAttr(utype, DW_AT_name, true);
+        std::string_view utypeName = GetStringAttr(utype, DW_AT_name, true);
 
         if (utypeName == "char")
             return "string";
 
-        return ConvertTypeToAmxx(dbg, utype, name, outUnsigned);
+        return ConvertTypeToAmxx(dbg, rules, utype, name, outUnsigned);
     }
     case DW_TAG_enumeration_type:
     {
@@ -308,7 +350,178 @@ static std::string_view ConvertTypeToAmxx(
     }
 }
 
-void ProcessDie(Dwarf_Debug dbg, Dwarf_Die die, boost::json::object& jClasses)
+//! Size of a type in bytes, 0 if unknown.
+static uint64_t GetTypeByteSize(Dwarf_Debug dbg, Dwarf_Die typeDie)
+{
+    typeDie = ClearModifiers(dbg, typeDie, true, true);
+
+    if (GetDieTag(typeDie) == DW_TAG_array_type && !HasAttr(dbg, typeDie, DW_AT_byte_size))
+    {
+        uint64_t count = 1;
+
+        ForEachChild(dbg, typeDie, [&](Dwarf_Die childDie)
+        {
+            if (GetDieTag(childDie) == DW_TAG_subrange_type)
+                count *= std::max<int64_t>(GetUIntAttr(dbg, childDie, DW_AT_upper_bound) + 1, 0);
+        });
+
+        return count * GetTypeByteSize(dbg, FollowReference(dbg, typeDie, DW_AT_type));
+    }
+
+    int64_t bits = GetSizeAttrBits(dbg, typeDie);
+    return bits > 0 ? static_cast<uint64_t>(bits) / 8 : 0;
+}
+
+//! Alignment of a type inside a structure in bytes, 0 if unknown. DW_AT_alignment is only emitted for alignas.
+static uint64_t GetTypeAlignment(Dwarf_Debug dbg, Dwarf_Die typeDie)
+{
+    typeDie = ClearModifiers(dbg, typeDie, true, true);
+
+    if (HasAttr(dbg, typeDie, DW_AT_alignment))
+        return std::max<int64_t>(GetUIntAttr(dbg, typeDie, DW_AT_alignment), 0);
+
+    switch (GetDieTag(typeDie))
+    {
+    case DW_TAG_array_type:
+        return GetTypeAlignment(dbg, FollowReference(dbg, typeDie, DW_AT_type));
+    case DW_TAG_structure_type:
+    case DW_TAG_class_type:
+    case DW_TAG_union_type:
+    {
+        if (HasAttr(dbg, typeDie, DW_AT_declaration))
+            return 0;
+
+        uint64_t alignment = 1;
+
+        // Includes the artificial vtable pointer member. Static members are declarations
+        ForEachChild(dbg, typeDie, [&](Dwarf_Die childDie)
+        {
+            Dwarf_Half tag = GetDieTag(childDie);
+
+            if (tag == DW_TAG_inheritance || (tag == DW_TAG_member && !HasAttr(dbg, childDie, DW_AT_declaration)))
+                alignment = std::max(alignment, GetTypeAlignment(dbg, FollowReference(dbg, childDie, DW_AT_type)));
+        });
+
+        return alignment;
+    }
+    default:
+        // Base types, enums and pointers are aligned to their size, up to the limit of the ABI
+        return std::min(GetTypeByteSize(dbg, typeDie), g_MaxScalarAlignment);
+    }
+}
+
+//! Returns the structure or class of a member, or of its elements if it's a one-dimensional array.
+static NestedLayouts::NestedType FindNestedType(Dwarf_Debug dbg, Dwarf_Die typeDie)
+{
+    typeDie = ClearModifiers(dbg, typeDie, true, true);
+    bool isArray = GetDieTag(typeDie) == DW_TAG_array_type;
+
+    if (isArray)
+    {
+        int dimensions = 0;
+
+        ForEachChild(dbg, typeDie, [&](Dwarf_Die childDie)
+        {
+            if (GetDieTag(childDie) == DW_TAG_subrange_type)
+                dimensions++;
+        });
+
+        if (dimensions != 1)
+            return {};
+
+        typeDie = ClearModifiers(dbg, FollowReference(dbg, typeDie, DW_AT_type), true, true);
+    }
+
+    Dwarf_Half tag = GetDieTag(typeDie);
+
+    if ((tag != DW_TAG_structure_type && tag != DW_TAG_class_type) || HasAttr(dbg, typeDie, DW_AT_declaration))
+        return {};
+
+    int64_t size = GetUIntAttr(dbg, typeDie, DW_AT_byte_size);
+
+    if (isArray && size <= 0)
+        return {};
+
+    Dwarf_Off offset = 0;
+    Dwarf_Error error;
+    int res = dwarf_dieoffset(typeDie, &offset, &error);
+    CheckError(res, error);
+
+    return NestedLayouts::NestedType { offset, static_cast<uint64_t>(size) };
+}
+
+//! Describes a DW_TAG_member. Returns false for members that are not part of the layout (statics, compiler-generated).
+//! The aggregate type of the member is only looked up if nestedType is set.
+static bool DescribeMember(
+    Dwarf_Debug dbg,
+    const AmxxTypeRules& rules,
+    Dwarf_Die memberDie,
+    fmt::memory_buffer& typeNameBuf,
+    LayoutModel::FieldDesc& field,
+    NestedLayouts::NestedType* nestedType)
+{
+    std::string_view fieldName = GetStringAttr(memberDie, DW_AT_name);
+    int64_t offset = GetUIntAttr(dbg, memberDie, DW_AT_data_member_location);
+
+    if (offset == -1)
+    {
+        // Skip statics
+        return false;
+    }
+
+    if (HasAttr(dbg, memberDie, DW_AT_artificial))
+    {
+        // Skip compiler-generated
+        return false;
+    }
+
+    Dwarf_Die fieldType = FollowReference(dbg, memberDie, DW_AT_type);
+
+    std::optional<uint64_t> arraySize = FindArraySize(dbg, fieldType);
+    std::string_view typeName = ConvertTypeToCString(typeNameBuf, dbg, fieldType, fieldName);
+    std::optional<bool> isUnsigned;
+    std::string_view amxxType = ConvertTypeToAmxx(dbg, rules, fieldType, fieldName, isUnsigned);
+
+    field.name = fieldName;
+    field.offset = offset;
+    field.arraySize = arraySize.value_or(LayoutModel::NO_ARRAY_SIZE);
+    field.size = GetTypeByteSize(dbg, fieldType);
+    field.alignment = static_cast<uint32_t>(GetTypeAlignment(dbg, fieldType));
+    field.type = typeName;
+    field.amxxType = amxxType;
+
+    if (isUnsigned.has_value())
+        field.signedness = *isUnsigned ? LayoutModel::Signedness::Unsigned : LayoutModel::Signedness::Signed;
+
+    if (nestedType)
+        *nestedType = FindNestedType(dbg, fieldType);
+
+    return true;
+}
+
+//! Adds the members of the structure at a DIE offset to g_NestedLayouts.
+static void DecodeNestedType(Dwarf_Debug dbg, const AmxxTypeRules& rules, uint64_t dieOffset)
+{
+    Dwarf_Die typeDie = nullptr;
+    Dwarf_Error error;
+    int res = dwarf_offdie_b(dbg, dieOffset, true, &typeDie, &error);
+    CheckError(res, error);
+
+    fmt::memory_buffer typeNameBuf;
+
+    ForEachChild(dbg, typeDie, [&](Dwarf_Die childDie)
+    {
+        LayoutModel::FieldDesc field;
+        NestedLayouts::NestedType nestedType;
+
+        if (GetDieTag(childDie) == DW_TAG_member && DescribeMember(dbg, rules, childDie, typeNameBuf, field, &nestedType))
+            g_NestedLayouts->AddMember(field, nestedType);
+    });
+
+    dwarf_dealloc(dbg, typeDie, DW_DLA_DIE);
+}
+
+void ProcessDie(Dwarf_Debug dbg, const AmxxTypeRules& rules, Dwarf_Die die, LayoutModel& model, LayoutWriter& writer)
 {
     int res;
     Dwarf_Error error;
@@ -323,24 +536,31 @@ void ProcessDie(Dwarf_Debug dbg, Dwarf_Die die, boost::json::object& jClasses)
     if (HasAttr(dbg, die, DW_AT_declaration)) // Forward-decl
         return;
 
-    std::string className = GetStringAttr(die, DW_AT_name);
+    std::string_view className = GetStringAttr(die, DW_AT_name);
 
-    if (!g_ClassList.contains(className))
+    if (!g_ClassList.Contains(className))
         return;
 
-    if (g_ProcessedClasses.contains(className))
+    if (model.FindClass(className) != UINT32_MAX)
         return;
 
-    g_ProcessedClasses.insert(className);
+    // Bases are extracted first, so their vtable and flattened layout are ready to be extended
+    ForEachChild(dbg, die, [&](Dwarf_Die childDie)
+    {
+        if (GetDieTag(childDie) != DW_TAG_inheritance)
+            return;
+
+        Dwarf_Die baseClassDie = FollowReference(dbg, childDie, DW_AT_type);
+        ProcessDie(dbg, rules, baseClassDie, model, writer);
+        dwarf_dealloc(dbg, baseClassDie, DW_DLA_DIE);
+    });
 
-    boost::json::object jClass;
-    jClass["baseClass"] = nullptr;
+    uint32_t cls = model.BeginClass(className);
+    model.SetClassSize(std::max<int64_t>(GetUIntAttr(dbg, die, DW_AT_byte_size), 0));
+    fmt::memory_buffer typeNameBuf;
 
     fmt::println("class {}\n{{", className);
 
-    boost::json::array jFields;
-    boost::json::array jVTable;
-
     ForEachChild(dbg, die, [&](Dwarf_Die childDie)
     {
         switch (GetDieTag(childDie))
@@ -348,55 +568,30 @@ void ProcessDie(Dwarf_Debug dbg, Dwarf_Die die, boost::json::object& jClasses)
         case DW_TAG_inheritance:
         {
             Dwarf_Die baseClassDie = FollowReference(dbg, childDie, DW_AT_type);
-            std::string baseClassName = GetStringAttr(baseClassDie, DW_AT_name);
+            std::string_view baseClassName = GetStringAttr(baseClassDie, DW_AT_name);
             fmt::println("  base: {}", baseClassName);
-            jClass["baseClass"] = baseClassName;
+            model.SetBaseClass(baseClassName);
 
             dwarf_dealloc(dbg, baseClassDie, DW_DLA_DIE);
             break;
         }
         case DW_TAG_member:
         {
-            std::string fieldName = GetStringAttr(childDie, DW_AT_name);
-            int64_t offset = GetUIntAttr(dbg, childDie, DW_AT_data_member_location);
-
-            if (offset == -1)
-            {
-                // Skip statics
-                break;
-            }
+            LayoutModel::FieldDesc field;
+            NestedLayouts::NestedType nestedType;
 
-            if (HasAttr(dbg, childDie, DW_AT_artificial))
-            {
-                // Skip compiler-generated
+            if (!DescribeMember(dbg, rules, childDie, typeNameBuf, field, g_NestedLayouts ? &nestedType : nullptr))
                 break;
-            }
 
-            Dwarf_Attribute typeAttr;
-            res = dwarf_attr(childDie, DW_AT_type, &typeAttr, &error);
-            CheckError(res, error);
-            Dwarf_Die fieldType = FollowReference(dbg, typeAttr);
-
-            std::optional<uint64_t> arraySize = FindArraySize(dbg, fieldType);
-            std::string typeName = ConvertTypeToCString(dbg, fieldType, fieldName);
-            std::optional<bool> isUnsigned;
-            std::string_view amxxType = ConvertTypeToAmxx(dbg, fieldType, fieldName, isUnsigned);
-
-            boost::json::object jField;
-            jField["name"] = fieldName;
-            jField["offset"] = offset;
-            jField["arraySize"] = arraySize.has_value() ? boost::json::value(*arraySize) : nullptr;
-            jField["type"] = typeName;
-            jField["amxxType"] = amxxType;
-            jField["unsigned"] = isUnsigned.has_value() ? boost::json::value(*isUnsigned) : nullptr;
+            // PrintDieAttrs(dbg, childDie);
 
-            // fmt::println("    {}", GetDieTagString(fieldType));
+            fmt::println("  [0x{:04X}] {}", field.offset, field.type);
 
-            // PrintDieAttrs(dbg, childDie);
+            model.AddField(field);
 
-            fmt::println("  [0x{:04X}] {}", offset, typeName);
+            if (g_NestedLayouts)
+                g_NestedLayouts->Expand(model, field, nestedType, [&](uint64_t key) { DecodeNestedType(dbg, rules, key); });
 
-            jFields.push_back(std::move(jField));
             break;
         }
         case DW_TAG_subprogram:
@@ -433,41 +628,114 @@ void ProcessDie(Dwarf_Debug dbg, Dwarf_Die die, boost::json::object& jClasses)
             if (vtableIdx == -1)
                 throw std::runtime_error("Vtable idx not found");
 
-            std::string methodName = GetStringAttr(childDie, DW_AT_name);
-            std::string linkageName = GetStringAttr(childDie, DW_AT_linkage_name);
+            std::string_view methodName = GetStringAttr(childDie, DW_AT_name);
+            std::string_view linkageName = GetStringAttr(childDie, DW_AT_linkage_name);
             // fmt::println("[{}] {} ({})", vtableIdx, methodName, linkageName);
 
-            boost::json::object jMethod;
-            jMethod["name"] = methodName;
-            jMethod["linkName"] = linkageName;
-            jMethod["index"] = vtableIdx;
-            jVTable.push_back(std::move(jMethod));
+            LayoutModel::VirtualMethodDesc method;
+            method.name = methodName;
+            method.linkName = linkageName;
+            method.index = vtableIdx;
+            model.AddVirtualMethod(method);
         }
         }
     });
 
     fmt::println("}}");
 
-    jClass["fields"] = std::move(jFields);
-    jClass["vtable"] = std::move(jVTable);
-    jClasses[className] = std::move(jClass);
+    model.ResolveVTable(cls);
+
+    if (g_FlattenLayouts)
+        model.Flatten(cls);
+
+    writer.WriteClass(model, cls);
 }
 
-std::set<std::string> ReadClassList(const std::string& path)
+//! Indexes the base classes of all class definitions in one pass and adds the roots and their derived classes to
+//! g_ClassList. Returns the definitions of these and of the classes already in g_ClassList sorted by DIE offset,
+//! so that extraction doesn't visit every DIE again.
+std::vector<InheritanceGraph::Class> DiscoverClasses(Dwarf_Debug dbg, std::string_view roots)
 {
-    // Read class list
-    fmt::println("Opening class list file {}", path);
-    std::ifstream classListFile(path);
-    std::set<std::string> classList;
-    std::string line;
+    InheritanceGraph graph;
 
-    while (std::getline(classListFile, line))
+    ProcessAllDies(dbg, [&](Dwarf_Die die)
     {
-        fmt::println("- {}", line);
-        classList.insert(line);
+        if (GetDieTag(die) != DW_TAG_class_type || HasAttr(dbg, die, DW_AT_declaration))
+            return;
+
+        std::string_view className = GetStringAttr(die, DW_AT_name);
+        Dwarf_Off offset = 0;
+        Dwarf_Error error;
+        int res = dwarf_dieoffset(die, &offset, &error);
+        CheckError(res, error);
+
+        if (className.empty() || !graph.AddClass(className, offset))
+            return;
+
+        ForEachChild(dbg, die, [&](Dwarf_Die childDie)
+        {
+            if (GetDieTag(childDie) != DW_TAG_inheritance)
+                return;
+
+            Dwarf_Die baseClassDie = FollowReference(dbg, childDie, DW_AT_type);
+            graph.AddBase(className, GetStringAttr(baseClassDie, DW_AT_name));
+            dwarf_dealloc(dbg, baseClassDie, DW_DLA_DIE);
+        });
+    });
+
+    std::vector<std::string_view> names;
+
+    for (size_t i = 0; i < g_ClassList.GetCount(); i++)
+        names.push_back(g_ClassList.GetName(i));
+
+    std::vector<InheritanceGraph::Class> classes = graph.CollectDerived(InheritanceGraph::ParseNameList(roots), names);
+    fmt::println("Found {} classes under {} or in the class list among {} class definitions", classes.size(), roots, graph.GetClassCount());
+
+    for (const InheritanceGraph::Class& cls : classes)
+        names.push_back(cls.name);
+
+    ClassList combined;
+    combined.Build(names);
+    g_ClassList = std::move(combined);
+    return classes;
+}
+
+//! Adds the die to the name index if it's a class definition.
+void IndexClassDie(Dwarf_Debug dbg, Dwarf_Die die, NameIndex::Builder& builder)
+{
+    if (GetDieTag(die) != DW_TAG_class_type || HasAttr(dbg, die, DW_AT_declaration))
+        return;
+
+    std::string_view className = GetStringAttr(die, DW_AT_name);
+
+    if (className.empty())
+        return;
+
+    Dwarf_Off offset = 0;
+    Dwarf_Off unitOffset = 0;
+    Dwarf_Error error;
+    int res = dwarf_dieoffset(die, &offset, &error);
+    CheckError(res, error);
+    res = dwarf_CU_dieoffset_given_die(die, &unitOffset, &error);
+    CheckError(res, error);
+    builder.Add(className, offset, unitOffset);
+}
+
+//! Looks up the classes of g_ClassList in the name index. Returns the definitions sorted by DIE offset,
+//! the order in which a scan of all DIEs would find them.
+std::vector<Dwarf_Off> FindClasses(const NameIndex::Reader& nameIndex)
+{
+    std::vector<Dwarf_Off> offsets;
+
+    for (size_t i = 0; i < g_ClassList.GetCount(); i++)
+    {
+        if (const NameIndex::Entry* entry = nameIndex.Find(g_ClassList.GetName(i)))
+            offsets.push_back(entry->location);
     }
 
-    return classList;
+    std::sort(offsets.begin(), offsets.end());
+    fmt::println("Found {} of {} classes in the name index", offsets.size(), g_ClassList.GetCount());
+    return offsets;
 }
 
 } // namespace
@@ -481,9 +749,25 @@ int main(int argc, char** argv)
     {
         desc.add_options()
             ("help", "produce help message")
-            ("class-list", po::value<std::string>()->required(), "list of classes to extract")
-            ("so", po::value<std::string>()->required(), "path to the .so")
-            ("out", po::value<std::string>()->required(), "path to output JSON");
+            ("class-list", po::value<std::string>(), "list of classes to extract")
+            ("roots", po::value<std::string>(), "comma-separated classes to extract together with every class derived from them, e.g. CBaseEntity,CGameRules")
+            ("so", po::value<std::string>()->required(), "path to the .so, - for stdin or archive.tar[.zst]:member")
+            ("out", po::value<std::string>(), "path to output JSON")
+            ("out-dir", po::value<std::string>(), "instead of --out, write one file per class and manifest.json to this directory")
+            ("format", po::value<std::string>()->default_value("json"), "output format: json, ndjson (one class per line) or bin (see OffsetsDb.h)")
+            ("emit-header", po::value<std::string>(), "also write a C++ header with constexpr offsets and typed accessors (#ifndef _WIN32 section)")
+            ("expand-nested", po::value<int>()->implicit_value(2), "also add the members of structure fields as \"field.member\" with absolute offsets, up to N levels deep")
+            ("flatten", "add a \"flattened\" list of all fields including inherited ones to every class (json and ndjson)")
+            ("layout-report", po::value<std::string>(), "also write a report of class sizes, padding holes and fields straddling 64-byte cache lines")
+            ("layout-report-format", po::value<std::string>()->default_value("text"), "format of --layout-report and --propose-layouts: text or json")
+            ("propose-layouts", po::value<std::string>(), "also write, for every class, an order of its own fields that minimizes padding and cache lines")
+            ("hot-fields", po::value<std::string>(), "file with one Class::field per line to place first in --propose-layouts, most accessed first")
+            ("type-rules", po::value<std::string>(), "file with amxxType rules (see AmxxTypeRules.h). The built-in rules are in test-data/amxx-type-rules.txt")
+            ("cache-dir", po::value<std::string>(), "reuse the outputs of an earlier run with the same build-id, class list and options from this directory")
+            ("name-index-dir", po::value<std::string>(), "save the DIE offsets of all classes of the .so to this directory, keyed by build-id, and look up the class list in them on later runs")
+            ("stats", "print timing and memory statistics")
+            ("io", po::value<std::string>()->default_value("mmap"), "how the .so is read: mmap, populate, madvise, hugepages or read")
+            ("io-bench", po::value<int>()->implicit_value(5), "after exporting, compare I/O strategies on the .so over N iterations");
 
         po::store(po::parse_command_line(argc, argv, desc), vm);
 
@@ -493,6 +777,15 @@ int main(int argc, char** argv)
         }
 
         po::notify(vm);
+
+        if (vm.count("out") == vm.count("out-dir"))
+            throw po::error("exactly one of --out and --out-dir is required");
+
+        if (!vm.count("class-list") && !vm.count("roots"))
+            throw po::error("--class-list or --roots is required");
+
+        if (vm.count("cache-dir") && vm.count("out-dir"))
+            throw po::error("--cache-dir can't be used with --out-dir");
     }
     catch (const std::exception& e)
     {
@@ -503,39 +796,286 @@ int main(int argc, char** argv)
 
     try
     {
+        MemoryMappedFile::IoStrategy ioStrategy;
+        if (!MemoryMappedFile::ParseIoStrategy(vm["io"].as<std::string>(), ioStrategy))
+            throw std::runtime_error(fmt::format("Unknown I/O strategy {}", vm["io"].as<std::string>()));
+
+        OutputFormat outputFormat;
+        if (!ParseOutputFormat(vm["format"].as<std::string>(), outputFormat))
+            throw std::runtime_error(fmt::format("Unknown output format {}", vm["format"].as<std::string>()));
+
+        LayoutReportFormat layoutReportFormat;
+        if (!ParseLayoutReportFormat(vm["layout-report-format"].as<std::string>(), layoutReportFormat))
+            throw std::runtime_error(fmt::format("Unknown layout report format {}", vm["layout-report-format"].as<std::string>()));
+
+        HotFieldList hotFields;
+        if (vm.count("hot-fields"))
+            hotFields = HotFieldList::LoadFile(vm["hot-fields"].as<std::string>());
+
+        // Every option that changes the output is part of the key
+        std::optional<ResultCache> cache;
+
+        if (vm.count("cache-dir"))
+        {
+            std::vector<ResultCache::Output> outputs = { { "out", vm["out"].as<std::string>() } };
+
+            for (const char* option : { "emit-header", "layout-report", "propose-layouts" })
+            {
+                if (vm.count(option))
+                    outputs.push_back({ option, vm[option].as<std::string>() });
+            }
+
+            cache.emplace(vm["cache-dir"].as<std::string>(), std::move(outputs));
+            cache->AddKey("exporter", "OffsetExporter.Dwarf");
+            cache->AddKey("format", vm["format"].as<std::string>());
+            cache->AddKey("layout-report-format", vm["layout-report-format"].as<std::string>());
+            cache->AddKey("flatten", vm.count("flatten") ? "1" : "0");
+            cache->AddKey("expand-nested", vm.count("expand-nested") ? std::to_string(vm["expand-nested"].as<int>()) : "");
+
+            if (vm.count("roots"))
+                cache->AddKey("roots", vm["roots"].as<std::string>());
+
+            for (const char* option : { "class-list", "type-rules", "hot-fields" })
+            {
+                if (vm.count(option))
+                    cache->AddKeyFile(option, vm[option].as<std::string>());
+            }
+        }
+
         std::string soFilePath = vm["so"].as<std::string>();
         fmt::println("Opening so file {}", soFilePath);
+        Stopwatch loadTimer;
         Dwarf_Debug dbg = nullptr;
         Dwarf_Error error = 0;
         int res = 0;
 
-        res = dwarf_init_path(
-            soFilePath.c_str(),
-            nullptr,
-            0,
-            DW_GROUPNUMBER_ANY,
-            nullptr,
-            nullptr,
-            &dbg,
-            &error);
+        MemoryMappedFile::Handle soFile = InputSource::Open(soFilePath, ioStrategy);
+        if (!soFile.baseAddress)
+            throw std::runtime_error("Cannot open file");
+
+        // Must outlive dbg
+        std::optional<DwarfMemoryObject> soObject;
+        std::string buildId;
+
+        if (ElfImage::IsElf(soFile.baseAddress, soFile.len))
+        {
+            ElfImage elfImage(soFile.baseAddress, soFile.len);
+
+            for (char c : elfImage.GetBuildId())
+                fmt::format_to(std::back_inserter(buildId), "{:02x}", static_cast<uint8_t>(c));
+
+            if (!elfImage.Is64Bit())
+                g_MaxScalarAlignment = 4;
+
+            if (!buildId.empty())
+                fmt::println("Build ID {}", buildId);
+
+            soObject.emplace(soFile.baseAddress, soFile.len);
+
+            // Debug info in a separate file is found by libdwarf itself
+            if (!soObject->HasDebugInfo())
+                soObject.reset();
+        }
+
+        if (cache)
+        {
+            cache->AddKeyBinary(buildId.empty() ? LayoutModel::BinaryIdKind::None : LayoutModel::BinaryIdKind::ElfBuildId, buildId, soFile.baseAddress, soFile.len);
+
+            if (cache->Restore())
+            {
+                fmt::println("Restored outputs from cache entry {}", cache->GetEntryName());
+                return 0;
+            }
+        }
+
+        if (soObject)
+        {
+            res = soObject->Init(&dbg, &error);
+        }
+        else if (InputSource::IsStreamed(soFilePath))
+        {
+            // libdwarf can only follow .gnu_debuglink from a path on disk
+            throw std::runtime_error("Streamed .so has no .debug_info");
+        }
+        else
+        {
+            res = dwarf_init_path(
+                soFilePath.c_str(),
+                nullptr,
+                0,
+                DW_GROUPNUMBER_ANY,
+                nullptr,
+                nullptr,
+                &dbg,
+                &error);
+        }
 
         CheckError(res, error);
 
-        g_ClassList = ReadClassList(vm["class-list"].as<std::string>());
+        if (vm.count("class-list"))
+        {
+            std::string classListPath = vm["class-list"].as<std::string>();
+            fmt::println("Opening class list file {}", classListPath);
+            g_ClassList = ClassList::LoadFile(classListPath);
+            fmt::println("Loaded {} classes", g_ClassList.GetCount());
+        }
 
-        boost::json::object jRoot;
-        boost::json::object jClasses;
+        // DIE offsets of the classes to extract, if known without visiting every DIE
+        std::optional<std::vector<Dwarf_Off>> classOffsets;
+        std::optional<NameIndex::Builder> nameIndexBuilder;
+        std::filesystem::path nameIndexPath;
 
-        ProcessAllDies(dbg, [&](Dwarf_Die die2) {
-            ProcessDie(dbg, die2, jClasses);
-        });
+        if (vm.count("roots"))
+        {
+            classOffsets.emplace();
+
+            for (const InheritanceGraph::Class& cls : DiscoverClasses(dbg, vm["roots"].as<std::string>()))
+                classOffsets->push_back(cls.location);
+        }
+        else if (vm.count("name-index-dir") && buildId.empty())
+        {
+            fmt::println("The .so has no build-id, name index is not used");
+        }
+        else if (vm.count("name-index-dir"))
+        {
+            nameIndexPath = NameIndex::GetPath(vm["name-index-dir"].as<std::string>(), LayoutModel::BinaryIdKind::ElfBuildId, buildId);
+            NameIndex::Reader nameIndex;
+
+            if (nameIndex.Open(nameIndexPath))
+            {
+                fmt::println("Loaded name index {} with {} classes", nameIndexPath.string(), nameIndex.GetCount());
+                classOffsets = FindClasses(nameIndex);
+            }
+            else
+            {
+                nameIndexBuilder.emplace();
+            }
+        }
+
+        AmxxTypeRules typeRules;
+
+        if (vm.count("type-rules"))
+        {
+            typeRules = AmxxTypeRules::LoadFile(vm["type-rules"].as<std::string>());
+            fmt::println("Loaded {} type rules", typeRules.GetRuleCount());
+        }
+
+        g_FlattenLayouts = vm.count("flatten") != 0;
+
+        if (vm.count("expand-nested"))
+            g_NestedLayouts.emplace(vm["expand-nested"].as<int>());
+
+        // Names point into libdwarf's sections, which are never freed before exit
+        LayoutModel model;
+        model.SetBorrowNames(true);
+
+        if (!buildId.empty())
+            model.SetBinaryId(LayoutModel::BinaryIdKind::ElfBuildId, buildId);
+
+        // Classes are written as soon as they are extracted
+        std::optional<OutputFile> outFile;
+        std::unique_ptr<LayoutWriter> writer;
+
+        if (vm.count("out-dir"))
+        {
+            writer = LayoutWriter::CreateSharded(outputFormat, vm["out-dir"].as<std::string>(), model.GetBinaryIdKind(), model.GetBinaryId());
+        }
+        else
+        {
+            outFile.emplace(vm["out"].as<std::string>(), GetOutputOpenMode(outputFormat));
+            writer = LayoutWriter::Create(outputFormat, outFile->GetStream(), model.GetBinaryIdKind(), model.GetBinaryId());
+        }
+
+        if (!classOffsets)
+        {
+            ProcessAllDies(dbg, [&](Dwarf_Die die2) {
+                if (nameIndexBuilder)
+                    IndexClassDie(dbg, die2, *nameIndexBuilder);
 
-        jRoot["classes"] = std::move(jClasses);
+                ProcessDie(dbg, typeRules, die2, model, *writer);
+            });
+
+            if (nameIndexBuilder)
+                nameIndexBuilder->Save(nameIndexPath);
+        }
+        else
+        {
+            // Only the class DIEs are visited, not the whole tree again
+            for (Dwarf_Off classOffset : *classOffsets)
+            {
+                Dwarf_Die classDie = nullptr;
+                res = dwarf_offdie_b(dbg, classOffset, true, &classDie, &error);
+                CheckError(res, error);
+                ProcessDie(dbg, typeRules, classDie, model, *writer);
+                dwarf_dealloc(dbg, classDie, DW_DLA_DIE);
+            }
+        }
+
+        writer->Finish();
+
+        if (outFile)
+            outFile->Commit();
+
+        if (vm.count("emit-header"))
+        {
+            std::string headerPath = vm["emit-header"].as<std::string>();
+            fmt::println("Writing header {}", headerPath);
+            std::ofstream headerFile(headerPath);
+            WriteLayoutHeader(model, HeaderPlatform::Linux, "OffsetExporter.Dwarf", headerFile);
+        }
+
+        if (vm.count("layout-report"))
+        {
+            std::string reportPath = vm["layout-report"].as<std::string>();
+            fmt::println("Writing layout report {}", reportPath);
+            std::ofstream reportFile(reportPath);
+            WriteLayoutReport(model, layoutReportFormat, reportFile);
+        }
+
+        if (vm.count("propose-layouts"))
+        {
+            std::string proposalsPath = vm["propose-layouts"].as<std::string>();
+            fmt::println("Writing layout proposals {}", proposalsPath);
+            std::ofstream proposalsFile(proposalsPath);
+            WriteLayoutProposals(model, hotFields, layoutReportFormat, proposalsFile);
+        }
+
+        if (cache)
+        {
+            // The other outputs are closed at the end of their blocks
+            cache->Store();
+        }
+
+        if (vm.count("stats"))
+        {
+            AllocationStats allocations = AllocationStats::Get();
+            fmt::println("Extracted: {:.3f} ms", loadTimer.ElapsedMs());
+            fmt::println("Layout model: {} classes, {} fields, {} vtable entries, {} strings, {} KiB, {} KiB of names not copied",
+                model.GetClassCount(), model.GetFieldCount(), model.GetVirtualMethodCount(), model.GetStrings().GetCount(), model.GetMemoryUsage() / 1024,
+                model.GetStrings().GetBorrowedSize() / 1024);
+
+            if (g_NestedLayouts)
+                fmt::println("Nested layouts: {} types decoded", g_NestedLayouts->GetTypeCount());
 
-        // Save JSON
-        std::string outPath = vm["out"].as<std::string>();
-        std::ofstream outFile(outPath);
-        outFile << jRoot << "\n";
+            if (AllocationStats::IsCounting())
+            {
+                fmt::println("Allocations: {} ({} KiB), peak memory {} MiB",
+                    allocations.count, allocations.bytes / 1024, AllocationStats::GetPeakMemoryUsage() / (1024 * 1024));
+            }
+            else
+            {
+                fmt::println("Peak memory {} MiB", AllocationStats::GetPeakMemoryUsage() / (1024 * 1024));
+            }
+            RunDeclaratorBenchmark();
+        }
+
+        if (vm.count("io-bench"))
+        {
+            if (InputSource::IsStreamed(soFilePath))
+                fmt::println("I/O benchmark needs a .so on disk");
+            else
+                RunIoBenchmark(soFilePath.c_str(), vm["io-bench"].as<int>());
+        }
     }
     catch (const std::exception& e)
     {
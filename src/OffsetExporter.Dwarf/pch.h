@@ -2,6 +2,9 @@
 #include <concepts>
 #include <iostream>
 #include <fstream>
+#include <optional>
+#include <set>
+#include <string>
 #include <fmt/format.h>
 #include <libdwarf/dwarf.h>
 #include <libdwarf/libdwarf.h>
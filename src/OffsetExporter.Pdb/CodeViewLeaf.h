@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <raw_pdb/PDB_TPIStream.h>
+
+// Helpers for reading CodeView numeric leaves and the names that follow them.
+
+inline uint8_t GetLeafSize(PDB::CodeView::TPI::TypeRecordKind kind)
+{
+    if (kind < PDB::CodeView::TPI::TypeRecordKind::LF_NUMERIC)
+    {
+        // No leaf can have an index less than LF_NUMERIC (0x8000)
+        // so word is the value...
+        return sizeof(PDB::CodeView::TPI::TypeRecordKind);
+    }
+
+    switch (kind)
+    {
+    case PDB::CodeView::TPI::TypeRecordKind::LF_CHAR:
+        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint8_t);
+
+    case PDB::CodeView::TPI::TypeRecordKind::LF_USHORT:
+    case PDB::CodeView::TPI::TypeRecordKind::LF_SHORT:
+        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint16_t);
+
+    case PDB::CodeView::TPI::TypeRecordKind::LF_LONG:
+    case PDB::CodeView::TPI::TypeRecordKind::LF_ULONG:
+        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint32_t);
+
+    case PDB::CodeView::TPI::TypeRecordKind::LF_QUADWORD:
+    case PDB::CodeView::TPI::TypeRecordKind::LF_UQUADWORD:
+        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint64_t);
+
+    default:
+        printf("Error! 0x%04x bogus type encountered, aborting...\n", PDB_AS_UNDERLYING(kind));
+    }
+    return 0;
+}
+
+template <typename T>
+inline T UnalignedRead(const char* data)
+{
+	T value = {};
+	memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+inline uint64_t ReadUIntLeaf(const char* data, PDB::CodeView::TPI::TypeRecordKind kind)
+{
+	const char* leafData = data + sizeof(PDB::CodeView::TPI::TypeRecordKind);
+
+	switch (kind)
+	{
+	case PDB::CodeView::TPI::TypeRecordKind::LF_CHAR:
+		return UnalignedRead<uint8_t>(leafData);
+
+	case PDB::CodeView::TPI::TypeRecordKind::LF_USHORT:
+	case PDB::CodeView::TPI::TypeRecordKind::LF_SHORT:
+		return UnalignedRead<uint16_t>(leafData);
+
+	case PDB::CodeView::TPI::TypeRecordKind::LF_LONG:
+	case PDB::CodeView::TPI::TypeRecordKind::LF_ULONG:
+		return UnalignedRead<uint32_t>(leafData);
+
+	case PDB::CodeView::TPI::TypeRecordKind::LF_QUADWORD:
+	case PDB::CodeView::TPI::TypeRecordKind::LF_UQUADWORD:
+		return UnalignedRead<uint64_t>(leafData);
+
+	default:
+		printf("Error! 0x%04x bogus type encountered, aborting...\n", PDB_AS_UNDERLYING(kind));
+	}
+
+	return 0;
+}
+
+inline uint64_t ReadSizeLeaf(const char* data)
+{
+	auto kind = UnalignedRead<PDB::CodeView::TPI::TypeRecordKind>(data);
+
+	if (kind < PDB::CodeView::TPI::TypeRecordKind::LF_NUMERIC)
+	{
+		// Kind itself is the size
+		return (uint64_t)kind;
+	}
+
+	return ReadUIntLeaf(data, kind);
+}
+
+inline const char* GetLeafName(const char* data, PDB::CodeView::TPI::TypeRecordKind kind)
+{
+    return &data[GetLeafSize(kind)];
+}
@@ -0,0 +1,196 @@
+#include "CodeViewLeaf.h"
+#include "FieldListIndex.h"
+
+namespace
+{
+
+bool IsIntroducingMethod(PDB::CodeView::TPI::MemberAttributes attributes)
+{
+	auto methodProp = static_cast<PDB::CodeView::TPI::MethodProperty>(attributes.mprop);
+	return methodProp == PDB::CodeView::TPI::MethodProperty::Intro ||
+		methodProp == PDB::CodeView::TPI::MethodProperty::PureIntro;
+}
+
+const char* GetMethodName(const PDB::CodeView::TPI::FieldList* fieldRecord)
+{
+	// Introducing methods have a vtable offset before the name
+	if (IsIntroducingMethod(fieldRecord->data.LF_ONEMETHOD.attributes))
+		return &reinterpret_cast<const char*>(fieldRecord->data.LF_ONEMETHOD.vbaseoff)[sizeof(uint32_t)];
+
+	return &reinterpret_cast<const char*>(fieldRecord->data.LF_ONEMETHOD.vbaseoff)[0];
+}
+
+size_t AlignFieldOffset(size_t i)
+{
+	return (i + (sizeof(uint32_t) - 1)) & (0 - sizeof(uint32_t));
+}
+
+} // namespace
+
+FieldListIndex::FieldListIndex(const TypeTable& typeTable)
+	: m_typeTable(typeTable)
+{
+}
+
+FieldListIndex::Range FieldListIndex::Decode(uint32_t fieldListTypeIndex)
+{
+	auto it = m_decoded.find(fieldListTypeIndex);
+	if (it != m_decoded.end())
+		return it->second;
+
+	Range range;
+	range.begin = static_cast<uint32_t>(m_kinds.size());
+
+	auto record = m_typeTable.GetTypeRecord(fieldListTypeIndex);
+	if (record)
+		DecodeRecord(record);
+
+	range.end = static_cast<uint32_t>(m_kinds.size());
+	m_decoded.emplace(fieldListTypeIndex, range);
+	return range;
+}
+
+void FieldListIndex::DecodeRecord(const PDB::CodeView::TPI::Record* record)
+{
+	auto maximumSize = record->header.size - sizeof(uint16_t);
+
+	for (size_t i = 0; i < maximumSize;)
+	{
+		const char* leafName = nullptr;
+		auto fieldRecord = reinterpret_cast<const PDB::CodeView::TPI::FieldList*>(reinterpret_cast<const uint8_t*>(&record->data.LF_FIELD.list) + i);
+
+		// Other kinds of records are not implemented
+		PDB_ASSERT(
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_BCLASS ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VBCLASS ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_IVBCLASS ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_INDEX ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VFUNCTAB ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_NESTTYPE ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_ENUM ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_MEMBER ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_STMEMBER ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_METHOD ||
+			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_ONEMETHOD,
+			"Unknown record kind %X",
+			static_cast<unsigned int>(fieldRecord->kind));
+
+		if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_MEMBER)
+		{
+			uint64_t offset = ReadSizeLeaf(fieldRecord->data.LF_MEMBER.offset);
+			leafName = GetLeafName(fieldRecord->data.LF_MEMBER.offset, fieldRecord->data.LF_MEMBER.lfEasy.kind);
+			AddMember(MemberKind::Member, leafName, offset, fieldRecord->data.LF_MEMBER.index);
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_NESTTYPE)
+		{
+			leafName = &fieldRecord->data.LF_NESTTYPE.name[0];
+			AddMember(MemberKind::NestedType, leafName, 0, fieldRecord->data.LF_NESTTYPE.index);
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_STMEMBER)
+		{
+			leafName = &fieldRecord->data.LF_STMEMBER.name[0];
+			AddMember(MemberKind::StaticMember, leafName, 0, fieldRecord->data.LF_STMEMBER.index);
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_METHOD)
+		{
+			// Overloaded method, expand every entry of the method list
+			leafName = fieldRecord->data.LF_METHOD.name;
+
+			auto methodList = m_typeTable.GetTypeRecord(fieldRecord->data.LF_METHOD.mList);
+			if (methodList)
+			{
+				// https://github.com/microsoft/microsoft-pdb/blob/master/PDB/include/symtypeutils.h#L220
+				size_t offsetInMethodList = 0;
+				for (size_t j = 0; j < fieldRecord->data.LF_METHOD.count; j++)
+				{
+					size_t entrySize = 2 * sizeof(uint32_t);
+					auto entry = reinterpret_cast<const PDB::CodeView::TPI::MethodListEntry*>(methodList->data.LF_METHODLIST.mList + offsetInMethodList);
+
+					if (IsIntroducingMethod(entry->attributes))
+					{
+						AddMember(MemberKind::Method, leafName, 0, entry->index, entry->attributes, entry->vbaseoff[0] / 4);
+						entrySize += sizeof(uint32_t);
+					}
+					else
+					{
+						AddMember(MemberKind::Method, leafName, 0, entry->index, entry->attributes);
+					}
+
+					offsetInMethodList += entrySize;
+				}
+			}
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_ONEMETHOD)
+		{
+			leafName = GetMethodName(fieldRecord);
+			auto attributes = fieldRecord->data.LF_ONEMETHOD.attributes;
+			int32_t vtableSlot = IsIntroducingMethod(attributes) ? fieldRecord->data.LF_ONEMETHOD.vbaseoff[0] / 4 : -1;
+			AddMember(MemberKind::Method, leafName, 0, fieldRecord->data.LF_ONEMETHOD.index, attributes, vtableSlot);
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_BCLASS)
+		{
+			uint64_t offset = ReadSizeLeaf(fieldRecord->data.LF_BCLASS.offset);
+			leafName = GetLeafName(fieldRecord->data.LF_BCLASS.offset, fieldRecord->data.LF_BCLASS.lfEasy.kind);
+
+			auto baseTypeRecord = m_typeTable.GetTypeRecord(fieldRecord->data.LF_BCLASS.index);
+			if (baseTypeRecord)
+			{
+				auto baseLeafName = GetLeafName(baseTypeRecord->data.LF_CLASS.data, baseTypeRecord->data.LF_CLASS.lfEasy.kind);
+				AddMember(MemberKind::BaseClass, baseLeafName, offset, fieldRecord->data.LF_BCLASS.index);
+			}
+
+			// The leaf name is where the record ends, there is no name
+			i += static_cast<size_t>(leafName - reinterpret_cast<const char*>(fieldRecord));
+			i = AlignFieldOffset(i);
+			continue;
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VBCLASS || fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_IVBCLASS)
+		{
+			// virtual base pointer offset from address point
+			// followed by virtual base offset from vbtable
+
+			const  PDB::CodeView::TPI::TypeRecordKind vbpOffsetAddressPointKind = *(PDB::CodeView::TPI::TypeRecordKind*)(fieldRecord->data.LF_IVBCLASS.vbpOffset);
+			const uint8_t vbpOffsetAddressPointSize = GetLeafSize(vbpOffsetAddressPointKind);
+
+			const  PDB::CodeView::TPI::TypeRecordKind vbpOffsetVBTableKind = *(PDB::CodeView::TPI::TypeRecordKind*)(fieldRecord->data.LF_IVBCLASS.vbpOffset + vbpOffsetAddressPointSize);
+			const uint8_t vbpOffsetVBTableSize = GetLeafSize(vbpOffsetVBTableKind);
+
+			i += sizeof(PDB::CodeView::TPI::FieldList::Data::LF_VBCLASS);
+			i += vbpOffsetAddressPointSize + vbpOffsetVBTableSize;
+			i = AlignFieldOffset(i);
+			continue;
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_INDEX)
+		{
+			i += sizeof(PDB::CodeView::TPI::FieldList::Data::LF_INDEX);
+			i = AlignFieldOffset(i);
+			continue;
+		}
+		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VFUNCTAB)
+		{
+			AddMember(MemberKind::VFuncTab, {}, 0, fieldRecord->data.LF_VFUNCTAB.type);
+			i += sizeof(PDB::CodeView::TPI::FieldList::Data::LF_VFUNCTAB);
+			i = AlignFieldOffset(i);
+			continue;
+		}
+		else
+		{
+			break;
+		}
+
+		i += static_cast<size_t>(leafName - reinterpret_cast<const char*>(fieldRecord));
+		i += strnlen(leafName, maximumSize - i - 1) + 1;
+		i = AlignFieldOffset(i);
+	}
+}
+
+void FieldListIndex::AddMember(MemberKind kind, std::string_view name, uint64_t offset, uint32_t typeIndex,
+	PDB::CodeView::TPI::MemberAttributes attributes, int32_t vtableSlot)
+{
+	m_kinds.push_back(kind);
+	m_names.push_back(name);
+	m_offsets.push_back(offset);
+	m_typeIndices.push_back(typeIndex);
+	m_methodAttributes.push_back(attributes);
+	m_vtableSlots.push_back(vtableSlot);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "TypeTable.h"
+
+//! Decodes LF_FIELDLIST records into compact per-member arrays.
+//! Each field list is decoded once, revisiting it (e.g. through a base class) is a hash lookup.
+class FieldListIndex
+{
+public:
+	enum class MemberKind : uint8_t
+	{
+		Member,
+		StaticMember,
+		NestedType,
+		Method,
+		BaseClass,
+		VFuncTab, //!< vtable pointer introduced by the class, the type is the pointer
+	};
+
+	//! Range of member indices belonging to one field list.
+	struct Range
+	{
+		uint32_t begin = 0;
+		uint32_t end = 0;
+	};
+
+	explicit FieldListIndex(const TypeTable& typeTable);
+
+	//! Returns the members of a field list, decoding it on first use.
+	Range Decode(uint32_t fieldListTypeIndex);
+
+	MemberKind GetKind(uint32_t i) const { return m_kinds[i]; }
+
+	//! Member name. For base classes, the name of the base class.
+	std::string_view GetName(uint32_t i) const { return m_names[i]; }
+
+	//! Offset of a data member or base class.
+	uint64_t GetOffset(uint32_t i) const { return m_offsets[i]; }
+
+	//! Type of the member. For methods, the LF_MFUNCTION record. For base classes, the class record.
+	uint32_t GetTypeIndex(uint32_t i) const { return m_typeIndices[i]; }
+
+	//! Method attributes. Only valid for methods.
+	PDB::CodeView::TPI::MemberAttributes GetMethodAttributes(uint32_t i) const { return m_methodAttributes[i]; }
+
+	//! Vtable slot introduced by a method, or -1.
+	int32_t GetVTableSlot(uint32_t i) const { return m_vtableSlots[i]; }
+
+	//! Alignment of the class with the field list, memoized by the exporter. 0 if not computed yet.
+	uint64_t FindAlignment(uint32_t fieldListTypeIndex) const
+	{
+		auto it = m_alignments.find(fieldListTypeIndex);
+		return it != m_alignments.end() ? it->second : 0;
+	}
+
+	void SetAlignment(uint32_t fieldListTypeIndex, uint64_t alignment) { m_alignments[fieldListTypeIndex] = alignment; }
+
+private:
+	const TypeTable& m_typeTable;
+	std::unordered_map<uint32_t, Range> m_decoded;
+	std::unordered_map<uint32_t, uint64_t> m_alignments;
+
+	std::vector<MemberKind> m_kinds;
+	std::vector<std::string_view> m_names;
+	std::vector<uint64_t> m_offsets;
+	std::vector<uint32_t> m_typeIndices;
+	std::vector<PDB::CodeView::TPI::MemberAttributes> m_methodAttributes;
+	std::vector<int32_t> m_vtableSlots;
+
+	void DecodeRecord(const PDB::CodeView::TPI::Record* record);
+	void AddMember(MemberKind kind, std::string_view name, uint64_t offset, uint32_t typeIndex,
+		PDB::CodeView::TPI::MemberAttributes attributes = {}, int32_t vtableSlot = -1);
+};
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <fmt/format.h>
+#include <raw_pdb/PDB_ModuleInfoStream.h>
+#include <raw_pdb/PDB_ModuleSymbolStream.h>
+#include "SymbolIndex.h"
+
+namespace
+{
+
+//! Builds "?Method@Class@Namespace@@", the prefix of an MSVC-decorated member function name.
+//! Special members are passed as their code, e.g. "??_G" gives "??_GClass@Namespace@@".
+std::string GetDecoratedPrefix(std::string_view className, std::string_view methodName)
+{
+	std::string result;
+	bool needSeparator;
+
+	if (methodName.starts_with("??"))
+	{
+		result = methodName;
+		needSeparator = false;
+	}
+	else
+	{
+		result = "?";
+		result += methodName;
+		needSeparator = true;
+	}
+
+	// Scopes are written innermost first
+	std::string_view scope = className;
+
+	while (true)
+	{
+		size_t pos = scope.rfind("::");
+
+		if (needSeparator)
+			result += '@';
+
+		needSeparator = true;
+
+		if (pos == std::string_view::npos)
+		{
+			result += scope;
+			break;
+		}
+
+		result += scope.substr(pos + 2);
+		scope = scope.substr(0, pos);
+	}
+
+	result += "@@";
+	return result;
+}
+
+//! Checks the function type code following "@@" for private/protected/public virtual (near or far).
+bool IsDecoratedVirtual(std::string_view decoratedName, size_t prefixLength)
+{
+	if (decoratedName.size() <= prefixLength)
+		return false;
+
+	switch (decoratedName[prefixLength])
+	{
+	case 'E':
+	case 'F':
+	case 'M':
+	case 'N':
+	case 'U':
+	case 'V':
+		return true;
+	default:
+		return false;
+	}
+}
+
+} // namespace
+
+SymbolIndex::SymbolIndex(const PDB::RawFile& rawPdbFile, const PDB::DBIStream& dbiStream)
+	: m_symbolRecordStream(dbiStream.CreateSymbolRecordStream(rawPdbFile))
+{
+	const PDB::ImageSectionStream imageSectionStream = dbiStream.CreateImageSectionStream(rawPdbFile);
+
+	// Public symbols: decorated names of everything with an address
+	const PDB::PublicSymbolStream publicSymbolStream = dbiStream.CreatePublicSymbolStream(rawPdbFile);
+
+	for (const PDB::HashRecord& hashRecord : publicSymbolStream.GetRecords())
+	{
+		const PDB::CodeView::DBI::Record* record = publicSymbolStream.GetRecord(m_symbolRecordStream, hashRecord);
+
+		if (record->header.kind != PDB::CodeView::DBI::SymbolRecordKind::S_PUB32)
+			continue;
+
+		const uint32_t rva = imageSectionStream.ConvertSectionOffsetToRVA(record->data.S_PUB32.section, record->data.S_PUB32.offset);
+		if (rva == 0u)
+			continue;
+
+		m_publics.push_back(Symbol { record->data.S_PUB32.name, rva, 0 });
+	}
+
+	// Procedures with their type, used to resolve overloads. The global symbol stream only references
+	// them with S_PROCREF, the records themselves are in the symbol stream of the module that defines them.
+	const PDB::ModuleInfoStream moduleInfoStream = dbiStream.CreateModuleInfoStream(rawPdbFile);
+
+	for (const PDB::ModuleInfoStream::Module& module : moduleInfoStream.GetModules())
+	{
+		if (!module.HasSymbolStream())
+			continue;
+
+		const PDB::ModuleSymbolStream moduleSymbolStream = module.CreateSymbolStream(rawPdbFile);
+
+		moduleSymbolStream.ForEachSymbol([&](const PDB::CodeView::DBI::Record* record)
+		{
+			// Same layout for both
+			if (record->header.kind != PDB::CodeView::DBI::SymbolRecordKind::S_GPROC32 && record->header.kind != PDB::CodeView::DBI::SymbolRecordKind::S_LPROC32)
+				return;
+
+			// Only member functions can be virtual
+			std::string_view name = record->data.S_GPROC32.name;
+			if (name.find("::") == std::string_view::npos)
+				return;
+
+			const uint32_t rva = imageSectionStream.ConvertSectionOffsetToRVA(record->data.S_GPROC32.section, record->data.S_GPROC32.offset);
+			if (rva == 0u)
+				return;
+
+			name = m_procedureNames.Get(m_procedureNames.Add(name));
+			m_procedures.push_back(Symbol { name, rva, record->data.S_GPROC32.typeIndex });
+		});
+	}
+
+	Sort();
+}
+
+SymbolIndex::SymbolIndex(std::vector<Symbol> publics, std::vector<Symbol> procedures)
+	: m_publics(std::move(publics))
+	, m_procedures(std::move(procedures))
+{
+	Sort();
+}
+
+void SymbolIndex::Sort()
+{
+	std::sort(m_publics.begin(), m_publics.end(), [](const Symbol& lhs, const Symbol& rhs) { return lhs.rva < rhs.rva; });
+
+	m_publicsByName.resize(m_publics.size());
+	for (uint32_t i = 0; i < m_publicsByName.size(); i++)
+		m_publicsByName[i] = i;
+
+	std::sort(m_publicsByName.begin(), m_publicsByName.end(), [this](uint32_t lhs, uint32_t rhs) { return m_publics[lhs].name < m_publics[rhs].name; });
+	std::sort(m_procedures.begin(), m_procedures.end(), [](const Symbol& lhs, const Symbol& rhs) { return lhs.name < rhs.name; });
+}
+
+const SymbolIndex::Symbol* SymbolIndex::FindByAddress(uint32_t rva) const
+{
+	auto it = std::lower_bound(m_publics.begin(), m_publics.end(), rva, [](const Symbol& symbol, uint32_t value) { return symbol.rva < value; });
+
+	if (it == m_publics.end() || it->rva != rva)
+		return nullptr;
+
+	return &*it;
+}
+
+const SymbolIndex::Symbol* SymbolIndex::FindDecoratedVirtual(std::string_view prefix, size_t& matchCount) const
+{
+	// All publics starting with the prefix are adjacent in name order
+	auto it = std::lower_bound(m_publicsByName.begin(), m_publicsByName.end(), prefix,
+		[this](uint32_t index, std::string_view value) { return m_publics[index].name < value; });
+
+	const Symbol* found = nullptr;
+	matchCount = 0;
+
+	for (; it != m_publicsByName.end() && m_publics[*it].name.starts_with(prefix); ++it)
+	{
+		if (!IsDecoratedVirtual(m_publics[*it].name, prefix.size()))
+			continue;
+
+		found = &m_publics[*it];
+		matchCount++;
+	}
+
+	return found;
+}
+
+const SymbolIndex::Symbol* SymbolIndex::FindVirtualMethod(std::string_view className, std::string_view methodName, uint32_t methodType) const
+{
+	size_t matchCount = 0;
+
+	// The slot of a virtual destructor holds the scalar deleting destructor ??_G, or the vector deleting
+	// destructor ??_E if the compiler emitted that one instead. ??1 is the destructor itself and not in the vtable.
+	if (methodName.starts_with('~'))
+	{
+		for (std::string_view code : { "??_G", "??_E" })
+		{
+			if (const Symbol* symbol = FindDecoratedVirtual(GetDecoratedPrefix(className, code), matchCount))
+				return symbol;
+		}
+
+		return nullptr;
+	}
+
+	const Symbol* found = FindDecoratedVirtual(GetDecoratedPrefix(className, methodName), matchCount);
+
+	if (matchCount <= 1)
+		return found;
+
+	// Overloaded virtual: find the procedure with the same type and map its address back to the decorated name
+	const std::string qualifiedName = fmt::format("{}::{}", className, methodName);
+
+	auto procIt = std::lower_bound(m_procedures.begin(), m_procedures.end(), std::string_view(qualifiedName),
+		[](const Symbol& symbol, std::string_view value) { return symbol.name < value; });
+
+	for (; procIt != m_procedures.end() && procIt->name == qualifiedName; ++procIt)
+	{
+		if (procIt->typeIndex == methodType)
+			return FindByAddress(procIt->rva);
+	}
+
+	return nullptr;
+}
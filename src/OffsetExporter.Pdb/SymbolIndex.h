@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <raw_pdb/PDB_RawFile.h>
+#include <raw_pdb/PDB_DBIStream.h>
+#include "StringPool.h"
+
+//! Index of S_PUB32 symbols from the DBI public symbol stream and S_GPROC32/S_LPROC32 symbols from the
+//! module symbol streams. The global symbol stream only has S_PROCREF for procedures, so it is not used.
+//! Built once, then queried with binary searches by address or by decorated name.
+class SymbolIndex
+{
+public:
+	struct Symbol
+	{
+		//! Decorated name for S_PUB32, undecorated qualified name for S_GPROC32.
+		std::string_view name;
+		uint32_t rva = 0;
+
+		//! LF_MFUNCTION/LF_PROCEDURE type of S_GPROC32. Zero for S_PUB32.
+		uint32_t typeIndex = 0;
+	};
+
+	SymbolIndex(const PDB::RawFile& rawPdbFile, const PDB::DBIStream& dbiStream);
+
+	//! Index of the given symbols, whose names must outlive it. For tests.
+	SymbolIndex(std::vector<Symbol> publics, std::vector<Symbol> procedures);
+
+	//! Returns the public symbol at the exact address or nullptr.
+	const Symbol* FindByAddress(uint32_t rva) const;
+
+	//! Finds the public symbol of a virtual method. For destructors, that's the deleting destructor in the vtable.
+	//! @param methodType  LF_MFUNCTION type of the method, used to tell overloads apart.
+	//! @returns the symbol or nullptr if the method has no body or overloads can't be resolved.
+	const Symbol* FindVirtualMethod(std::string_view className, std::string_view methodName, uint32_t methodType) const;
+
+	size_t GetPublicCount() const { return m_publics.size(); }
+	size_t GetProcedureCount() const { return m_procedures.size(); }
+
+private:
+	PDB::CoalescedMSFStream m_symbolRecordStream;
+
+	//! Names of procedures, copied since the module streams are released after indexing.
+	StringPool m_procedureNames;
+
+	//! Returns the last virtual public whose name starts with the decorated prefix, and how many there are.
+	const Symbol* FindDecoratedVirtual(std::string_view prefix, size_t& matchCount) const;
+
+	void Sort();
+
+	//! S_PUB32 sorted by RVA.
+	std::vector<Symbol> m_publics;
+
+	//! Indices into m_publics sorted by name.
+	std::vector<uint32_t> m_publicsByName;
+
+	//! S_GPROC32/S_LPROC32 of member functions sorted by name.
+	std::vector<Symbol> m_procedures;
+};
@@ -1,9 +1,29 @@
 // Copyright 2011-2022, Molecular Matters GmbH <office@molecular-matters.com>
 // See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
 
+#include <bit>
+#include <cstring>
+#include "CodeViewLeaf.h"
 #include "TypeTable.h"
 #include "raw_pdb/Foundation/PDB_Memory.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TYPE_TABLE_SSE2 1
+#endif
+
+namespace
+{
+
+bool IsClassKind(uint16_t kind)
+{
+	return kind == static_cast<uint16_t>(PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE) ||
+		kind == static_cast<uint16_t>(PDB::CodeView::TPI::TypeRecordKind::LF_CLASS) ||
+		kind == static_cast<uint16_t>(PDB::CodeView::TPI::TypeRecordKind::LF_CLASS2);
+}
+
+} // namespace
+
 TypeTable::TypeTable(const PDB::TPIStream& tpiStream) PDB_NO_EXCEPT
 	: typeIndexBegin(tpiStream.GetFirstTypeIndex()), typeIndexEnd(tpiStream.GetLastTypeIndex()),
 	m_recordCount(tpiStream.GetTypeRecordCount())
@@ -18,6 +38,11 @@ TypeTable::TypeTable(const PDB::TPIStream& tpiStream) PDB_NO_EXCEPT
 	// we therefore walk the TPI stream once, and store pointers to the records for trivial O(1) array lookup by index later.	
 	m_records = PDB_NEW_ARRAY(const PDB::CodeView::TPI::Record*, m_recordCount);
 
+	// record kinds are also stored densely so that scans for a particular kind don't have to chase the pointers above.
+	m_kinds = PDB_NEW_ARRAY(uint16_t, m_recordCount);
+	m_fwdRefBits = PDB_NEW_ARRAY(uint8_t, (m_recordCount + 7) / 8);
+	memset(m_fwdRefBits, 0, (m_recordCount + 7) / 8);
+
 	// parse the CodeView records
 	uint32_t typeIndex = 0u;
 
@@ -26,15 +51,91 @@ TypeTable::TypeTable(const PDB::TPIStream& tpiStream) PDB_NO_EXCEPT
 			// The header includes the record kind and size, which can be stored along with offset
 			// to allow for lazy loading of the types on-demand directly from the TPIStream::GetDirectMSFStream()
 			// using DirectMSFStream::ReadAtOffset(...). Thus not needing a CoalescedMSFStream to look up the types.
-			(void)header;
-
 			const PDB::CodeView::TPI::Record* record = m_stream.GetDataAtOffset<const PDB::CodeView::TPI::Record>(offset);
 			m_records[typeIndex] = record;
+			m_kinds[typeIndex] = static_cast<uint16_t>(header.kind);
+
+			if (IsClassKind(m_kinds[typeIndex]) && record->data.LF_CLASS.property.fwdref)
+				m_fwdRefBits[typeIndex / 8] |= static_cast<uint8_t>(1u << (typeIndex % 8));
+
 			++typeIndex;
 		});
 }
 
 TypeTable::~TypeTable() PDB_NO_EXCEPT
 {
+	PDB_DELETE_ARRAY(m_fwdRefBits);
+	PDB_DELETE_ARRAY(m_kinds);
 	PDB_DELETE_ARRAY(m_records);
 }
+
+std::vector<uint32_t> TypeTable::FindClassDefinitions(void) const
+{
+	std::vector<uint32_t> result;
+	size_t i = 0;
+
+#ifdef TYPE_TABLE_SSE2
+	// Compare 8 kinds at once. Each matching 16-bit lane sets two adjacent bits in the movemask.
+	const __m128i structKind = _mm_set1_epi16(static_cast<short>(PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE));
+	const __m128i classKind = _mm_set1_epi16(static_cast<short>(PDB::CodeView::TPI::TypeRecordKind::LF_CLASS));
+	const __m128i class2Kind = _mm_set1_epi16(static_cast<short>(PDB::CodeView::TPI::TypeRecordKind::LF_CLASS2));
+
+	for (; i + 8 <= m_recordCount; i += 8)
+	{
+		const __m128i kinds = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_kinds + i));
+		const __m128i match = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi16(kinds, structKind), _mm_cmpeq_epi16(kinds, classKind)),
+			_mm_cmpeq_epi16(kinds, class2Kind));
+
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+
+		if (mask == 0)
+			continue;
+
+		// i is a multiple of 8, so fwdref bits of all 8 records are in a single byte
+		const uint8_t fwdRefs = m_fwdRefBits[i / 8];
+
+		while (mask != 0)
+		{
+			const uint32_t lane = static_cast<uint32_t>(std::countr_zero(mask)) / 2;
+			mask &= ~(3u << (lane * 2));
+
+			if (!((fwdRefs >> lane) & 1))
+				result.push_back(typeIndexBegin + static_cast<uint32_t>(i) + lane);
+		}
+	}
+#endif
+
+	for (; i < m_recordCount; i++)
+	{
+		if (IsClassKind(m_kinds[i]) && !((m_fwdRefBits[i / 8] >> (i % 8)) & 1))
+			result.push_back(typeIndexBegin + static_cast<uint32_t>(i));
+	}
+
+	return result;
+}
+
+uint32_t TypeTable::FindDefinition(std::string_view name) const
+{
+	if (!m_hasDefinitions)
+	{
+		for (size_t i = 0; i < m_recordCount; i++)
+		{
+			const auto kind = static_cast<PDB::CodeView::TPI::TypeRecordKind>(m_kinds[i]);
+
+			if (kind != PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE && kind != PDB::CodeView::TPI::TypeRecordKind::LF_CLASS)
+				continue;
+
+			if ((m_fwdRefBits[i / 8] >> (i % 8)) & 1)
+				continue;
+
+			const PDB::CodeView::TPI::Record* record = m_records[i];
+			m_definitions.try_emplace(GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind), typeIndexBegin + static_cast<uint32_t>(i));
+		}
+
+		m_hasDefinitions = true;
+	}
+
+	auto it = m_definitions.find(name);
+	return it != m_definitions.end() ? it->second : 0;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <raw_pdb/PDB_TPIStream.h>
 #include <raw_pdb/PDB_CoalescedMSFStream.h>
 
@@ -23,7 +26,7 @@ public:
 
 	PDB_NO_DISCARD inline const PDB::CodeView::TPI::Record* GetTypeRecord(uint32_t typeIndex) const PDB_NO_EXCEPT
 	{
-		if (typeIndex < typeIndexBegin || typeIndex > typeIndexEnd)
+		if (!IsInRange(typeIndex))
 			return nullptr;
 
 		return m_records[typeIndex - typeIndexBegin];
@@ -36,14 +39,57 @@ public:
 		return PDB::ArrayView<const PDB::CodeView::TPI::Record*>(m_records, m_recordCount);
 	}
 
+	// Returns the kind of a type record without touching the record itself, or 0 if there is no such record.
+	PDB_NO_DISCARD inline PDB::CodeView::TPI::TypeRecordKind GetTypeRecordKind(uint32_t typeIndex) const PDB_NO_EXCEPT
+	{
+		if (!IsInRange(typeIndex))
+			return static_cast<PDB::CodeView::TPI::TypeRecordKind>(0);
+
+		return static_cast<PDB::CodeView::TPI::TypeRecordKind>(m_kinds[typeIndex - typeIndexBegin]);
+	}
+
+	// Returns whether a class or structure record is only a forward reference. False if there is no such record.
+	PDB_NO_DISCARD inline bool IsForwardRef(uint32_t typeIndex) const PDB_NO_EXCEPT
+	{
+		if (!IsInRange(typeIndex))
+			return false;
+
+		const uint32_t i = typeIndex - typeIndexBegin;
+		return (m_fwdRefBits[i / 8] >> (i % 8)) & 1;
+	}
+
+	// Returns type indices of all LF_CLASS/LF_STRUCTURE/LF_CLASS2 records which are not forward references.
+	// Only the dense kind index is scanned, records are not dereferenced.
+	PDB_NO_DISCARD std::vector<uint32_t> FindClassDefinitions(void) const;
+
+	// Returns the first LF_CLASS/LF_STRUCTURE definition with the given name, or 0 if there is none.
+	// Definitions are indexed by name on first use, so resolving forward references is a hash lookup.
+	PDB_NO_DISCARD uint32_t FindDefinition(std::string_view name) const;
+
 private:
+	// Whether there is a record for the index. typeIndexEnd is one past the last record.
+	PDB_NO_DISCARD inline bool IsInRange(uint32_t typeIndex) const PDB_NO_EXCEPT
+	{
+		return typeIndex >= typeIndexBegin && typeIndex - typeIndexBegin < m_recordCount;
+	}
+
 	uint32_t typeIndexBegin;
 	uint32_t typeIndexEnd;
 
 	size_t m_recordCount;
 	const PDB::CodeView::TPI::Record **m_records;
 
+	// Record kind of every type, indexed the same way as m_records.
+	uint16_t* m_kinds;
+
+	// One bit per type, set for class records with property.fwdref.
+	uint8_t* m_fwdRefBits;
+
 	PDB::CoalescedMSFStream m_stream;
 
+	// Name -> first definition, built by FindDefinition.
+	mutable std::unordered_map<std::string_view, uint32_t> m_definitions;
+	mutable bool m_hasDefinitions = false;
+
 	PDB_DISABLE_COPY(TypeTable);
 };
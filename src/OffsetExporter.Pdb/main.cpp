@@ -1,6 +1,25 @@
-#include <boost/json.hpp>
 #include <boost/program_options.hpp>
+#include "AllocationStats.h"
+#include "AmxxTypeRules.h"
+#include "ClassList.h"
+#include "CodeViewLeaf.h"
+#include "Declarator.h"
+#include "FieldListIndex.h"
+#include "HeaderWriter.h"
+#include "InheritanceGraph.h"
+#include "InputSource.h"
+#include "IoBenchmark.h"
+#include "LayoutModel.h"
+#include "LayoutOptimizer.h"
+#include "LayoutReport.h"
+#include "LayoutWriter.h"
 #include "MemoryMappedFile.h"
+#include "NameIndex.h"
+#include "NestedLayouts.h"
+#include "OutputFile.h"
+#include "ResultCache.h"
+#include "Stopwatch.h"
+#include "SymbolIndex.h"
 #include "TypeTable.h"
 
 namespace po = boost::program_options;
@@ -75,104 +94,15 @@ bool HasValidDBIStreams(const PDB::RawFile& rawPdbFile, const PDB::DBIStream& db
     return true;
 }
 
-uint8_t GetLeafSize(PDB::CodeView::TPI::TypeRecordKind kind)
+static void PrependModifierName(Declarator& decl, const PDB::CodeView::TPI::Record* modifierRecord)
 {
-    if (kind < PDB::CodeView::TPI::TypeRecordKind::LF_NUMERIC)
-    {
-        // No leaf can have an index less than LF_NUMERIC (0x8000)
-        // so word is the value...
-        return sizeof(PDB::CodeView::TPI::TypeRecordKind);
-    }
-
-    switch (kind)
-    {
-    case PDB::CodeView::TPI::TypeRecordKind::LF_CHAR:
-        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint8_t);
-
-    case PDB::CodeView::TPI::TypeRecordKind::LF_USHORT:
-    case PDB::CodeView::TPI::TypeRecordKind::LF_SHORT:
-        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint16_t);
-
-    case PDB::CodeView::TPI::TypeRecordKind::LF_LONG:
-    case PDB::CodeView::TPI::TypeRecordKind::LF_ULONG:
-        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint32_t);
-
-    case PDB::CodeView::TPI::TypeRecordKind::LF_QUADWORD:
-    case PDB::CodeView::TPI::TypeRecordKind::LF_UQUADWORD:
-        return sizeof(PDB::CodeView::TPI::TypeRecordKind) + sizeof(uint64_t);
-
-    default:
-        printf("Error! 0x%04x bogus type encountered, aborting...\n", PDB_AS_UNDERLYING(kind));
-    }
-    return 0;
-}
-
-template <typename T>
-T UnalignedRead(const char* data)
-{
-	T value = {};
-	memcpy(&value, data, sizeof(T));
-	return value;
-}
-
-uint64_t ReadUIntLeaf(const char* data, PDB::CodeView::TPI::TypeRecordKind kind)
-{
-	const char* leafData = data + sizeof(PDB::CodeView::TPI::TypeRecordKind);
-
-	switch (kind)
-	{
-	case PDB::CodeView::TPI::TypeRecordKind::LF_CHAR:
-		return UnalignedRead<uint8_t>(leafData);
-
-	case PDB::CodeView::TPI::TypeRecordKind::LF_USHORT:
-	case PDB::CodeView::TPI::TypeRecordKind::LF_SHORT:
-		return UnalignedRead<uint16_t>(leafData);
-
-	case PDB::CodeView::TPI::TypeRecordKind::LF_LONG:
-	case PDB::CodeView::TPI::TypeRecordKind::LF_ULONG:
-		return UnalignedRead<uint32_t>(leafData);
-
-	case PDB::CodeView::TPI::TypeRecordKind::LF_QUADWORD:
-	case PDB::CodeView::TPI::TypeRecordKind::LF_UQUADWORD:
-		return UnalignedRead<uint64_t>(leafData);
-
-	default:
-		printf("Error! 0x%04x bogus type encountered, aborting...\n", PDB_AS_UNDERLYING(kind));
-	}
-
-	return 0;
-}
-
-uint64_t ReadSizeLeaf(const char* data)
-{
-	auto kind = UnalignedRead<PDB::CodeView::TPI::TypeRecordKind>(data);
-
-	if (kind < PDB::CodeView::TPI::TypeRecordKind::LF_NUMERIC)
-	{
-		// Kind itself is the size
-		return (uint64_t)kind;
-	}
-
-	return ReadUIntLeaf(data, kind);
-}
-
-const char* GetLeafName(const char* data, PDB::CodeView::TPI::TypeRecordKind kind)
-{
-    return &data[GetLeafSize(kind)];
-}
-
-static std::string GetModifierName(const PDB::CodeView::TPI::Record* modifierRecord)
-{
-	std::string result;
-
-	if (modifierRecord->data.LF_MODIFIER.attr.MOD_const)
-		result += "const ";
-	if (modifierRecord->data.LF_MODIFIER.attr.MOD_volatile)
-		result += "volatile";
+	// Last to first, so they read "const volatileunaligned"
 	if (modifierRecord->data.LF_MODIFIER.attr.MOD_unaligned)
-		result += "unaligned";
-
-	return result;
+		decl.Prepend("unaligned");
+	if (modifierRecord->data.LF_MODIFIER.attr.MOD_volatile)
+		decl.Prepend("volatile");
+	if (modifierRecord->data.LF_MODIFIER.attr.MOD_const)
+		decl.Prepend("const ");
 }
 
 uint32_t ResolveTypes(const TypeTable& typeTable, uint32_t typeIndex,
@@ -219,26 +149,11 @@ uint32_t ResolveFwdRef(const TypeTable& typeTable, uint32_t typeIndex)
 		record->header.kind != PDB::CodeView::TPI::TypeRecordKind::LF_CLASS)
 		return typeIndex;
 
-	auto leafName = GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind);
-
-	for (uint32_t i = typeTable.GetFirstTypeIndex(); i <= typeTable.GetLastTypeIndex(); i++)
-	{
-		auto record2 = typeTable.GetTypeRecord(i);
-
-		if (record2->header.kind != PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE &&
-			record2->header.kind != PDB::CodeView::TPI::TypeRecordKind::LF_CLASS)
-			continue;
-
-		if (record2->data.LF_CLASS.property.fwdref)
-			continue;
-
-		auto leafName2 = GetLeafName(record2->data.LF_CLASS.data, record2->data.LF_CLASS.lfEasy.kind);
-
-		if (!strcmp(leafName, leafName2))
-			return i;
-	}
+	if (!record->data.LF_CLASS.property.fwdref)
+		return typeIndex;
 
-	return typeIndex;
+	uint32_t definition = typeTable.FindDefinition(GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind));
+	return definition != 0 ? definition : typeIndex;
 }
 
 static const char* GetTypeName(const TypeTable& typeTable, uint32_t typeIndex, uint8_t& pointerLevel, const PDB::CodeView::TPI::Record** referencedType, const PDB::CodeView::TPI::Record** modifierRecord)
@@ -759,13 +674,11 @@ static uint64_t GetTypeSize(
 
 		case PDB::CodeView::TPI::TypeRecordKind::LF_UNION:
 		{
-			// TODO
-			return 0;
+			return ReadSizeLeaf(typeRecord->data.LF_UNION.data);
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_ENUM:
 		{
-			// TODO
-			return 0;
+			return GetTypeSize(typeTable, typeRecord->data.LF_ENUM.utype);
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_MFUNCTION:
 		{
@@ -782,8 +695,92 @@ static uint64_t GetTypeSize(
 	return 0;
 }
 
-static const char* ConvertTypeToAmxx(
+//! Size of a vtable pointer. Slots are 4 bytes apart, see FieldListIndex.
+constexpr uint64_t VTABLE_POINTER_SIZE = 4;
+
+//! Natural alignment of a type in bytes, 0 if unknown. The PDB doesn't record #pragma pack, so members of
+//! packed classes report the alignment they would have without it.
+static uint64_t GetTypeAlignment(
+	const TypeTable& typeTable,
+	FieldListIndex& fieldLists,
+	uint32_t typeIndex)
+{
+	// Primitives and pointers to them are aligned to their size
+	if (typeIndex < typeTable.GetFirstTypeIndex())
+		return GetTypeSize(typeTable, typeIndex);
+
+	auto typeRecord = typeTable.GetTypeRecord(typeIndex);
+	if (!typeRecord)
+		return 0;
+
+	switch (typeRecord->header.kind)
+	{
+	case PDB::CodeView::TPI::TypeRecordKind::LF_MODIFIER:
+		return GetTypeAlignment(typeTable, fieldLists, typeRecord->data.LF_MODIFIER.type);
+	case PDB::CodeView::TPI::TypeRecordKind::LF_POINTER:
+		return GetTypeSize(typeTable, typeIndex);
+	case PDB::CodeView::TPI::TypeRecordKind::LF_BITFIELD:
+		return GetTypeAlignment(typeTable, fieldLists, typeRecord->data.LF_BITFIELD.type);
+	case PDB::CodeView::TPI::TypeRecordKind::LF_ARRAY:
+		return GetTypeAlignment(typeTable, fieldLists, typeRecord->data.LF_ARRAY.elemtype);
+	case PDB::CodeView::TPI::TypeRecordKind::LF_ENUM:
+		return GetTypeAlignment(typeTable, fieldLists, typeRecord->data.LF_ENUM.utype);
+	case PDB::CodeView::TPI::TypeRecordKind::LF_CLASS:
+	case PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE:
+	case PDB::CodeView::TPI::TypeRecordKind::LF_UNION:
+	{
+		const bool isUnion = typeRecord->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_UNION;
+		auto record = typeTable.GetTypeRecord(isUnion ? typeIndex : ResolveFwdRef(typeTable, typeIndex));
+
+		if (isUnion ? record->data.LF_UNION.property.fwdref : record->data.LF_CLASS.property.fwdref)
+			return 0;
+
+		uint32_t fieldListTypeIndex = isUnion ? record->data.LF_UNION.field : record->data.LF_CLASS.field;
+
+		if (!typeTable.GetTypeRecord(fieldListTypeIndex))
+			return 1;
+
+		// Every class is walked once, however often it's used as a member or base
+		uint64_t alignment = fieldLists.FindAlignment(fieldListTypeIndex);
+
+		if (alignment != 0)
+			return alignment;
+
+		alignment = 1;
+		auto members = fieldLists.Decode(fieldListTypeIndex);
+
+		for (uint32_t i = members.begin; i < members.end; i++)
+		{
+			switch (fieldLists.GetKind(i))
+			{
+			case FieldListIndex::MemberKind::Member:
+			case FieldListIndex::MemberKind::BaseClass:
+				alignment = std::max(alignment, GetTypeAlignment(typeTable, fieldLists, fieldLists.GetTypeIndex(i)));
+				break;
+			case FieldListIndex::MemberKind::VFuncTab:
+				alignment = std::max(alignment, GetTypeSize(typeTable, fieldLists.GetTypeIndex(i)));
+				break;
+			case FieldListIndex::MemberKind::Method:
+				// Introducing a slot means there is a vtable pointer, even if LF_VFUNCTAB is missing
+				if (fieldLists.GetVTableSlot(i) >= 0)
+					alignment = std::max(alignment, VTABLE_POINTER_SIZE);
+				break;
+			default:
+				break;
+			}
+		}
+
+		fieldLists.SetAlignment(fieldListTypeIndex, alignment);
+		return alignment;
+	}
+	default:
+		return 0;
+	}
+}
+
+static std::string_view ConvertTypeToAmxx(
 	const TypeTable& typeTable,
+	const AmxxTypeRules& rules,
 	uint32_t typeIndex)
 {
 	auto typeIndexBegin = typeTable.GetFirstTypeIndex();
@@ -953,7 +950,7 @@ static const char* ConvertTypeToAmxx(
 		{
 		case PDB::CodeView::TPI::TypeRecordKind::LF_MODIFIER:
 		{
-			return ConvertTypeToAmxx(typeTable, typeRecord->data.LF_MODIFIER.type);
+			return ConvertTypeToAmxx(typeTable, rules, typeRecord->data.LF_MODIFIER.type);
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_POINTER:
 		{
@@ -975,14 +972,10 @@ static const char* ConvertTypeToAmxx(
 						resTypeRecord->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE2)
 					{
 						const char* className = GetLeafName(resTypeRecord->data.LF_CLASS.data, resTypeRecord->data.LF_CLASS.lfEasy.kind);
+						std::string_view amxxType = rules.Match(AmxxTypeRules::Kind::Pointee, className);
 
-						if (!strcmp(className, "entvars_s"))
-							return "entvars";
-						if (!strcmp(className, "edict_s"))
-							return "edict";
-
-						if (className[0] == 'C')
-							return "classptr";
+						if (!amxxType.empty())
+							return amxxType;
 					}
 					else if (resTypeRecord->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_MFUNCTION)
 					{
@@ -1001,7 +994,7 @@ static const char* ConvertTypeToAmxx(
 				static_cast<PDB::CodeView::TPI::TypeIndexKind>(resolvedType) == PDB::CodeView::TPI::TypeIndexKind::T_RCHAR)
 				return "string";
 
-			return ConvertTypeToAmxx(typeTable, typeRecord->data.LF_ARRAY.elemtype);
+			return ConvertTypeToAmxx(typeTable, rules, typeRecord->data.LF_ARRAY.elemtype);
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_CLASS:
 		case PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE:
@@ -1010,14 +1003,11 @@ static const char* ConvertTypeToAmxx(
 		case PDB::CodeView::TPI::TypeRecordKind::LF_UNION:
 		{
 			const char* className = GetLeafName(typeRecord->data.LF_CLASS.data, typeRecord->data.LF_CLASS.lfEasy.kind);
-			if (!strcmp(className, "Vector"))
-				return "vector";
-			if (!strcmp(className, "EHANDLE"))
-				return "ehandle";
-			return "structure";
+			std::string_view amxxType = rules.Match(AmxxTypeRules::Kind::Type, className);
+			return !amxxType.empty() ? amxxType : "structure";
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_ENUM:
-			return ConvertTypeToAmxx(typeTable, typeRecord->data.LF_ENUM.utype);
+			return ConvertTypeToAmxx(typeTable, rules, typeRecord->data.LF_ENUM.utype);
 		case PDB::CodeView::TPI::TypeRecordKind::LF_MFUNCTION:
 		{
 			return "function";
@@ -1032,16 +1022,24 @@ static const char* ConvertTypeToAmxx(
 	return "unknown_type";
 }
 
-static std::string ConvertTypeToCString(
+static std::string_view ConvertTypeToCString(
+	fmt::memory_buffer& out,
 	std::string_view fieldName,
 	const TypeTable& typeTable,
 	uint32_t typeIndex,
+	uint64_t* outArraySize);
+
+//! Completes the declarator with the type. Every level adds to decl, the result is only built at the end.
+static void AppendTypeDeclarator(
+	Declarator& decl,
+	const TypeTable& typeTable,
+	uint32_t typeIndex,
 	uint64_t* outArraySize)
 {
 	auto typeIndexBegin = typeTable.GetFirstTypeIndex();
 	if (typeIndex < typeIndexBegin)
 	{
-		std::string result;
+		std::string_view result;
 		auto type = static_cast<PDB::CodeView::TPI::TypeIndexKind>(typeIndex);
 		switch (type)
 		{
@@ -1243,43 +1241,48 @@ static std::string ConvertTypeToCString(
 			result = "unhandled_special_type"; break;
 		}
 
-		if (!fieldName.empty())
-			return fmt::format("{} {}", result, fieldName);
-		else
-			return result;
+		if (!decl.IsEmpty())
+			decl.Prepend(" ");
+
+		decl.Prepend(result);
+		return;
 	}
 	else
 	{
 		auto typeRecord = typeTable.GetTypeRecord(typeIndex);
 		if (!typeRecord)
-			return "";
+		{
+			decl.Reset("");
+			return;
+		}
 
 		switch (typeRecord->header.kind)
 		{
 		case PDB::CodeView::TPI::TypeRecordKind::LF_MODIFIER:
 		{
-			std::string modifiers = GetModifierName(typeRecord);
-			return ConvertTypeToCString(modifiers + std::string(fieldName), typeTable, typeRecord->data.LF_MODIFIER.type, outArraySize);
+			PrependModifierName(decl, typeRecord);
+			return AppendTypeDeclarator(decl, typeTable, typeRecord->data.LF_MODIFIER.type, outArraySize);
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_POINTER:
 		{
-			std::string pointerMods;
-
-			if (typeRecord->data.LF_POINTER.attr.isconst)
-				pointerMods += "const ";
-			if (typeRecord->data.LF_POINTER.attr.isvolatile)
-				pointerMods += "volatile ";
 			if (typeRecord->data.LF_POINTER.attr.isunaligned)
-				pointerMods += "unaligned ";
+				decl.Prepend("unaligned ");
+			if (typeRecord->data.LF_POINTER.attr.isvolatile)
+				decl.Prepend("volatile ");
+			if (typeRecord->data.LF_POINTER.attr.isconst)
+				decl.Prepend("const ");
 
-			return ConvertTypeToCString(fmt::format("*{}{}", pointerMods, fieldName), typeTable, typeRecord->data.LF_POINTER.utype, nullptr);
+			decl.Prepend("*");
+			return AppendTypeDeclarator(decl, typeTable, typeRecord->data.LF_POINTER.utype, nullptr);
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_PROCEDURE:
 			// TODO??
-			return fmt::format("LF_PROCEDURE {}", fieldName);
+			decl.Prepend("LF_PROCEDURE ");
+			return;
 		case PDB::CodeView::TPI::TypeRecordKind::LF_BITFIELD:
 			// TODO??
-			return fmt::format("LF_BITFIELD {}", fieldName);
+			decl.Prepend("LF_BITFIELD ");
+			return;
 		case PDB::CodeView::TPI::TypeRecordKind::LF_ARRAY:
 		{
 			// TODO 2024-11-10: Can be larger than uint16_t
@@ -1291,13 +1294,15 @@ static std::string ConvertTypeToCString(
 				uint64_t elemCount = arraySizeInBytes / elemSizeInBytes;
 				if (outArraySize)
 					*outArraySize = elemCount;
-				return ConvertTypeToCString(fmt::format("{}[{}]", fieldName, elemCount), typeTable, typeRecord->data.LF_ARRAY.elemtype, nullptr);
+				decl.AppendFormat("[{}]", elemCount);
+				return AppendTypeDeclarator(decl, typeTable, typeRecord->data.LF_ARRAY.elemtype, nullptr);
 			}
 			else
 			{
 				if (outArraySize)
 					*outArraySize = 0;
-				return ConvertTypeToCString(fmt::format("{}[]", fieldName), typeTable, typeRecord->data.LF_ARRAY.elemtype, nullptr);
+				decl.Append("[]");
+				return AppendTypeDeclarator(decl, typeTable, typeRecord->data.LF_ARRAY.elemtype, nullptr);
 			}
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_CLASS:
@@ -1305,31 +1310,40 @@ static std::string ConvertTypeToCString(
 		{
 			const char* className = GetLeafName(typeRecord->data.LF_CLASS.data, typeRecord->header.kind);
 
-			if (!fieldName.empty())
-				return fmt::format("{} {}", className, fieldName);
-			else
-				return className;
+			if (!decl.IsEmpty())
+				decl.Prepend(" ");
+
+			decl.Prepend(className);
+			return;
 		}
 		case PDB::CodeView::TPI::TypeRecordKind::LF_CLASS2:
 		case PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE2:
 		{
 			const char* className = GetLeafName(typeRecord->data.LF_CLASS2.data, typeRecord->header.kind);
 
-			if (!fieldName.empty())
-				return fmt::format("{} {}", className, fieldName);
-			else
-				return className;
+			if (!decl.IsEmpty())
+				decl.Prepend(" ");
+
+			decl.Prepend(className);
+			return;
 		}
 
 		case PDB::CodeView::TPI::TypeRecordKind::LF_UNION:
-			return fmt::format("{} {}", GetLeafName(typeRecord->data.LF_UNION.data, typeRecord->header.kind), fieldName);
+			decl.Prepend(" ");
+			decl.Prepend(GetLeafName(typeRecord->data.LF_UNION.data, typeRecord->header.kind));
+			return;
 		case PDB::CodeView::TPI::TypeRecordKind::LF_ENUM:
-			return fmt::format("{} {}", &typeRecord->data.LF_ENUM.name[0], fieldName);
+			decl.Prepend(" ");
+			decl.Prepend(&typeRecord->data.LF_ENUM.name[0]);
+			return;
 		case PDB::CodeView::TPI::TypeRecordKind::LF_MFUNCTION:
 		{
-			std::string result;
-			std::string returnType = ConvertTypeToCString(std::string_view(), typeTable, typeRecord->data.LF_MFUNCTION.rvtype, nullptr);
-			result = fmt::format("{} ({})(", returnType, fieldName);
+			// Return and argument types are declarations of their own
+			fmt::memory_buffer part;
+
+			decl.Prepend(" (");
+			decl.Prepend(ConvertTypeToCString(part, std::string_view(), typeTable, typeRecord->data.LF_MFUNCTION.rvtype, nullptr));
+			decl.Append(")(");
 
 			auto argList = typeTable.GetTypeRecord(typeRecord->data.LF_MFUNCTION.arglist);
 			
@@ -1338,13 +1352,13 @@ static std::string ConvertTypeToCString(
 				uint32_t argTypeIdx = argList->data.LF_ARGLIST.arg[argIdx];
 				
 				if (argIdx != 0)
-					result += ", ";
+					decl.Append(", ");
 
-				result += ConvertTypeToCString(std::string_view(), typeTable, argTypeIdx, nullptr);
+				decl.Append(ConvertTypeToCString(part, std::string_view(), typeTable, argTypeIdx, nullptr));
 			}
 
-			result += ")";
-			return result;
+			decl.Append(")");
+			return;
 		}
 
 		default:
@@ -1353,240 +1367,454 @@ static std::string ConvertTypeToCString(
 		}
 	}
 
-	return "unknown_type";
+	decl.Reset("unknown_type");
+}
+
+//! Renders the declaration of fieldName into out, which is reused between calls.
+static std::string_view ConvertTypeToCString(
+	fmt::memory_buffer& out,
+	std::string_view fieldName,
+	const TypeTable& typeTable,
+	uint32_t typeIndex,
+	uint64_t* outArraySize)
+{
+	Declarator decl(fieldName);
+	AppendTypeDeclarator(decl, typeTable, typeIndex, outArraySize);
+
+	out.clear();
+	decl.WriteTo(out);
+	return std::string_view(out.data(), out.size());
 }
 
-const char* GetMethodName(const PDB::CodeView::TPI::FieldList* fieldRecord)
+//! Describes a data member of a field list.
+static void DescribeMember(const TypeTable& typeTable, const AmxxTypeRules& rules, FieldListIndex& fieldLists, std::string_view memberName, uint32_t typeIndex,
+	uint64_t offset, fmt::memory_buffer& typeNameBuf, LayoutModel::FieldDesc& field)
 {
-	auto methodAttributes = static_cast<PDB::CodeView::TPI::MethodProperty>(fieldRecord->data.LF_ONEMETHOD.attributes.mprop);
-	switch (methodAttributes)
+	uint64_t arraySize = 0;
+	std::string_view typeName = ConvertTypeToCString(typeNameBuf, memberName, typeTable, typeIndex, &arraySize);
+	std::string_view amxxType = ConvertTypeToAmxx(typeTable, rules, typeIndex);
+
+	// PDBs have no typedefs, so string_t can only be recognized by the field name
+	std::string_view fieldAmxxType = rules.MatchField(memberName, amxxType);
+	bool isStringT = false;
+
+	if (!fieldAmxxType.empty())
 	{
-	case PDB::CodeView::TPI::MethodProperty::Intro:
-	case PDB::CodeView::TPI::MethodProperty::PureIntro:
-		return &reinterpret_cast<const char*>(fieldRecord->data.LF_ONEMETHOD.vbaseoff)[sizeof(uint32_t)];
-	default:
-		break;
+		amxxType = fieldAmxxType;
+		isStringT = amxxType == "stringint";
+
+		if (isStringT)
+		{
+			typeNameBuf.clear();
+			fmt::format_to(std::back_inserter(typeNameBuf), "string_t {}", memberName);
+			typeName = std::string_view(typeNameBuf.data(), typeNameBuf.size());
+		}
+	}
+
+	field.name = memberName;
+	field.offset = offset;
+	field.arraySize = arraySize != 0 ? arraySize : LayoutModel::NO_ARRAY_SIZE;
+	field.size = GetTypeSize(typeTable, typeIndex);
+	field.alignment = static_cast<uint32_t>(GetTypeAlignment(typeTable, fieldLists, typeIndex));
+	field.type = typeName;
+	field.amxxType = amxxType;
+
+	if (!isStringT && amxxType != "stringptr" && amxxType != "string")
+	{
+		switch (static_cast<PDB::CodeView::TPI::TypeIndexKind>(ResolveTypes(typeTable, typeIndex, true, true, true)))
+		{
+		case PDB::CodeView::TPI::TypeIndexKind::T_CHAR:
+		case PDB::CodeView::TPI::TypeIndexKind::T_RCHAR:
+		case PDB::CodeView::TPI::TypeIndexKind::T_SHORT:
+		case PDB::CodeView::TPI::TypeIndexKind::T_LONG:
+		case PDB::CodeView::TPI::TypeIndexKind::T_QUAD:
+		case PDB::CodeView::TPI::TypeIndexKind::T_INT4:
+		case PDB::CodeView::TPI::TypeIndexKind::T_INT8:
+			field.signedness = LayoutModel::Signedness::Signed;
+			break;
+
+		case PDB::CodeView::TPI::TypeIndexKind::T_UCHAR:
+		case PDB::CodeView::TPI::TypeIndexKind::T_USHORT:
+		case PDB::CodeView::TPI::TypeIndexKind::T_ULONG:
+		case PDB::CodeView::TPI::TypeIndexKind::T_UQUAD:
+		case PDB::CodeView::TPI::TypeIndexKind::T_UINT4:
+		case PDB::CodeView::TPI::TypeIndexKind::T_UINT8:
+			field.signedness = LayoutModel::Signedness::Unsigned;
+			break;
+		}
+	}
+
+}
+
+//! Returns the structure or class of a member, or of its elements if it's a one-dimensional array.
+static NestedLayouts::NestedType FindNestedType(const TypeTable& typeTable, uint32_t typeIndex)
+{
+	typeIndex = ResolveTypes(typeTable, typeIndex, true);
+	auto record = typeTable.GetTypeRecord(typeIndex);
+	bool isArray = record && record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_ARRAY;
+
+	if (isArray)
+	{
+		typeIndex = ResolveTypes(typeTable, record->data.LF_ARRAY.elemtype, true);
+		record = typeTable.GetTypeRecord(typeIndex);
+	}
+
+	if (!record || (record->header.kind != PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE &&
+		record->header.kind != PDB::CodeView::TPI::TypeRecordKind::LF_CLASS))
+		return {};
+
+	// Resolving the size may need a scan for the definition, only arrays need it
+	uint64_t size = isArray ? GetTypeSize(typeTable, typeIndex) : 0;
+
+	if (isArray && size == 0)
+		return {};
+
+	return NestedLayouts::NestedType { typeIndex, size };
+}
+
+//! Adds the data members of a structure to layouts. The key is the type index the member refers to, which
+//! may be a forward reference: each one is resolved once.
+static void DecodeNestedType(const TypeTable& typeTable, const AmxxTypeRules& rules, FieldListIndex& fieldLists, NestedLayouts& layouts, uint64_t typeIndex)
+{
+	auto record = typeTable.GetTypeRecord(ResolveFwdRef(typeTable, static_cast<uint32_t>(typeIndex)));
+
+	if (!record || !typeTable.GetTypeRecord(record->data.LF_CLASS.field))
+		return;
+
+	auto members = fieldLists.Decode(record->data.LF_CLASS.field);
+	fmt::memory_buffer typeNameBuf;
+
+	for (uint32_t i = members.begin; i < members.end; i++)
+	{
+		if (fieldLists.GetKind(i) != FieldListIndex::MemberKind::Member)
+			continue;
+
+		LayoutModel::FieldDesc field;
+		DescribeMember(typeTable, rules, fieldLists, fieldLists.GetName(i), fieldLists.GetTypeIndex(i), fieldLists.GetOffset(i), typeNameBuf, field);
+		layouts.AddMember(field, FindNestedType(typeTable, fieldLists.GetTypeIndex(i)));
 	}
+}
 
-	return  &reinterpret_cast<const char*>(fieldRecord->data.LF_ONEMETHOD.vbaseoff)[0];
+//! Whether a method overrides a virtual method of a base. Overrides have no vtable offset in the PDB.
+bool IsOverridingMethod(PDB::CodeView::TPI::MemberAttributes attributes)
+{
+	auto methodProp = static_cast<PDB::CodeView::TPI::MethodProperty>(attributes.mprop);
+	return methodProp == PDB::CodeView::TPI::MethodProperty::Virtual ||
+		methodProp == PDB::CodeView::TPI::MethodProperty::PureVirt;
 }
 
-void DisplayFields(const TypeTable& typeTable, const PDB::CodeView::TPI::Record* record, boost::json::object& jClass)
+//! Identifies the parameter list of a method. Identical LF_ARGLIST records are merged in the PDB,
+//! so an override has the same one as the method it overrides.
+uint64_t GetMethodSignature(const TypeTable& typeTable, uint32_t methodTypeIndex)
 {
-	const char* leafName = nullptr;
+	auto record = typeTable.GetTypeRecord(methodTypeIndex);
 
-	auto maximumSize = record->header.size - sizeof(uint16_t);
+	if (!record || record->header.kind != PDB::CodeView::TPI::TypeRecordKind::LF_MFUNCTION)
+		return 0;
 
-	boost::json::array jFields;
-	boost::json::array jVTable;
+	return record->data.LF_MFUNCTION.arglist;
+}
+
+void DisplayFields(const TypeTable& typeTable, const AmxxTypeRules& rules, FieldListIndex& fieldLists, const SymbolIndex* symbols, std::string_view className, uint32_t fieldListTypeIndex, LayoutModel& model,
+	NestedLayouts* nestedLayouts)
+{
+	auto members = fieldLists.Decode(fieldListTypeIndex);
+	fmt::memory_buffer typeNameBuf;
+	uint32_t baseCls = UINT32_MAX;
 
-	for (size_t i = 0; i < maximumSize;)
+	for (uint32_t i = members.begin; i < members.end; i++)
 	{
-		uint8_t pointerLevel = 0;
-		auto fieldRecord = reinterpret_cast<const PDB::CodeView::TPI::FieldList*>(reinterpret_cast<const uint8_t*>(&record->data.LF_FIELD.list) + i);
-
-		// Other kinds of records are not implemented
-		PDB_ASSERT(
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_BCLASS ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VBCLASS ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_IVBCLASS ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_INDEX ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VFUNCTAB ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_NESTTYPE ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_ENUM ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_MEMBER ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_STMEMBER ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_METHOD ||
-			fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_ONEMETHOD,
-			"Unknown record kind %X",
-			static_cast<unsigned int>(fieldRecord->kind));
-
-		if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_MEMBER)
+		std::string_view leafName = fieldLists.GetName(i);
+		uint32_t typeIndex = fieldLists.GetTypeIndex(i);
+
+		switch (fieldLists.GetKind(i))
+		{
+		case FieldListIndex::MemberKind::Member:
 		{
-			uint64_t offset = ReadSizeLeaf(fieldRecord->data.LF_MEMBER.offset);
+			uint64_t offset = fieldLists.GetOffset(i);
 
-			uint64_t arraySize = 0;
-			leafName = GetLeafName(fieldRecord->data.LF_MEMBER.offset, fieldRecord->data.LF_MEMBER.lfEasy.kind);
-			std::string typeName = ConvertTypeToCString(leafName, typeTable, fieldRecord->data.LF_MEMBER.index, &arraySize);
-			std::string_view amxxType = ConvertTypeToAmxx(typeTable, fieldRecord->data.LF_MEMBER.index);
+			LayoutModel::FieldDesc field;
+			DescribeMember(typeTable, rules, fieldLists, leafName, typeIndex, offset, typeNameBuf, field);
 
-			bool isStringT = false;
+			model.AddField(field);
+			printf("[0x%llX]%.*s\n", offset, static_cast<int>(field.type.size()), field.type.data());
 
-			if (amxxType == "integer")
+			if (nestedLayouts)
 			{
-				// Check if this is a string_t
-				std::string_view leafNameView = leafName;
-				isStringT =
-					leafNameView.starts_with("m_str") ||
-					leafNameView.starts_with("m_isz") ||
-					leafNameView == "m_sMaster" ||
-					leafNameView == "m_globalstate" ||
-					leafNameView == "m_altName";
-
-				if (isStringT)
+				nestedLayouts->Expand(model, field, FindNestedType(typeTable, typeIndex), [&](uint64_t key)
 				{
-					amxxType = "stringint";
-					typeName = fmt::format("string_t {}", leafName);
-				}
+					DecodeNestedType(typeTable, rules, fieldLists, *nestedLayouts, key);
+				});
 			}
 
-			boost::json::object jField;
-			jField["name"] = leafName;
-			jField["offset"] = offset;
-			jField["arraySize"] = arraySize != 0 ? boost::json::value(arraySize) : nullptr;
-			jField["type"] = typeName;
-			jField["amxxType"] = amxxType;
-			jField["unsigned"] = nullptr;
+			break;
+		}
+		case FieldListIndex::MemberKind::VFuncTab:
+			break;
+		case FieldListIndex::MemberKind::NestedType:
+		case FieldListIndex::MemberKind::StaticMember:
+		{
+			std::string_view typeName = ConvertTypeToCString(typeNameBuf, leafName, typeTable, typeIndex, nullptr);
+			printf("%.*s\n", static_cast<int>(typeName.size()), typeName.data());
+			break;
+		}
+		case FieldListIndex::MemberKind::Method:
+		{
+			// Add to vtable
+			int32_t vtableSlot = fieldLists.GetVTableSlot(i);
+			uint64_t signature = GetMethodSignature(typeTable, typeIndex);
+
+			// Bases are extracted and resolved first, an override takes the slot of the method it overrides
+			if (vtableSlot == -1 && baseCls != UINT32_MAX && IsOverridingMethod(fieldLists.GetMethodAttributes(i)))
+				vtableSlot = model.FindVirtualMethodSlot(baseCls, leafName, signature);
 
-			if (!isStringT && amxxType != "stringptr" && amxxType != "string")
+			if (vtableSlot != -1)
 			{
-				switch (static_cast<PDB::CodeView::TPI::TypeIndexKind>(ResolveTypes(typeTable, fieldRecord->data.LF_MEMBER.index, true, true, true)))
+				const SymbolIndex::Symbol* symbol = symbols ? symbols->FindVirtualMethod(className, leafName, typeIndex) : nullptr;
+
+				LayoutModel::VirtualMethodDesc method;
+				method.name = leafName;
+				method.index = vtableSlot;
+				method.signature = signature;
+
+				if (symbol)
 				{
-				case PDB::CodeView::TPI::TypeIndexKind::T_CHAR:
-				case PDB::CodeView::TPI::TypeIndexKind::T_RCHAR:
-				case PDB::CodeView::TPI::TypeIndexKind::T_SHORT:
-				case PDB::CodeView::TPI::TypeIndexKind::T_LONG:
-				case PDB::CodeView::TPI::TypeIndexKind::T_QUAD:
-				case PDB::CodeView::TPI::TypeIndexKind::T_INT4:
-				case PDB::CodeView::TPI::TypeIndexKind::T_INT8:
-					jField["unsigned"] = false;
-					break;
-
-				case PDB::CodeView::TPI::TypeIndexKind::T_UCHAR:
-				case PDB::CodeView::TPI::TypeIndexKind::T_USHORT:
-				case PDB::CodeView::TPI::TypeIndexKind::T_ULONG:
-				case PDB::CodeView::TPI::TypeIndexKind::T_UQUAD:
-				case PDB::CodeView::TPI::TypeIndexKind::T_UINT4:
-				case PDB::CodeView::TPI::TypeIndexKind::T_UINT8:
-					jField["unsigned"] = true;
-					break;
+					method.linkName = symbol->name;
+					method.rva = symbol->rva;
 				}
+
+				model.AddVirtualMethod(method);
 			}
 
-			jFields.push_back(std::move(jField));
-			printf("[0x%llX]%s\n", offset, typeName.c_str());
+			break;
 		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_NESTTYPE)
+		case FieldListIndex::MemberKind::BaseClass:
 		{
-			leafName = &fieldRecord->data.LF_NESTTYPE.name[0];
-			std::string typeName = ConvertTypeToCString(leafName, typeTable, fieldRecord->data.LF_NESTTYPE.index, nullptr);
+			model.SetBaseClass(leafName);
+			baseCls = model.FindClass(leafName);
 
-			printf("%s\n", typeName.c_str());
-		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_STMEMBER)
-		{
-			leafName = &fieldRecord->data.LF_STMEMBER.name[0];
-			std::string typeName = ConvertTypeToCString(leafName, typeTable, fieldRecord->data.LF_STMEMBER.index, nullptr);
+			if (baseCls != UINT32_MAX && !model.IsVTableResolved(baseCls))
+				baseCls = UINT32_MAX;
 
-			printf("%s\n", typeName.c_str());
+			break;
+		}
 		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_METHOD)
+	}
+}
+
+// The original candidate scan which dereferences every record. Only kept to benchmark the kind index against.
+std::vector<uint32_t> FindClassDefinitionsSlow(const TypeTable& typeTable)
+{
+	std::vector<uint32_t> result;
+	uint32_t typeIndex = typeTable.GetFirstTypeIndex();
+
+	for (const auto& record : typeTable.GetTypeRecords())
+	{
+		if (record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE ||
+			record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_CLASS ||
+			record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_CLASS2)
 		{
-			// Add to vtable
-			leafName = fieldRecord->data.LF_METHOD.name;
+			if (!record->data.LF_CLASS.property.fwdref)
+				result.push_back(typeIndex);
+		}
 
-			auto methodList = typeTable.GetTypeRecord(fieldRecord->data.LF_METHOD.mList);
-			if (methodList)
-			{
-				// https://github.com/microsoft/microsoft-pdb/blob/master/PDB/include/symtypeutils.h#L220
-				size_t offsetInMethodList = 0;
-				for (size_t j = 0; j < fieldRecord->data.LF_METHOD.count; j++)
-				{
-					size_t entrySize = 2 * sizeof(uint32_t);
-					PDB::CodeView::TPI::MethodListEntry* entry = (PDB::CodeView::TPI::MethodListEntry*)(methodList->data.LF_METHODLIST.mList + offsetInMethodList);
+		typeIndex++;
+	}
 
-					PDB::CodeView::TPI::MethodProperty methodProp = (PDB::CodeView::TPI::MethodProperty)entry->attributes.mprop;
+	return result;
+}
 
-					if (methodProp == PDB::CodeView::TPI::MethodProperty::Intro ||
-						methodProp == PDB::CodeView::TPI::MethodProperty::PureIntro)
-					{
-						// printf("METHOD %s %u %u\n", leafName, (uint32_t)methodAttributes, fieldRecord->data.LF_ONEMETHOD.vbaseoff[0] / 4);
-						boost::json::object jMethod;
-						jMethod["name"] = leafName;
-						jMethod["linkName"] = nullptr;
-						jMethod["index"] = entry->vbaseoff[0] / 4;
-						jVTable.push_back(std::move(jMethod));
-					}
+//! Reorders the definitions of listed classes so that every base comes before the classes derived from it.
+//! Overrides are matched against the resolved vtable of the base, and --flatten extends its layout.
+std::vector<uint32_t> OrderBasesFirst(const TypeTable& typeTable, FieldListIndex& fieldLists, const std::vector<uint32_t>& classTypeIndices,
+	const ClassList& classList)
+{
+	struct Definition
+	{
+		uint32_t typeIndex;
+		std::string_view baseName;
+		bool isVisited = false;
+	};
 
-					if (methodProp == PDB::CodeView::TPI::MethodProperty::Intro || methodProp == PDB::CodeView::TPI::MethodProperty::PureIntro)
-						entrySize += sizeof(uint32_t);
-					offsetInMethodList += entrySize;
-				}
-			}
-		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_ONEMETHOD)
-		{
-			// Add to vtable
-			leafName = GetMethodName(fieldRecord);
+	// Only the first definition of a name is extracted
+	std::unordered_map<std::string_view, Definition> definitions;
+	std::vector<std::string_view> names;
+
+	for (uint32_t classTypeIndex : classTypeIndices)
+	{
+		auto record = typeTable.GetTypeRecord(classTypeIndex);
+		if (!typeTable.GetTypeRecord(record->data.LF_CLASS.field))
+			continue;
+
+		std::string_view leafName = GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind);
 
-			auto methodAttributes = static_cast<PDB::CodeView::TPI::MethodProperty>(fieldRecord->data.LF_ONEMETHOD.attributes.mprop);
+		if (!classList.Contains(leafName) || !definitions.try_emplace(leafName, Definition { classTypeIndex, {}, false }).second)
+			continue;
+
+		auto members = fieldLists.Decode(record->data.LF_CLASS.field);
 
-			if (methodAttributes == PDB::CodeView::TPI::MethodProperty::Intro ||
-				methodAttributes == PDB::CodeView::TPI::MethodProperty::PureIntro)
+		for (uint32_t i = members.begin; i < members.end; i++)
+		{
+			if (fieldLists.GetKind(i) == FieldListIndex::MemberKind::BaseClass)
 			{
-				// printf("METHOD %s %u %u\n", leafName, (uint32_t)methodAttributes, fieldRecord->data.LF_ONEMETHOD.vbaseoff[0] / 4);
-				boost::json::object jMethod;
-				jMethod["name"] = leafName;
-				jMethod["linkName"] = nullptr;
-				jMethod["index"] = fieldRecord->data.LF_ONEMETHOD.vbaseoff[0] / 4;
-				jVTable.push_back(std::move(jMethod));
+				definitions[leafName].baseName = fieldLists.GetName(i);
+				break;
 			}
 		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_BCLASS)
-		{
-			leafName = GetLeafName(fieldRecord->data.LF_BCLASS.offset, fieldRecord->data.LF_BCLASS.lfEasy.kind);
 
-			auto baseTypeRecord = typeTable.GetTypeRecord(fieldRecord->data.LF_BCLASS.index);
-			if (baseTypeRecord)
-			{
-				auto baseLeafName = GetLeafName(baseTypeRecord->data.LF_CLASS.data, baseTypeRecord->data.LF_CLASS.lfEasy.kind);
-				jClass["baseClass"] = baseLeafName;
-			}
+		names.push_back(leafName);
+	}
 
-			i += static_cast<size_t>(leafName - reinterpret_cast<const char*>(fieldRecord));
-			i = (i + (sizeof(uint32_t) - 1)) & (0 - sizeof(uint32_t));
-			continue;
-		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VBCLASS || fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_IVBCLASS)
+	std::vector<uint32_t> result;
+	std::vector<std::string_view> chain;
+
+	for (std::string_view name : names)
+	{
+		// Collect the bases that are not placed yet, then place them outermost first
+		for (auto it = definitions.find(name); it != definitions.end() && !it->second.isVisited; it = definitions.find(it->second.baseName))
 		{
-			// virtual base pointer offset from address point
-			// followed by virtual base offset from vbtable
+			it->second.isVisited = true;
+			chain.push_back(it->first);
+		}
+
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+			result.push_back(definitions[*it].typeIndex);
+
+		chain.clear();
+	}
 
-			const  PDB::CodeView::TPI::TypeRecordKind vbpOffsetAddressPointKind = *(PDB::CodeView::TPI::TypeRecordKind*)(fieldRecord->data.LF_IVBCLASS.vbpOffset);
-			const uint8_t vbpOffsetAddressPointSize = GetLeafSize(vbpOffsetAddressPointKind);
+	return result;
+}
 
-			const  PDB::CodeView::TPI::TypeRecordKind vbpOffsetVBTableKind = *(PDB::CodeView::TPI::TypeRecordKind*)(fieldRecord->data.LF_IVBCLASS.vbpOffset + vbpOffsetAddressPointSize);
-			const uint8_t vbpOffsetVBTableSize = GetLeafSize(vbpOffsetVBTableKind);
+//! Indexes the first definition of every class name that has a field list, as the extraction loop uses it.
+NameIndex::Builder BuildNameIndex(const TypeTable& typeTable, const std::vector<uint32_t>& classTypeIndices)
+{
+	NameIndex::Builder builder;
 
-			i += sizeof(PDB::CodeView::TPI::FieldList::Data::LF_VBCLASS);
-			i += vbpOffsetAddressPointSize + vbpOffsetVBTableSize;
-			i = (i + (sizeof(uint32_t) - 1)) & (0 - sizeof(uint32_t));
+	for (uint32_t classTypeIndex : classTypeIndices)
+	{
+		auto record = typeTable.GetTypeRecord(classTypeIndex);
+		if (!typeTable.GetTypeRecord(record->data.LF_CLASS.field))
 			continue;
-		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_INDEX)
-		{
-			i += sizeof(PDB::CodeView::TPI::FieldList::Data::LF_INDEX);
-			i = (i + (sizeof(uint32_t) - 1)) & (0 - sizeof(uint32_t));
+
+		builder.Add(GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind), classTypeIndex, 0);
+	}
+
+	return builder;
+}
+
+//! Looks up the classes of the class list in the name index. Returns their type indices in ascending order,
+//! the order in which FindClassDefinitions returns them.
+std::vector<uint32_t> FindClasses(const NameIndex::Reader& nameIndex, const ClassList& classList)
+{
+	std::vector<uint32_t> classTypeIndices;
+
+	for (size_t i = 0; i < classList.GetCount(); i++)
+	{
+		if (const NameIndex::Entry* entry = nameIndex.Find(classList.GetName(i)))
+			classTypeIndices.push_back(static_cast<uint32_t>(entry->location));
+	}
+
+	std::sort(classTypeIndices.begin(), classTypeIndices.end());
+	fmt::println("Found {} of {} classes in the name index", classTypeIndices.size(), classList.GetCount());
+	return classTypeIndices;
+}
+
+//! Indexes the base classes of all class definitions and selects the roots and their derived classes,
+//! in addition to the ones already in classList. Returns the type indices of the selected definitions.
+std::vector<uint32_t> DiscoverClasses(const TypeTable& typeTable, FieldListIndex& fieldLists, const std::vector<uint32_t>& classTypeIndices,
+	std::string_view roots, ClassList& classList)
+{
+	InheritanceGraph graph;
+
+	for (uint32_t classTypeIndex : classTypeIndices)
+	{
+		auto record = typeTable.GetTypeRecord(classTypeIndex);
+		if (!typeTable.GetTypeRecord(record->data.LF_CLASS.field))
 			continue;
-		}
-		else if (fieldRecord->kind == PDB::CodeView::TPI::TypeRecordKind::LF_VFUNCTAB)
-		{
-			i += sizeof(PDB::CodeView::TPI::FieldList::Data::LF_VFUNCTAB);
-			i = (i + (sizeof(uint32_t) - 1)) & (0 - sizeof(uint32_t));
+
+		std::string_view leafName = GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind);
+
+		if (!graph.AddClass(leafName, classTypeIndex))
 			continue;
-		}
-		else
+
+		// Decoded field lists are cached for extraction
+		auto members = fieldLists.Decode(record->data.LF_CLASS.field);
+
+		for (uint32_t i = members.begin; i < members.end; i++)
 		{
-			break;
+			if (fieldLists.GetKind(i) == FieldListIndex::MemberKind::BaseClass)
+				graph.AddBase(leafName, fieldLists.GetName(i));
 		}
+	}
+
+	std::vector<std::string_view> names;
+	std::vector<uint32_t> result;
+
+	for (size_t i = 0; i < classList.GetCount(); i++)
+		names.push_back(classList.GetName(i));
+
+	std::vector<InheritanceGraph::Class> classes = graph.CollectDerived(InheritanceGraph::ParseNameList(roots), names);
+	fmt::println("Found {} classes under {} or in the class list among {} class definitions", classes.size(), roots, graph.GetClassCount());
+
+	for (const InheritanceGraph::Class& cls : classes)
+	{
+		names.push_back(cls.name);
+		result.push_back(static_cast<uint32_t>(cls.location));
+	}
+
+	ClassList combined;
+	combined.Build(names);
+	classList = std::move(combined);
+	return result;
+}
+
+void PrintPageStats(const MemoryMappedFile::Handle& pdbFile, std::string_view stage, const Stopwatch& timer)
+{
+	fmt::println("{}: {:.3f} ms, {} of {} pages resident",
+		stage, timer.ElapsedMs(), MemoryMappedFile::GetResidentPageCount(pdbFile), MemoryMappedFile::GetPageCount(pdbFile));
+}
+
+void PrintModelStats(const LayoutModel& model)
+{
+	AllocationStats allocations = AllocationStats::Get();
+	fmt::println("Layout model: {} classes, {} fields, {} vtable entries, {} strings, {} KiB, {} KiB of names not copied",
+		model.GetClassCount(), model.GetFieldCount(), model.GetVirtualMethodCount(), model.GetStrings().GetCount(), model.GetMemoryUsage() / 1024,
+		model.GetStrings().GetBorrowedSize() / 1024);
 
-		i += static_cast<size_t>(leafName - reinterpret_cast<const char*>(fieldRecord));
-		i += strnlen(leafName, maximumSize - i - 1) + 1;
-		i = (i + (sizeof(uint32_t) - 1)) & (0 - sizeof(uint32_t));
+	if (AllocationStats::IsCounting())
+	{
+		fmt::println("Allocations: {} ({} KiB), peak memory {} MiB",
+			allocations.count, allocations.bytes / 1024, AllocationStats::GetPeakMemoryUsage() / (1024 * 1024));
+	}
+	else
+	{
+		fmt::println("Peak memory {} MiB", AllocationStats::GetPeakMemoryUsage() / (1024 * 1024));
 	}
+}
 
-	jClass["fields"] = std::move(jFields);
-	jClass["vtable"] = std::move(jVTable);
+void BenchmarkClassScan(const TypeTable& typeTable)
+{
+	constexpr int ITERATIONS = 100;
+	size_t slowCount = 0;
+	size_t fastCount = 0;
+
+	Stopwatch slowTimer;
+	for (int i = 0; i < ITERATIONS; i++)
+		slowCount += FindClassDefinitionsSlow(typeTable).size();
+	double slowMs = slowTimer.ElapsedMs() / ITERATIONS;
+
+	Stopwatch fastTimer;
+	for (int i = 0; i < ITERATIONS; i++)
+		fastCount += typeTable.FindClassDefinitions().size();
+	double fastMs = fastTimer.ElapsedMs() / ITERATIONS;
+
+	if (slowCount != fastCount || FindClassDefinitionsSlow(typeTable) != typeTable.FindClassDefinitions())
+		throw std::logic_error("Class scan results differ");
+
+	fmt::println("Class scan over {} records, {} classes:", typeTable.GetTypeRecords().GetLength(), fastCount / ITERATIONS);
+	fmt::println("  record pointers: {:.3f} ms", slowMs);
+	fmt::println("  kind index:      {:.3f} ms ({:.1f}x)", fastMs, fastMs > 0 ? slowMs / fastMs : 0.0);
 }
 
 
@@ -1601,9 +1829,26 @@ int main(int argc, char** argv)
     {
         desc.add_options()
             ("help", "produce help message")
-            ("class-list", po::value<std::string>()->required(), "list of classes to extract")
-            ("pdb", po::value<std::string>()->required(), "path to the PDB")
-            ("out", po::value<std::string>()->required(), "path to output JSON");
+            ("class-list", po::value<std::string>(), "list of classes to extract")
+            ("roots", po::value<std::string>(), "comma-separated classes to extract together with every class derived from them, e.g. CBaseEntity,CGameRules")
+            ("pdb", po::value<std::string>()->required(), "path to the PDB, - for stdin or archive.tar[.zst]:member")
+            ("out", po::value<std::string>(), "path to output JSON")
+            ("out-dir", po::value<std::string>(), "instead of --out, write one file per class and manifest.json to this directory")
+            ("format", po::value<std::string>()->default_value("json"), "output format: json, ndjson (one class per line) or bin (see OffsetsDb.h)")
+            ("emit-header", po::value<std::string>(), "also write a C++ header with constexpr offsets and typed accessors (#ifdef _WIN32 section)")
+            ("expand-nested", po::value<int>()->implicit_value(2), "also add the members of structure fields as \"field.member\" with absolute offsets, up to N levels deep")
+            ("flatten", "add a \"flattened\" list of all fields including inherited ones to every class (json and ndjson)")
+            ("layout-report", po::value<std::string>(), "also write a report of class sizes, padding holes and fields straddling 64-byte cache lines")
+            ("layout-report-format", po::value<std::string>()->default_value("text"), "format of --layout-report and --propose-layouts: text or json")
+            ("propose-layouts", po::value<std::string>(), "also write, for every class, an order of its own fields that minimizes padding and cache lines")
+            ("hot-fields", po::value<std::string>(), "file with one Class::field per line to place first in --propose-layouts, most accessed first")
+            ("type-rules", po::value<std::string>(), "file with amxxType rules (see AmxxTypeRules.h). The built-in rules are in test-data/amxx-type-rules.txt")
+            ("cache-dir", po::value<std::string>(), "reuse the outputs of an earlier run with the same PDB GUID and age, class list and options from this directory")
+            ("name-index-dir", po::value<std::string>(), "save the type indices of all classes of the PDB to this directory, keyed by GUID and age, and look up the class list in them on later runs")
+            ("tpi-only", "only validate and read the MSF directory, info stream and TPI stream. Vtable link names are not resolved")
+            ("stats", "print timing statistics")
+            ("io", po::value<std::string>()->default_value("mmap"), "how the PDB is read: mmap, populate, madvise, hugepages or read")
+            ("io-bench", po::value<int>()->implicit_value(5), "after exporting, compare I/O strategies on the PDB over N iterations");
 
         po::store(po::parse_command_line(argc, argv, desc), vm);
 
@@ -1613,6 +1858,15 @@ int main(int argc, char** argv)
         }
 
         po::notify(vm);
+
+        if (vm.count("out") == vm.count("out-dir"))
+            throw po::error("exactly one of --out and --out-dir is required");
+
+        if (!vm.count("class-list") && !vm.count("roots"))
+            throw po::error("--class-list or --roots is required");
+
+        if (vm.count("cache-dir") && vm.count("out-dir"))
+            throw po::error("--cache-dir can't be used with --out-dir");
     }
     catch (const std::exception& e)
     {
@@ -1623,10 +1877,61 @@ int main(int argc, char** argv)
 
     try
     {
+        const bool tpiOnly = vm.count("tpi-only") != 0;
+        const bool showStats = vm.count("stats") != 0;
+
+        MemoryMappedFile::IoStrategy ioStrategy;
+        if (!MemoryMappedFile::ParseIoStrategy(vm["io"].as<std::string>(), ioStrategy))
+            throw std::runtime_error(fmt::format("Unknown I/O strategy {}", vm["io"].as<std::string>()));
+
+        OutputFormat outputFormat;
+        if (!ParseOutputFormat(vm["format"].as<std::string>(), outputFormat))
+            throw std::runtime_error(fmt::format("Unknown output format {}", vm["format"].as<std::string>()));
+
+        LayoutReportFormat layoutReportFormat;
+        if (!ParseLayoutReportFormat(vm["layout-report-format"].as<std::string>(), layoutReportFormat))
+            throw std::runtime_error(fmt::format("Unknown layout report format {}", vm["layout-report-format"].as<std::string>()));
+
+        HotFieldList hotFields;
+        if (vm.count("hot-fields"))
+            hotFields = HotFieldList::LoadFile(vm["hot-fields"].as<std::string>());
+
+        // Every option that changes the output is part of the key
+        std::optional<ResultCache> cache;
+
+        if (vm.count("cache-dir"))
+        {
+            std::vector<ResultCache::Output> outputs = { { "out", vm["out"].as<std::string>() } };
+
+            for (const char* option : { "emit-header", "layout-report", "propose-layouts" })
+            {
+                if (vm.count(option))
+                    outputs.push_back({ option, vm[option].as<std::string>() });
+            }
+
+            cache.emplace(vm["cache-dir"].as<std::string>(), std::move(outputs));
+            cache->AddKey("exporter", "OffsetExporter.Pdb");
+            cache->AddKey("format", vm["format"].as<std::string>());
+            cache->AddKey("layout-report-format", vm["layout-report-format"].as<std::string>());
+            cache->AddKey("flatten", vm.count("flatten") ? "1" : "0");
+            cache->AddKey("expand-nested", vm.count("expand-nested") ? std::to_string(vm["expand-nested"].as<int>()) : "");
+            cache->AddKey("tpi-only", tpiOnly ? "1" : "0");
+
+            if (vm.count("roots"))
+                cache->AddKey("roots", vm["roots"].as<std::string>());
+
+            for (const char* option : { "class-list", "type-rules", "hot-fields" })
+            {
+                if (vm.count(option))
+                    cache->AddKeyFile(option, vm[option].as<std::string>());
+            }
+        }
+
         std::string pdbFilePath = vm["pdb"].as<std::string>();
         fmt::println("Opening PDB file {}", pdbFilePath);
+        Stopwatch loadTimer;
 
-        MemoryMappedFile::Handle pdbFile = MemoryMappedFile::Open(pdbFilePath.c_str());
+        MemoryMappedFile::Handle pdbFile = InputSource::Open(pdbFilePath, ioStrategy);
         if (!pdbFile.baseAddress)
             throw std::runtime_error("Cannot memory-map file");
 
@@ -1634,7 +1939,7 @@ int main(int argc, char** argv)
             throw std::runtime_error("Invalid file");
 
         const PDB::RawFile rawPdbFile = PDB::CreateRawFile(pdbFile.baseAddress);
-        if (IsError(PDB::HasValidDBIStream(rawPdbFile)))
+        if (!tpiOnly && IsError(PDB::HasValidDBIStream(rawPdbFile)))
             throw std::runtime_error("Invalid DBI stream");
 
         const PDB::InfoStream infoStream(rawPdbFile);
@@ -1647,70 +1952,221 @@ int main(int argc, char** argv)
             h->guid.Data1, h->guid.Data2, h->guid.Data3,
             h->guid.Data4[0], h->guid.Data4[1], h->guid.Data4[2], h->guid.Data4[3], h->guid.Data4[4], h->guid.Data4[5], h->guid.Data4[6], h->guid.Data4[7]);
 
-        const PDB::DBIStream dbiStream = PDB::CreateDBIStream(rawPdbFile);
-        if (!HasValidDBIStreams(rawPdbFile, dbiStream))
-            throw std::runtime_error("Invalid DBI stream");
+        // Same as the key of the PDB in a symbol store
+        std::string binaryId = fmt::format("{:08X}{:04X}{:04X}", h->guid.Data1, h->guid.Data2, h->guid.Data3);
+
+        for (uint8_t i : h->guid.Data4)
+            fmt::format_to(std::back_inserter(binaryId), "{:02X}", i);
+
+        fmt::format_to(std::back_inserter(binaryId), "{:X}", h->age);
+
+        if (cache)
+        {
+            cache->AddKeyBinary(LayoutModel::BinaryIdKind::PdbGuidAge, binaryId, pdbFile.baseAddress, pdbFile.len);
+
+            if (cache->Restore())
+            {
+                fmt::println("Restored outputs from cache entry {}", cache->GetEntryName());
+                return 0;
+            }
+        }
+
+        // The DBI stream is only needed for symbol names of virtual methods
+        std::optional<SymbolIndex> symbols;
+
+        if (!tpiOnly)
+        {
+            const PDB::DBIStream dbiStream = PDB::CreateDBIStream(rawPdbFile);
+            if (!HasValidDBIStreams(rawPdbFile, dbiStream))
+                throw std::runtime_error("Invalid DBI stream");
+
+            symbols.emplace(rawPdbFile, dbiStream);
+            fmt::println("Indexed {} public symbols and {} procedures", symbols->GetPublicCount(), symbols->GetProcedureCount());
+        }
 
         const PDB::TPIStream tpiStream = PDB::CreateTPIStream(rawPdbFile);
         if (PDB::HasValidTPIStream(rawPdbFile) != PDB::ErrorCode::Success)
             throw std::runtime_error("Invalid TPI stream");
 
+        AmxxTypeRules typeRules;
+
+        if (vm.count("type-rules"))
+        {
+            typeRules = AmxxTypeRules::LoadFile(vm["type-rules"].as<std::string>());
+            fmt::println("Loaded {} type rules", typeRules.GetRuleCount());
+        }
+
         // Read class list
-        std::string classListPath = vm["class-list"].as<std::string>();
-        fmt::println("Opening class list file {}", classListPath);
-        std::ifstream classListFile(classListPath);
-        std::set<std::string> classList;
-        std::string line;
+        ClassList classList;
 
-        while (std::getline(classListFile, line))
+        if (vm.count("class-list"))
         {
-            fmt::println("- {}", line);
-            classList.insert(line);
+            std::string classListPath = vm["class-list"].as<std::string>();
+            fmt::println("Opening class list file {}", classListPath);
+            classList = ClassList::LoadFile(classListPath);
+            fmt::println("Loaded {} classes", classList.GetCount());
         }
 
-        // Iterate over all types
+        // Iterate over all class definitions
         TypeTable typeTable(tpiStream);
-		boost::json::object jRoot;
-		boost::json::object jClasses;
+		// Names point into the TPI and symbol record streams, which outlive the model
+		LayoutModel model;
+		model.SetHasRva(symbols.has_value());
+		model.SetBinaryId(LayoutModel::BinaryIdKind::PdbGuidAge, binaryId);
+		model.SetBorrowNames(true);
+
+		// Classes are written as soon as they are extracted
+		std::optional<OutputFile> outFile;
+		std::unique_ptr<LayoutWriter> writer;
+
+		if (vm.count("out-dir"))
+		{
+			writer = LayoutWriter::CreateSharded(outputFormat, vm["out-dir"].as<std::string>(), model.GetBinaryIdKind(), model.GetBinaryId());
+		}
+		else
+		{
+			outFile.emplace(vm["out"].as<std::string>(), GetOutputOpenMode(outputFormat));
+			writer = LayoutWriter::Create(outputFormat, outFile->GetStream(), model.GetBinaryIdKind(), model.GetBinaryId());
+		}
+
+        if (showStats)
+            PrintPageStats(pdbFile, tpiOnly ? "Loaded (TPI only)" : "Loaded", loadTimer);
 
-        for (const auto& record : typeTable.GetTypeRecords())
+        FieldListIndex fieldLists(typeTable);
+        std::vector<uint32_t> classTypeIndices;
+
+        if (vm.count("roots"))
+        {
+            classTypeIndices = DiscoverClasses(typeTable, fieldLists, typeTable.FindClassDefinitions(), vm["roots"].as<std::string>(), classList);
+
+            if (showStats)
+                PrintPageStats(pdbFile, "Discovered classes", loadTimer);
+        }
+        else if (vm.count("name-index-dir"))
         {
-            if (record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_STRUCTURE ||
-				record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_CLASS ||
-				record->header.kind == PDB::CodeView::TPI::TypeRecordKind::LF_CLASS2)
+            std::filesystem::path nameIndexPath = NameIndex::GetPath(vm["name-index-dir"].as<std::string>(), LayoutModel::BinaryIdKind::PdbGuidAge, binaryId);
+            NameIndex::Reader nameIndex;
+
+            if (nameIndex.Open(nameIndexPath))
             {
-                if (record->data.LF_CLASS.property.fwdref)
-                    continue;
+                fmt::println("Loaded name index {} with {} classes", nameIndexPath.string(), nameIndex.GetCount());
+                classTypeIndices = FindClasses(nameIndex, classList);
+            }
+            else
+            {
+                classTypeIndices = typeTable.FindClassDefinitions();
+                BuildNameIndex(typeTable, classTypeIndices).Save(nameIndexPath);
+            }
 
-                auto typeRecord = typeTable.GetTypeRecord(record->data.LF_CLASS.field);
-                if (!typeRecord)
-                    continue;
+            if (showStats)
+                PrintPageStats(pdbFile, "Name index", loadTimer);
+        }
+        else
+        {
+            classTypeIndices = typeTable.FindClassDefinitions();
+        }
 
-                auto leafName = GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind);
-				// fmt::println("{}", leafName);
+        const bool flatten = vm.count("flatten") != 0;
+        std::optional<NestedLayouts> nestedLayouts;
 
-                if (!classList.contains(leafName))
-                    continue;
+        if (vm.count("expand-nested"))
+            nestedLayouts.emplace(vm["expand-nested"].as<int>());
 
-				boost::json::object jClass;
-				jClass["baseClass"] = nullptr;
+        classTypeIndices = OrderBasesFirst(typeTable, fieldLists, classTypeIndices, classList);
 
-                printf("struct %s\n{\n", leafName);
+        for (uint32_t classTypeIndex : classTypeIndices)
+        {
+            auto record = typeTable.GetTypeRecord(classTypeIndex);
+            if (!typeTable.GetTypeRecord(record->data.LF_CLASS.field))
+                continue;
 
-                DisplayFields(typeTable, typeRecord, jClass);
+            auto leafName = GetLeafName(record->data.LF_CLASS.data, record->data.LF_CLASS.lfEasy.kind);
+			// fmt::println("{}", leafName);
 
-                printf("}\n");
+            if (!classList.Contains(leafName))
+                continue;
 
-				jClasses[leafName] = std::move(jClass);
+            // The linker merges identical type records, so a name that is defined twice has two different
+            // layouts (local classes, ODR violations). Outputs are keyed by name, and like the DWARF exporter,
+            // class discovery and the name index, the first definition is used.
+            if (model.FindClass(leafName) != UINT32_MAX)
+            {
+                fmt::println("{} has more than one definition, using the first one", leafName);
+                continue;
             }
+
+			uint32_t cls = model.BeginClass(leafName);
+			model.SetClassSize(ReadSizeLeaf(record->data.LF_CLASS.data));
+
+            printf("struct %s\n{\n", leafName);
+
+            DisplayFields(typeTable, typeRules, fieldLists, symbols ? &*symbols : nullptr, leafName, record->data.LF_CLASS.field, model,
+                nestedLayouts ? &*nestedLayouts : nullptr);
+
+            printf("}\n");
+
+            model.ResolveVTable(cls);
+
+            if (flatten)
+                model.Flatten(cls);
+
+            writer->WriteClass(model, cls);
+        }
+
+        writer->Finish();
+
+        if (outFile)
+            outFile->Commit();
+
+        if (vm.count("emit-header"))
+        {
+            std::string headerPath = vm["emit-header"].as<std::string>();
+            fmt::println("Writing header {}", headerPath);
+            std::ofstream headerFile(headerPath);
+            WriteLayoutHeader(model, HeaderPlatform::Windows, "OffsetExporter.Pdb", headerFile);
         }
 
-		jRoot["classes"] = std::move(jClasses);
+        if (vm.count("layout-report"))
+        {
+            std::string reportPath = vm["layout-report"].as<std::string>();
+            fmt::println("Writing layout report {}", reportPath);
+            std::ofstream reportFile(reportPath);
+            WriteLayoutReport(model, layoutReportFormat, reportFile);
+        }
 
-		// Save JSON
-		std::string outPath = vm["out"].as<std::string>();
-		std::ofstream outFile(outPath);
-		outFile << jRoot << "\n";
+        if (vm.count("propose-layouts"))
+        {
+            std::string proposalsPath = vm["propose-layouts"].as<std::string>();
+            fmt::println("Writing layout proposals {}", proposalsPath);
+            std::ofstream proposalsFile(proposalsPath);
+            WriteLayoutProposals(model, hotFields, layoutReportFormat, proposalsFile);
+        }
+
+        if (cache)
+        {
+            // The other outputs are closed at the end of their blocks
+            cache->Store();
+        }
+
+        if (showStats)
+        {
+            PrintPageStats(pdbFile, "Extracted", loadTimer);
+            PrintModelStats(model);
+
+            if (nestedLayouts)
+                fmt::println("Nested layouts: {} types decoded", nestedLayouts->GetTypeCount());
+
+            BenchmarkClassScan(typeTable);
+            RunDeclaratorBenchmark();
+        }
+
+        if (vm.count("io-bench"))
+        {
+            if (InputSource::IsStreamed(pdbFilePath))
+                fmt::println("I/O benchmark needs a PDB on disk");
+            else
+                RunIoBenchmark(pdbFilePath.c_str(), vm["io-bench"].as<int>());
+        }
     }
     catch (const std::exception& e)
     {
@@ -1,6 +1,9 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <optional>
+#include <set>
+#include <string>
 #include <fmt/format.h>
 #include <raw_pdb/PDB.h>
 #include <raw_pdb/PDB_RawFile.h>
@@ -0,0 +1,97 @@
+#include <stdexcept>
+#include "AmxxTypeRules.h"
+#include "Test.h"
+
+using Kind = AmxxTypeRules::Kind;
+
+TEST(AmxxTypeRulesDefaultRules)
+{
+    AmxxTypeRules rules;
+
+    CHECK(rules.GetRuleCount() == 13);
+    CHECK(rules.Match(Kind::Type, "Vector") == "vector");
+    CHECK(rules.Match(Kind::Pointee, "CBasePlayer") == "classptr");
+    CHECK(rules.Match(Kind::PointeeTypedef, "edict_t") == "edict");
+    CHECK(rules.MatchField("m_iszModel", "integer") == "stringint");
+}
+
+TEST(AmxxTypeRulesExactBeatsPrefix)
+{
+    AmxxTypeRules rules = AmxxTypeRules::Parse(
+        "pointee  CBase*       classptr\n"
+        "pointee  CBaseEntity  entity\n", "test");
+
+    CHECK(rules.Match(Kind::Pointee, "CBaseEntity") == "entity");
+    CHECK(rules.Match(Kind::Pointee, "CBaseEntityX") == "classptr");
+    CHECK(rules.Match(Kind::Pointee, "CBase") == "classptr");
+    CHECK(rules.Match(Kind::Pointee, "CBas").empty());
+}
+
+TEST(AmxxTypeRulesLongestPrefixWins)
+{
+    // Order in the file doesn't matter
+    AmxxTypeRules rules = AmxxTypeRules::Parse(
+        "pointee  CBasePlayer*  player\n"
+        "pointee  C*            classptr\n"
+        "pointee  CBase*        base\n", "test");
+
+    CHECK(rules.Match(Kind::Pointee, "CBasePlayerItem") == "player");
+    CHECK(rules.Match(Kind::Pointee, "CBaseMonster") == "base");
+    CHECK(rules.Match(Kind::Pointee, "CGrenade") == "classptr");
+    CHECK(rules.Match(Kind::Pointee, "Vector").empty());
+}
+
+TEST(AmxxTypeRulesKindsAreSeparate)
+{
+    AmxxTypeRules rules = AmxxTypeRules::Parse(
+        "typedef          string_t   stringint\n"
+        "type             Vector     vector\n"
+        "pointee-typedef  entvars_t  entvars\n", "test");
+
+    CHECK(rules.Match(Kind::Typedef, "string_t") == "stringint");
+    CHECK(rules.Match(Kind::Type, "string_t").empty());
+    CHECK(rules.Match(Kind::Typedef, "Vector").empty());
+    CHECK(rules.Match(Kind::PointeeTypedef, "entvars_t") == "entvars");
+    CHECK(rules.Match(Kind::Pointee, "entvars_t").empty());
+}
+
+TEST(AmxxTypeRulesFieldPrefix)
+{
+    AmxxTypeRules rules = AmxxTypeRules::Parse(
+        "field  m_isz*       integer  stringint\n"
+        "field  m_iszModel   float    number\n"
+        "field  m_sMaster    integer  stringint\n", "test");
+
+    CHECK(rules.MatchField("m_iszTarget", "integer") == "stringint");
+    CHECK(rules.MatchField("m_isz", "integer") == "stringint");
+    CHECK(rules.MatchField("m_iszTarget", "float").empty());
+    CHECK(rules.MatchField("m_iTarget", "integer").empty());
+
+    // The exact rule wins even though its type doesn't match
+    CHECK(rules.MatchField("m_iszModel", "integer").empty());
+    CHECK(rules.MatchField("m_iszModel", "float") == "number");
+
+    CHECK(rules.MatchField("m_sMaster", "integer") == "stringint");
+    CHECK(rules.MatchField("m_sMasterName", "integer").empty());
+}
+
+TEST(AmxxTypeRulesParseErrors)
+{
+    auto getError = [](std::string_view text)
+    {
+        try
+        {
+            AmxxTypeRules::Parse(text, "rules.txt");
+        }
+        catch (const std::runtime_error& e)
+        {
+            return std::string(e.what());
+        }
+
+        return std::string();
+    };
+
+    CHECK(getError("# comment\n\nstruct Vector vector\n") == "rules.txt:3: unknown rule kind 'struct'");
+    CHECK(getError("field m_isz* stringint\n") == "rules.txt:1: 'field' expects 3 arguments");
+    CHECK(getError("pointee * classptr\n") == "rules.txt:1: empty prefix");
+}
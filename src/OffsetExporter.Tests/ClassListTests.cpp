@@ -0,0 +1,80 @@
+#include <string>
+#include <vector>
+#include "ClassList.h"
+#include "Test.h"
+
+namespace
+{
+
+ClassList BuildList(const std::vector<std::string>& names)
+{
+    ClassList classList;
+    classList.Build(std::vector<std::string_view>(names.begin(), names.end()));
+    return classList;
+}
+
+} // namespace
+
+TEST(ClassListFindsEveryName)
+{
+    std::vector<std::string> names = { "CBaseEntity", "CBasePlayer", "CBasePlayerItem", "CWorld", "C" };
+
+    for (int i = 0; i < 2000; i++)
+        names.push_back(fmt::format("CGeneratedEntity{}", i));
+
+    ClassList classList = BuildList(names);
+
+    CHECK(classList.GetCount() == names.size());
+
+    for (const std::string& name : names)
+        CHECK(classList.Contains(name));
+}
+
+// Each of these passes some of the prefilters and has to be rejected by the slot
+TEST(ClassListRejectsNearMisses)
+{
+    std::vector<std::string> names = { "CBaseEntity", "CBasePlayer", "CWorld", std::string(300, 'C') };
+
+    for (int i = 0; i < 100; i++)
+        names.push_back(fmt::format("CGeneratedEntity{}", i));
+
+    ClassList classList = BuildList(names);
+
+    CHECK(!classList.Contains("CBaseEntitz"));       // same length and first two bytes
+    CHECK(!classList.Contains("CBasePlayeR"));
+    CHECK(!classList.Contains("CBaseEntitys"));
+    CHECK(!classList.Contains("CBase"));             // prefix of a listed name
+    CHECK(!classList.Contains("CWorl"));
+    CHECK(!classList.Contains("CGeneratedEntity"));
+    CHECK(!classList.Contains("CGeneratedEntity100"));
+    CHECK(!classList.Contains("CGeneratedEntity1000"));
+    CHECK(!classList.Contains("cBaseEntity"));
+    CHECK(!classList.Contains(std::string(301, 'C'))); // lengths over 255 share a bit
+    CHECK(!classList.Contains(std::string(299, 'C') + 'D'));
+    CHECK(!classList.Contains(""));
+}
+
+TEST(ClassListEmpty)
+{
+    ClassList classList = BuildList({});
+
+    CHECK(classList.GetCount() == 0);
+    CHECK(!classList.Contains("CBaseEntity"));
+    CHECK(!classList.Contains(""));
+
+    // Empty names are not added
+    classList = BuildList({ "" });
+    CHECK(classList.GetCount() == 0);
+}
+
+TEST(ClassListSingleName)
+{
+    ClassList classList = BuildList({ "CBaseEntity", "CBaseEntity" });
+
+    CHECK(classList.GetCount() == 1);
+    CHECK(classList.GetName(0) == "CBaseEntity");
+    CHECK(classList.Contains("CBaseEntity"));
+    CHECK(!classList.Contains("CBaseEntitz"));
+    CHECK(!classList.Contains("CBase"));
+    CHECK(!classList.Contains("C"));
+}
@@ -0,0 +1,338 @@
+#include <string>
+#include <vector>
+#include "Declarator.h"
+#include "Test.h"
+
+// The exporters' AppendTypeDeclarator need a PDB or libdwarf, so these tests replay the steps each
+// one takes per type level and compare them to the per-level fmt::format calls they replaced.
+// Keep both sides in sync with OffsetExporter.Pdb/main.cpp and OffsetExporter.Dwarf/main.cpp.
+
+namespace
+{
+
+enum class PdbKind
+{
+    SimpleType, //!< type index below the first type, or a class
+    Modifier,
+    Pointer,
+    Array,
+    Union,
+    MemberFunction,
+};
+
+//! One level of a PDB type, outermost first.
+struct PdbLevel
+{
+    PdbKind kind;
+    std::string_view name = {}; //!< simple type, class or union name, member function return type
+    bool isConst = false;
+    bool isVolatile = false;
+    bool isUnaligned = false;
+    uint64_t count = 0; //!< array elements, 0 if unknown
+    std::vector<std::string_view> args = {}; //!< rendered member function argument types
+};
+
+std::string PdbOld(std::string name, const std::vector<PdbLevel>& levels, size_t i = 0)
+{
+    const PdbLevel& level = levels[i];
+
+    switch (level.kind)
+    {
+    case PdbKind::SimpleType:
+        return !name.empty() ? fmt::format("{} {}", level.name, name) : std::string(level.name);
+    case PdbKind::Modifier:
+    {
+        std::string modifiers;
+
+        if (level.isConst)
+            modifiers += "const ";
+        if (level.isVolatile)
+            modifiers += "volatile";
+        if (level.isUnaligned)
+            modifiers += "unaligned";
+
+        return PdbOld(modifiers + name, levels, i + 1);
+    }
+    case PdbKind::Pointer:
+    {
+        std::string pointerMods;
+
+        if (level.isConst)
+            pointerMods += "const ";
+        if (level.isVolatile)
+            pointerMods += "volatile ";
+        if (level.isUnaligned)
+            pointerMods += "unaligned ";
+
+        return PdbOld(fmt::format("*{}{}", pointerMods, name), levels, i + 1);
+    }
+    case PdbKind::Array:
+        return level.count != 0 ? PdbOld(fmt::format("{}[{}]", name, level.count), levels, i + 1) : PdbOld(fmt::format("{}[]", name), levels, i + 1);
+    case PdbKind::Union:
+        return fmt::format("{} {}", level.name, name);
+    case PdbKind::MemberFunction:
+    {
+        std::string result = fmt::format("{} ({})(", level.name, name);
+
+        for (size_t arg = 0; arg < level.args.size(); arg++)
+        {
+            if (arg != 0)
+                result += ", ";
+
+            result += level.args[arg];
+        }
+
+        result += ")";
+        return result;
+    }
+    }
+
+    return "unknown_type";
+}
+
+void PdbAppend(Declarator& decl, const std::vector<PdbLevel>& levels, size_t i = 0)
+{
+    const PdbLevel& level = levels[i];
+
+    switch (level.kind)
+    {
+    case PdbKind::SimpleType:
+        if (!decl.IsEmpty())
+            decl.Prepend(" ");
+
+        decl.Prepend(level.name);
+        return;
+    case PdbKind::Modifier:
+        if (level.isUnaligned)
+            decl.Prepend("unaligned");
+        if (level.isVolatile)
+            decl.Prepend("volatile");
+        if (level.isConst)
+            decl.Prepend("const ");
+
+        return PdbAppend(decl, levels, i + 1);
+    case PdbKind::Pointer:
+        if (level.isUnaligned)
+            decl.Prepend("unaligned ");
+        if (level.isVolatile)
+            decl.Prepend("volatile ");
+        if (level.isConst)
+            decl.Prepend("const ");
+
+        decl.Prepend("*");
+        return PdbAppend(decl, levels, i + 1);
+    case PdbKind::Array:
+        if (level.count != 0)
+            decl.AppendFormat("[{}]", level.count);
+        else
+            decl.Append("[]");
+
+        return PdbAppend(decl, levels, i + 1);
+    case PdbKind::Union:
+        decl.Prepend(" ");
+        decl.Prepend(level.name);
+        return;
+    case PdbKind::MemberFunction:
+        decl.Prepend(" (");
+        decl.Prepend(level.name);
+        decl.Append(")(");
+
+        for (size_t arg = 0; arg < level.args.size(); arg++)
+        {
+            if (arg != 0)
+                decl.Append(", ");
+
+            decl.Append(level.args[arg]);
+        }
+
+        decl.Append(")");
+        return;
+    }
+}
+
+std::string PdbNew(std::string_view name, const std::vector<PdbLevel>& levels)
+{
+    Declarator decl(name);
+    PdbAppend(decl, levels);
+
+    fmt::memory_buffer out;
+    decl.WriteTo(out);
+    return fmt::to_string(out);
+}
+
+enum class DwarfKind
+{
+    Named,
+    Const,
+    Pointer,
+    Reference,
+    Volatile,
+    Array,
+    Subroutine,
+    PtrToMember,
+};
+
+//! One level of a DWARF type, outermost first.
+struct DwarfLevel
+{
+    DwarfKind kind;
+    std::string_view name = {};
+    int64_t upperBound = -1;
+};
+
+std::string DwarfOld(std::string name, const std::vector<DwarfLevel>& levels, size_t i = 0)
+{
+    const DwarfLevel& level = levels[i];
+
+    switch (level.kind)
+    {
+    case DwarfKind::Named: return fmt::format("{} {}", level.name, name);
+    case DwarfKind::Const: return DwarfOld(fmt::format("const {}", name), levels, i + 1);
+    case DwarfKind::Pointer: return DwarfOld(fmt::format("*{}", name), levels, i + 1);
+    case DwarfKind::Reference: return DwarfOld(fmt::format("&{}", name), levels, i + 1);
+    case DwarfKind::Volatile: return DwarfOld(fmt::format("volatile {}", name), levels, i + 1);
+    case DwarfKind::Array: return DwarfOld(fmt::format("{}[{}]", name, level.upperBound), levels, i + 1);
+    case DwarfKind::Subroutine: return fmt::format("__subroutine {}", name);
+    case DwarfKind::PtrToMember: return fmt::format("__member_func *{}", name);
+    }
+
+    return {};
+}
+
+void DwarfAppend(Declarator& decl, const std::vector<DwarfLevel>& levels, size_t i = 0)
+{
+    const DwarfLevel& level = levels[i];
+
+    switch (level.kind)
+    {
+    case DwarfKind::Named:
+        decl.Prepend(" ");
+        decl.Prepend(level.name);
+        return;
+    case DwarfKind::Const:
+        decl.Prepend("const ");
+        return DwarfAppend(decl, levels, i + 1);
+    case DwarfKind::Pointer:
+        decl.Prepend("*");
+        return DwarfAppend(decl, levels, i + 1);
+    case DwarfKind::Reference:
+        decl.Prepend("&");
+        return DwarfAppend(decl, levels, i + 1);
+    case DwarfKind::Volatile:
+        decl.Prepend("volatile ");
+        return DwarfAppend(decl, levels, i + 1);
+    case DwarfKind::Array:
+        decl.AppendFormat("[{}]", level.upperBound);
+        return DwarfAppend(decl, levels, i + 1);
+    case DwarfKind::Subroutine:
+        decl.Prepend("__subroutine ");
+        return;
+    case DwarfKind::PtrToMember:
+        decl.Prepend("__member_func *");
+        return;
+    }
+}
+
+std::string DwarfNew(std::string_view name, const std::vector<DwarfLevel>& levels)
+{
+    Declarator decl(name);
+    DwarfAppend(decl, levels);
+
+    fmt::memory_buffer out;
+    decl.WriteTo(out);
+    return fmt::to_string(out);
+}
+
+} // namespace
+
+TEST(DeclaratorPdbFunctionPointer)
+{
+    std::vector<PdbLevel> levels = {
+        { PdbKind::Array, {}, false, false, false, 4 },
+        { PdbKind::Pointer },
+        { PdbKind::MemberFunction, "void", false, false, false, 0, { "CBaseEntity *", "int" } },
+    };
+
+    CHECK(PdbNew("m_pfnThink", levels) == PdbOld("m_pfnThink", levels));
+    CHECK(PdbNew("m_pfnThink", levels) == "void (*m_pfnThink[4])(CBaseEntity *, int)");
+}
+
+TEST(DeclaratorPdbArrayOfPointers)
+{
+    std::vector<PdbLevel> levels = {
+        { PdbKind::Array, {}, false, false, false, 32 },
+        { PdbKind::Array, {}, false, false, false, 2 },
+        { PdbKind::Pointer },
+        { PdbKind::Modifier, {}, true },
+        { PdbKind::SimpleType, "char" },
+    };
+
+    CHECK(PdbNew("m_szNames", levels) == PdbOld("m_szNames", levels));
+    CHECK(PdbNew("m_szNames", levels) == "char const *m_szNames[32][2]");
+
+    std::vector<PdbLevel> unknownSize = { { PdbKind::Array }, { PdbKind::Pointer }, { PdbKind::Union, "Vector" } };
+
+    CHECK(PdbNew("m_pVecs", unknownSize) == PdbOld("m_pVecs", unknownSize));
+    CHECK(PdbNew("m_pVecs", unknownSize) == "Vector *m_pVecs[]");
+}
+
+TEST(DeclaratorPdbModifiersOnPointers)
+{
+    std::vector<PdbLevel> levels = {
+        { PdbKind::Pointer, {}, true, true, true },
+        { PdbKind::Modifier, {}, true, true, false },
+        { PdbKind::SimpleType, "CBaseEntity" },
+    };
+
+    CHECK(PdbNew("m_pEntity", levels) == PdbOld("m_pEntity", levels));
+    CHECK(PdbNew("m_pEntity", levels) == "CBaseEntity const volatile*const volatile unaligned m_pEntity");
+
+    // Return and argument types are rendered without a name
+    std::vector<PdbLevel> unnamed = { { PdbKind::Pointer, {}, true }, { PdbKind::SimpleType, "void" } };
+
+    CHECK(PdbNew({}, unnamed) == PdbOld({}, unnamed));
+    CHECK(PdbNew({}, unnamed) == "void *const ");
+}
+
+TEST(DeclaratorDwarfFunctionPointer)
+{
+    std::vector<DwarfLevel> levels = { { DwarfKind::Array, {}, 3 }, { DwarfKind::Pointer }, { DwarfKind::Subroutine } };
+
+    CHECK(DwarfNew("m_pfnTouch", levels) == DwarfOld("m_pfnTouch", levels));
+    CHECK(DwarfNew("m_pfnTouch", levels) == "__subroutine *m_pfnTouch[3]");
+
+    std::vector<DwarfLevel> member = { { DwarfKind::Const }, { DwarfKind::PtrToMember } };
+
+    CHECK(DwarfNew("m_pfnUse", member) == DwarfOld("m_pfnUse", member));
+    CHECK(DwarfNew("m_pfnUse", member) == "__member_func *const m_pfnUse");
+}
+
+TEST(DeclaratorDwarfArrayOfPointers)
+{
+    std::vector<DwarfLevel> levels = {
+        { DwarfKind::Array, {}, 31 },
+        { DwarfKind::Array, {}, 1 },
+        { DwarfKind::Pointer },
+        { DwarfKind::Const },
+        { DwarfKind::Named, "char" },
+    };
+
+    CHECK(DwarfNew("m_szNames", levels) == DwarfOld("m_szNames", levels));
+    CHECK(DwarfNew("m_szNames", levels) == "char const *m_szNames[31][1]");
+}
+
+TEST(DeclaratorDwarfModifiersOnPointers)
+{
+    std::vector<DwarfLevel> levels = {
+        { DwarfKind::Volatile },
+        { DwarfKind::Const },
+        { DwarfKind::Pointer },
+        { DwarfKind::Reference },
+        { DwarfKind::Pointer },
+        { DwarfKind::Volatile },
+        { DwarfKind::Named, "CBaseEntity" },
+    };
+
+    CHECK(DwarfNew("m_pEntity", levels) == DwarfOld("m_pEntity", levels));
+    CHECK(DwarfNew("m_pEntity", levels) == "CBaseEntity volatile *&*const volatile m_pEntity");
+}
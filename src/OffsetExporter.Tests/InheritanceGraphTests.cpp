@@ -0,0 +1,24 @@
+#include "InheritanceGraph.h"
+#include "Test.h"
+
+// --class-list together with --roots: listed classes outside the roots' subtrees are extracted too
+TEST(CollectDerivedIncludesListedClasses)
+{
+    InheritanceGraph graph;
+    graph.AddClass("CBaseEntity", 10);
+    graph.AddClass("CBaseMonster", 30);
+    graph.AddBase("CBaseMonster", "CBaseEntity");
+    graph.AddClass("CGameRules", 20);
+    graph.AddClass("CHalfLifeRules", 40);
+    graph.AddBase("CHalfLifeRules", "CGameRules");
+    graph.AddClass("CUnrelated", 50);
+
+    std::vector<InheritanceGraph::Class> classes = graph.CollectDerived({ "CGameRules" }, { "CBaseEntity", "CHalfLifeRules", "CUndefined" });
+    CHECK(classes.size() == 3);
+    CHECK(classes[0].name == "CBaseEntity" && classes[0].location == 10);
+    CHECK(classes[1].name == "CGameRules" && classes[1].location == 20);
+    CHECK(classes[2].name == "CHalfLifeRules" && classes[2].location == 40);
+
+    // Without a class list, only the subtree
+    CHECK(graph.CollectDerived({ "CBaseEntity" }).size() == 2);
+}
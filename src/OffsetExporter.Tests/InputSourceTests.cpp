@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <zstd.h>
+#include "InputSource.h"
+#include "Test.h"
+
+namespace
+{
+
+constexpr size_t BLOCK_SIZE = 512;
+
+//! ustar header. Sizes that don't fit in 11 octal digits or base256Size use GNU base-256.
+std::string TarHeader(std::string_view name, uint64_t size, char type, bool base256Size = false)
+{
+    std::string header(BLOCK_SIZE, '\0');
+    std::memcpy(&header[0], name.data(), std::min<size_t>(name.size(), 100));
+    std::memcpy(&header[100], "0000644", 7);
+    std::memcpy(&header[108], "0000000", 7);
+    std::memcpy(&header[116], "0000000", 7);
+
+    if (base256Size)
+    {
+        header[124] = static_cast<char>(0x80);
+
+        for (size_t i = 0; i < 8; i++)
+            header[135 - i] = static_cast<char>((size >> (i * 8)) & 0xFF);
+    }
+    else
+    {
+        std::string octal = fmt::format("{:011o}", size);
+        std::memcpy(&header[124], octal.data(), octal.size());
+    }
+
+    std::memcpy(&header[136], "00000000000", 11);
+    header[156] = type;
+    std::memcpy(&header[257], "ustar", 6);
+    std::memcpy(&header[263], "00", 2);
+
+    uint64_t checksum = 8 * ' ';
+
+    for (size_t i = 0; i < BLOCK_SIZE; i++)
+        checksum += static_cast<uint8_t>(header[i]);
+
+    std::string octal = fmt::format("{:06o}", checksum);
+    std::memcpy(&header[148], octal.data(), octal.size());
+    header[155] = ' ';
+    return header;
+}
+
+//! Header followed by the data padded to the block size.
+std::string TarEntry(std::string header, std::string_view data)
+{
+    header.append(data);
+    header.append((BLOCK_SIZE - data.size() % BLOCK_SIZE) % BLOCK_SIZE, '\0');
+    return header;
+}
+
+std::string TarEnd()
+{
+    return std::string(2 * BLOCK_SIZE, '\0');
+}
+
+//! "<length> <key>=<value>\n" where length counts the whole record.
+std::string PaxRecord(std::string_view key, std::string_view value)
+{
+    const size_t rest = key.size() + value.size() + 3;
+    size_t length = rest + 1;
+
+    while (length != rest + fmt::format("{}", length).size())
+        length++;
+
+    return fmt::format("{} {}={}\n", length, key, value);
+}
+
+std::string Compress(const std::string& data)
+{
+    std::string compressed(ZSTD_compressBound(data.size()), '\0');
+    size_t size = ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), 3);
+    CHECK(!ZSTD_isError(size));
+    compressed.resize(size);
+    return compressed;
+}
+
+//! Writes the archive to a temporary file and reads the member from it.
+std::string Extract(const std::string& archive, std::string_view fileName, std::string_view member)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / fileName;
+
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(archive.data(), archive.size());
+    }
+
+    std::string content;
+
+    try
+    {
+        MemoryMappedFile::Handle handle = InputSource::Open(fmt::format("{}:{}", path.string(), member), MemoryMappedFile::IoStrategy::Read);
+        CHECK(handle.baseAddress);
+        content.assign(static_cast<const char*>(handle.baseAddress), handle.len);
+    }
+    catch (...)
+    {
+        std::filesystem::remove(path);
+        throw;
+    }
+
+    std::filesystem::remove(path);
+    return content;
+}
+
+} // namespace
+
+// The size in the ustar header is wrong on purpose, the pax size must win
+TEST(TarUsesPaxPathAndSize)
+{
+    std::string longName = "valve/dlls/" + std::string(120, 'x') + "/hl.so";
+    std::string pax = PaxRecord("path", longName) + PaxRecord("size", "600");
+    std::string data(600, 'a');
+
+    std::string archive = TarEntry(TarHeader("PaxHeaders/hl.so", pax.size(), 'x'), pax)
+        + TarEntry(TarHeader("hl.so", 0, '0'), data)
+        + TarEnd();
+
+    CHECK(Extract(archive, "offset-exporter-pax-test.tar", longName) == data);
+}
+
+TEST(TarUsesGnuLongName)
+{
+    std::string longName = "valve/dlls/" + std::string(120, 'y') + "/hl.so";
+    std::string data = "long name";
+
+    std::string archive = TarEntry(TarHeader("other.so", 5, '0'), "other")
+        + TarEntry(TarHeader("././@LongLink", longName.size() + 1, 'L'), longName + '\0')
+        + TarEntry(TarHeader(longName.substr(0, 100), data.size(), '0'), data)
+        + TarEnd();
+
+    CHECK(Extract(archive, "offset-exporter-longname-test.tar", longName) == data);
+}
+
+TEST(TarParsesBase256Size)
+{
+    std::string data(1000, 'b');
+
+    std::string archive = TarEntry(TarHeader("hl.so", data.size(), '0', true), data) + TarEnd();
+
+    CHECK(Extract(archive, "offset-exporter-base256-test.tar", "hl.so") == data);
+}
+
+// Decompresses to many times the zstd output buffer, so each input chunk produces several buffers
+TEST(TarZstdDecompressesEverything)
+{
+    std::string data;
+
+    for (uint32_t i = 0; data.size() < (4 << 20); i++)
+        data += fmt::format("{:08x}", i / 64);
+
+    std::string archive = Compress(TarEntry(TarHeader("hl.so", data.size(), '0'), data) + TarEnd());
+
+    CHECK(Extract(archive, "offset-exporter-zstd-test.tar.zst", "hl.so") == data);
+}
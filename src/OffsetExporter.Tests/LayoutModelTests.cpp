@@ -0,0 +1,80 @@
+#include "LayoutModel.h"
+#include "Test.h"
+
+namespace
+{
+
+void AddMethod(LayoutModel& model, std::string_view name, int32_t index, uint64_t signature)
+{
+    LayoutModel::VirtualMethodDesc method;
+    method.name = name;
+    method.index = index;
+    method.signature = signature;
+    model.AddVirtualMethod(method);
+}
+
+void AddField(LayoutModel& model, std::string_view name, uint64_t offset, bool isNested)
+{
+    LayoutModel::FieldDesc field;
+    field.name = name;
+    field.offset = offset;
+    field.type = "entvars_t";
+
+    if (isNested)
+        model.AddNestedField(field);
+    else
+        model.AddField(field);
+}
+
+} // namespace
+
+// Extracted like the PDB exporter does: overrides have no slot of their own and look it up in the base
+TEST(DestructorOverridesBaseDestructorSlot)
+{
+    LayoutModel model;
+    uint32_t base = model.BeginClass("CBase");
+    AddMethod(model, "~CBase", 0, 1);
+    AddMethod(model, "Spawn", 1, 2);
+    model.ResolveVTable(base);
+
+    uint32_t derived = model.BeginClass("CDerived");
+    model.SetBaseClass("CBase");
+    int32_t destructorSlot = model.FindVirtualMethodSlot(base, "~CDerived", 3);
+    int32_t spawnSlot = model.FindVirtualMethodSlot(base, "Spawn", 2);
+    CHECK(destructorSlot == 0);
+    CHECK(spawnSlot == 1);
+    CHECK(model.FindVirtualMethodSlot(base, "Spawn", 4) == -1);
+
+    AddMethod(model, "~CDerived", destructorSlot, 3);
+    LayoutModel::Range slots = model.ResolveVTable(derived);
+    CHECK(slots.end - slots.begin == 2);
+
+    uint32_t destructor = model.GetSlotMethod(slots.begin);
+    CHECK(model.GetString(model.GetVirtualMethodName(destructor)) == "~CDerived");
+    CHECK(model.GetVirtualMethodClass(destructor) == derived);
+    CHECK(model.GetSlotIntroClass(slots.begin) == base);
+
+    uint32_t spawn = model.GetSlotMethod(slots.begin + 1);
+    CHECK(model.GetVirtualMethodClass(spawn) == base);
+}
+
+TEST(NestedFieldsAreNotPartOfTheLayout)
+{
+    LayoutModel model;
+    uint32_t plain = model.BeginClass("CPlain");
+    AddField(model, "pev", 4, false);
+
+    uint32_t expanded = model.BeginClass("CExpanded");
+    AddField(model, "pev", 4, false);
+    AddField(model, "pev.origin", 12, true);
+
+    CHECK(!model.IsNestedField(0));
+    CHECK(model.IsNestedField(2));
+
+    // Same hash as without --expand-nested
+    CHECK(model.GetLayoutHash(plain) == model.GetLayoutHash(expanded));
+
+    LayoutModel::Range flat = model.Flatten(expanded);
+    CHECK(flat.end - flat.begin == 1);
+    CHECK(model.GetFlattenedField(flat.begin) == 1);
+}
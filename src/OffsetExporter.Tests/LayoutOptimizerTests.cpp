@@ -0,0 +1,109 @@
+#include <sstream>
+#include "LayoutOptimizer.h"
+#include "Test.h"
+
+namespace
+{
+
+void AddField(LayoutModel& model, std::string_view name, uint64_t offset, uint64_t size, uint32_t alignment)
+{
+    LayoutModel::FieldDesc field;
+    field.name = name;
+    field.offset = offset;
+    field.size = size;
+    field.alignment = alignment;
+    model.AddField(field);
+}
+
+std::string Propose(const LayoutModel& model, const HotFieldList& hotFields = {})
+{
+    std::ostringstream out;
+    WriteLayoutProposals(model, hotFields, LayoutReportFormat::Json, out);
+    return out.str();
+}
+
+bool Contains(const std::string& text, std::string_view part)
+{
+    return text.find(part) != std::string::npos;
+}
+
+} // namespace
+
+TEST(LayoutOptimizerPacksByAlignment)
+{
+    LayoutModel model;
+    model.BeginClass("CPadded");
+    model.SetClassSize(16);
+    AddField(model, "a", 0, 1, 1);
+    AddField(model, "b", 4, 4, 4);
+    AddField(model, "c", 8, 1, 1);
+    AddField(model, "d", 12, 4, 4);
+
+    std::string json = Propose(model);
+
+    CHECK(Contains(json, "\"proposedSize\":12,"));
+    CHECK(Contains(json, "\"changed\":true"));
+    CHECK(Contains(json, "{\"name\":\"b\",\"offset\":0,"));
+    CHECK(Contains(json, "{\"name\":\"d\",\"offset\":4,"));
+    CHECK(Contains(json, "{\"name\":\"a\",\"offset\":8,"));
+    CHECK(Contains(json, "{\"name\":\"c\",\"offset\":9,"));
+}
+
+// A different order of the same size isn't proposed without hot fields
+TEST(LayoutOptimizerKeepsLayoutUnlessSmaller)
+{
+    LayoutModel model;
+    model.BeginClass("CTight");
+    model.SetClassSize(8);
+    AddField(model, "a", 0, 1, 1);
+    AddField(model, "b", 4, 4, 4);
+
+    std::string json = Propose(model);
+
+    CHECK(Contains(json, "\"proposedSize\":8,"));
+    CHECK(Contains(json, "\"changed\":false"));
+    CHECK(Contains(json, "{\"name\":\"a\",\"offset\":0,\"originalOffset\":0,"));
+    CHECK(Contains(json, "{\"name\":\"b\",\"offset\":4,\"originalOffset\":4,"));
+}
+
+TEST(LayoutOptimizerPutsHotFieldsFirst)
+{
+    LayoutModel model;
+    model.BeginClass("CHot");
+    model.SetClassSize(12);
+    AddField(model, "a", 0, 4, 4);
+    AddField(model, "b", 4, 4, 4);
+    AddField(model, "c", 8, 4, 4);
+
+    HotFieldList hotFields;
+    hotFields.Add("CHot", "c");
+    hotFields.Add("CHot", "b");
+
+    std::string json = Propose(model, hotFields);
+
+    CHECK(Contains(json, "\"proposedSize\":12,"));
+    CHECK(Contains(json, "\"changed\":true"));
+    CHECK(Contains(json, "{\"name\":\"c\",\"offset\":0,\"originalOffset\":8,\"size\":4,\"alignment\":4,\"hot\":true}"));
+    CHECK(Contains(json, "{\"name\":\"b\",\"offset\":4,\"originalOffset\":4,\"size\":4,\"alignment\":4,\"hot\":true}"));
+    CHECK(Contains(json, "{\"name\":\"a\",\"offset\":8,\"originalOffset\":0,\"size\":4,\"alignment\":4,\"hot\":false}"));
+}
+
+// x and y overlap like union members, so they move together
+TEST(LayoutOptimizerMovesOverlappingFieldsAsBlock)
+{
+    LayoutModel model;
+    model.BeginClass("CUnion");
+    model.SetClassSize(12);
+    AddField(model, "a", 0, 1, 1);
+    AddField(model, "x", 4, 4, 4);
+    AddField(model, "y", 4, 2, 2);
+    AddField(model, "b", 8, 1, 1);
+
+    std::string json = Propose(model);
+
+    CHECK(Contains(json, "\"proposedSize\":8,"));
+    CHECK(Contains(json, "{\"name\":\"x\",\"offset\":0,\"originalOffset\":4,\"size\":4,\"alignment\":4,"));
+    CHECK(Contains(json, "{\"name\":\"a\",\"offset\":4,"));
+    CHECK(Contains(json, "{\"name\":\"b\",\"offset\":5,"));
+    CHECK(!Contains(json, "\"name\":\"y\""));
+}
@@ -0,0 +1,27 @@
+#include <sstream>
+#include "LayoutReport.h"
+#include "Test.h"
+
+// CBaseEntity is not exported, so the space before m_flDelay is its fields, not a hole
+TEST(LayoutReportSkipsMissingBase)
+{
+    LayoutModel model;
+    model.BeginClass("CBaseDelay");
+    model.SetBaseClass("CBaseEntity");
+    model.SetClassSize(40);
+
+    LayoutModel::FieldDesc field;
+    field.name = "m_flDelay";
+    field.offset = 32;
+    field.size = 4;
+    model.AddField(field);
+
+    std::ostringstream report;
+    WriteLayoutReport(model, LayoutReportFormat::Json, report);
+    std::string json = report.str();
+
+    CHECK(json.find("\"missingBase\":\"CBaseEntity\"") != std::string::npos);
+    CHECK(json.find("\"holeBytes\":0,") != std::string::npos);
+    CHECK(json.find("\"holes\":[]") != std::string::npos);
+    CHECK(json.find("\"padding\":4,") != std::string::npos);
+}
@@ -0,0 +1,134 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include "NameIndex.h"
+#include "Test.h"
+
+namespace
+{
+
+//! Directory for the index files, removed with everything in it.
+struct TempDir
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / fmt::format("offset-exporter-index-test-{:08x}", std::random_device()());
+
+    TempDir() { std::filesystem::create_directories(path); }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+//! Writes a changed copy of the index and tries to open it.
+bool OpenModified(const std::filesystem::path& path, const std::function<void(std::string&, NameIndex::Header&)>& modify)
+{
+    std::string content = ReadFile(path);
+    NameIndex::Header header;
+    std::memcpy(&header, content.data(), sizeof(header));
+    modify(content, header);
+    std::memcpy(content.data(), &header, std::min(sizeof(header), content.size()));
+
+    std::filesystem::path modified = path;
+    modified += ".modified";
+
+    {
+        std::ofstream file(modified, std::ios::out | std::ios::binary);
+        file.write(content.data(), content.size());
+    }
+
+    NameIndex::Reader reader;
+    return reader.Open(modified);
+}
+
+} // namespace
+
+TEST(NameIndexRoundTrip)
+{
+    TempDir dir;
+    std::filesystem::path path = NameIndex::GetPath(dir.path, LayoutModel::BinaryIdKind::ElfBuildId, "0123abcd");
+
+    NameIndex::Builder builder;
+    builder.Add("CBasePlayer", 0x200, 0x10);
+    builder.Add("CBaseEntity", 0x100, 0x10);
+    builder.Add("CWorld", 0x300, 0x20);
+    builder.Save(path);
+
+    NameIndex::Reader reader;
+    CHECK(reader.Open(path));
+    CHECK(reader.GetCount() == 3);
+
+    const NameIndex::Entry* entry = reader.Find("CBaseEntity");
+    CHECK(entry && entry->location == 0x100 && entry->unit == 0x10);
+    entry = reader.Find("CWorld");
+    CHECK(entry && entry->location == 0x300 && entry->unit == 0x20);
+    entry = reader.Find("CBasePlayer");
+    CHECK(entry && entry->location == 0x200);
+
+    CHECK(!reader.Find("CBase"));
+    CHECK(!reader.Find("CBasePlayerItem"));
+    CHECK(!reader.Find(""));
+}
+
+// Later definitions of a name are usually forward declarations or duplicates from other units
+TEST(NameIndexKeepsFirstDefinition)
+{
+    TempDir dir;
+    std::filesystem::path path = dir.path / "first.idx";
+
+    NameIndex::Builder builder;
+    builder.Add("CBaseEntity", 0x100, 0x10);
+    builder.Add("CBaseEntity", 0x900, 0x90);
+    CHECK(builder.GetCount() == 1);
+    builder.Save(path);
+
+    NameIndex::Reader reader;
+    CHECK(reader.Open(path));
+
+    const NameIndex::Entry* entry = reader.Find("CBaseEntity");
+    CHECK(entry && entry->location == 0x100 && entry->unit == 0x10);
+}
+
+TEST(NameIndexRejectsCorruptFiles)
+{
+    TempDir dir;
+    std::filesystem::path path = dir.path / "corrupt.idx";
+
+    NameIndex::Builder builder;
+    builder.Add("CBaseEntity", 0x100, 0);
+    builder.Add("CBasePlayer", 0x200, 0);
+    builder.Save(path);
+
+    NameIndex::Reader reader;
+    CHECK(!reader.Open(dir.path / "missing.idx"));
+    CHECK(OpenModified(path, [](std::string&, NameIndex::Header&) {}));
+
+    CHECK(!OpenModified(path, [](std::string& content, NameIndex::Header&) { content.resize(sizeof(NameIndex::Header) - 1); }));
+    CHECK(!OpenModified(path, [](std::string& content, NameIndex::Header&) { content.resize(content.size() - 8); }));
+    CHECK(!OpenModified(path, [](std::string&, NameIndex::Header& header) { header.magic[0] = 'X'; }));
+    CHECK(!OpenModified(path, [](std::string&, NameIndex::Header& header) { header.version++; }));
+    CHECK(!OpenModified(path, [](std::string&, NameIndex::Header& header) { header.entryCount = 1000; }));
+    CHECK(!OpenModified(path, [](std::string&, NameIndex::Header& header) { header.entryTableOffset = 4; }));
+    CHECK(!OpenModified(path, [](std::string&, NameIndex::Header& header) { header.stringPoolSize = header.fileSize; }));
+
+    // A name that points past the string pool
+    CHECK(!OpenModified(path, [](std::string& content, NameIndex::Header& header)
+    {
+        NameIndex::Entry entry;
+        std::memcpy(&entry, content.data() + header.entryTableOffset, sizeof(entry));
+        entry.nameLength = header.stringPoolSize - entry.nameOffset + 1;
+        std::memcpy(content.data() + header.entryTableOffset, &entry, sizeof(entry));
+    }));
+}
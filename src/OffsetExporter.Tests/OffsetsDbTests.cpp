@@ -0,0 +1,105 @@
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include "OffsetsDb.h"
+#include "OffsetsDbWriter.h"
+#include "Test.h"
+
+namespace
+{
+
+void AddField(LayoutModel& model, std::string_view name, uint64_t offset, uint64_t arraySize)
+{
+    LayoutModel::FieldDesc field;
+    field.name = name;
+    field.offset = offset;
+    field.arraySize = arraySize;
+    field.type = "int";
+    field.amxxType = "integer";
+    field.signedness = LayoutModel::Signedness::Signed;
+    model.AddField(field);
+}
+
+//! Copies the database to 8-byte aligned memory, as it would be when mapped.
+std::vector<uint64_t> WriteDb(const LayoutModel& model, const std::vector<uint32_t>& classes, bool withBinaryId)
+{
+    std::ostringstream stream(std::ios::out | std::ios::binary);
+    WriteOffsetsDb(model, classes, withBinaryId, stream);
+    std::string content = std::move(stream).str();
+
+    std::vector<uint64_t> data((content.size() + 7) / 8);
+    std::memcpy(data.data(), content.data(), content.size());
+    return data;
+}
+
+} // namespace
+
+TEST(OffsetsDbRoundTrip)
+{
+    LayoutModel model;
+    model.SetHasRva(true);
+    model.SetBinaryId(LayoutModel::BinaryIdKind::PdbGuidAge, "0123456789ABCDEF0123456789ABCDEF1");
+
+    uint32_t base = model.BeginClass("CBaseEntity");
+    AddField(model, "m_iHealth", 8, LayoutModel::NO_ARRAY_SIZE);
+
+    LayoutModel::VirtualMethodDesc spawn;
+    spawn.name = "Spawn";
+    spawn.linkName = "?Spawn@CBaseEntity@@UAEXXZ";
+    spawn.rva = 0x1234;
+    spawn.index = 0;
+    model.AddVirtualMethod(spawn);
+
+    uint32_t derived = model.BeginClass("CBasePlayer");
+    model.SetBaseClass("CBaseEntity");
+    AddField(model, "m_rgAmmo", 16, 32);
+
+    std::vector<uint64_t> data = WriteDb(model, { base, derived }, true);
+    OffsetsDb::Reader db;
+    CHECK(db.Open(data.data(), data.size() * 8));
+    CHECK(db.HasRva());
+    CHECK(db.GetHeader().flags & OffsetsDb::FLAG_PDB_GUID_AGE);
+    CHECK(db.GetBinaryId() == "0123456789ABCDEF0123456789ABCDEF1");
+    CHECK(db.GetClasses().size() == 2);
+
+    const OffsetsDb::ClassEntry* player = db.FindClass("CBasePlayer");
+    CHECK(player != nullptr);
+    CHECK(db.GetBaseClass(*player) == db.FindClass("CBaseEntity"));
+    CHECK(db.GetFields(*player).size() == 1);
+    CHECK(db.FindClass("CBaseMonster") == nullptr);
+
+    const OffsetsDb::FieldEntry* ammo = db.FindField("CBasePlayer", "m_rgAmmo");
+    CHECK(ammo != nullptr);
+    CHECK(ammo->offset == 16 && ammo->arraySize == 32);
+    CHECK(db.GetString(ammo->amxxType) == "integer");
+    CHECK(db.FindField("CBasePlayer", "m_iHealth") == nullptr);
+
+    const OffsetsDb::FieldEntry* health = db.FindFieldInHierarchy("CBasePlayer", "m_iHealth");
+    CHECK(health != nullptr);
+    CHECK(health->offset == 8 && health->arraySize == OffsetsDb::NONE);
+
+    const OffsetsDb::VirtualMethodEntry* method = db.FindVirtualMethod("CBaseEntity", "Spawn");
+    CHECK(method != nullptr);
+    CHECK(method->rva == 0x1234 && method->index == 0);
+    CHECK(db.GetString(method->linkName) == "?Spawn@CBaseEntity@@UAEXXZ");
+
+    // Truncated files are rejected
+    OffsetsDb::Reader truncated;
+    CHECK(!truncated.Open(data.data(), data.size() * 8 - 8));
+}
+
+// Shards leave the binary out, so that they only change with the layout
+TEST(OffsetsDbWithoutBinaryId)
+{
+    LayoutModel model;
+    model.SetBinaryId(LayoutModel::BinaryIdKind::ElfBuildId, "abcdef");
+    uint32_t cls = model.BeginClass("CBaseEntity");
+    AddField(model, "m_iHealth", 8, LayoutModel::NO_ARRAY_SIZE);
+
+    std::vector<uint64_t> data = WriteDb(model, { cls }, false);
+    OffsetsDb::Reader db;
+    CHECK(db.Open(data.data(), data.size() * 8));
+    CHECK(!db.HasRva());
+    CHECK(db.GetHeader().flags == 0);
+    CHECK(db.GetBinaryId().empty());
+}
@@ -0,0 +1,98 @@
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include "ResultCache.h"
+#include "Test.h"
+
+namespace
+{
+
+//! Directory for the outputs and the cache, removed with everything in it.
+struct TempDir
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / fmt::format("offset-exporter-cache-test-{:08x}", std::random_device()());
+
+    TempDir() { std::filesystem::create_directories(path); }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+void WriteFile(const std::filesystem::path& path, std::string_view content)
+{
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    file.write(content.data(), content.size());
+}
+
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+ResultCache CreateCache(const TempDir& dir, std::string_view classList)
+{
+    ResultCache cache(dir.path / "cache", {
+        { "offsets.json", (dir.path / "offsets.json").string() },
+        { "layout.txt", (dir.path / "layout.txt").string() },
+    });
+
+    cache.AddKey("class-list", classList);
+    return cache;
+}
+
+} // namespace
+
+TEST(ResultCacheRoundTrip)
+{
+    TempDir dir;
+    WriteFile(dir.path / "offsets.json", "{\"classes\":[]}");
+    WriteFile(dir.path / "layout.txt", "CBaseEntity");
+
+    ResultCache cache = CreateCache(dir, "CBaseEntity");
+    CHECK(!cache.Restore());
+    cache.Store();
+
+    WriteFile(dir.path / "offsets.json", "stale");
+    std::filesystem::remove(dir.path / "layout.txt");
+
+    CHECK(CreateCache(dir, "CBaseEntity").Restore());
+    CHECK(ReadFile(dir.path / "offsets.json") == "{\"classes\":[]}");
+    CHECK(ReadFile(dir.path / "layout.txt") == "CBaseEntity");
+}
+
+TEST(ResultCacheKeyMismatchIsMiss)
+{
+    TempDir dir;
+    WriteFile(dir.path / "offsets.json", "{}");
+    WriteFile(dir.path / "layout.txt", "");
+
+    ResultCache cache = CreateCache(dir, "CBaseEntity");
+    cache.Store();
+
+    CHECK(!CreateCache(dir, "CBasePlayer").Restore());
+
+    // An entry whose key differs, as after a hash collision
+    WriteFile(dir.path / "cache" / cache.GetEntryName() / "key.txt", "class-list=CBasePlayer\n");
+    CHECK(!cache.Restore());
+}
+
+TEST(ResultCacheMissingOutputIsMiss)
+{
+    TempDir dir;
+    WriteFile(dir.path / "offsets.json", "{}");
+    WriteFile(dir.path / "layout.txt", "");
+
+    ResultCache cache = CreateCache(dir, "CBaseEntity");
+    cache.Store();
+    CHECK(cache.Restore());
+
+    std::filesystem::remove(dir.path / "cache" / cache.GetEntryName() / "layout.txt");
+    CHECK(!cache.Restore());
+}
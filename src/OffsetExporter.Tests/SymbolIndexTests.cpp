@@ -0,0 +1,65 @@
+#include "SymbolIndex.h"
+#include "Test.h"
+
+namespace
+{
+
+// int CBaseEntity::TakeDamage(entvars_t*, entvars_t*, float, int) and int CBaseEntity::TakeDamage(float),
+// as in the public and module symbol streams of a 32-bit PDB
+constexpr uint32_t TAKE_DAMAGE_TYPE = 0x1001;
+constexpr uint32_t TAKE_DAMAGE_FLOAT_TYPE = 0x1002;
+
+SymbolIndex MakeIndex()
+{
+	std::vector<SymbolIndex::Symbol> publics = {
+		{ "?TakeDamage@CBaseEntity@@UAEHPAUentvars_s@@0MH@Z", 0x1100 },
+		{ "?TakeDamage@CBaseEntity@@UAEHM@Z", 0x1200 },
+		{ "?Spawn@CBaseEntity@@UAEXXZ", 0x1300 },
+		{ "?Spawn@CBaseEntity@@QAEXH@Z", 0x1400 },
+		{ "??_GCBaseEntity@@UAEPAXI@Z", 0x1500 },
+		{ "??1CBaseEntity@@UAE@XZ", 0x1600 },
+	};
+
+	std::vector<SymbolIndex::Symbol> procedures = {
+		{ "CBaseEntity::TakeDamage", 0x1200, TAKE_DAMAGE_FLOAT_TYPE },
+		{ "CBaseEntity::TakeDamage", 0x1100, TAKE_DAMAGE_TYPE },
+		{ "CBaseEntity::Spawn", 0x1300, 0x1003 },
+	};
+
+	return SymbolIndex(std::move(publics), std::move(procedures));
+}
+
+} // namespace
+
+TEST(SymbolIndexResolvesOverloadedVirtual)
+{
+	SymbolIndex index = MakeIndex();
+
+	const SymbolIndex::Symbol* symbol = index.FindVirtualMethod("CBaseEntity", "TakeDamage", TAKE_DAMAGE_FLOAT_TYPE);
+	CHECK(symbol != nullptr);
+	CHECK(symbol->rva == 0x1200);
+	CHECK(symbol->name == "?TakeDamage@CBaseEntity@@UAEHM@Z");
+
+	symbol = index.FindVirtualMethod("CBaseEntity", "TakeDamage", TAKE_DAMAGE_TYPE);
+	CHECK(symbol != nullptr);
+	CHECK(symbol->rva == 0x1100);
+
+	// Unknown overload
+	CHECK(index.FindVirtualMethod("CBaseEntity", "TakeDamage", 0x2000) == nullptr);
+}
+
+TEST(SymbolIndexFindsSingleVirtualAndDestructor)
+{
+	SymbolIndex index = MakeIndex();
+
+	// The non-virtual overload is not a candidate, so no procedure is needed
+	const SymbolIndex::Symbol* symbol = index.FindVirtualMethod("CBaseEntity", "Spawn", 0);
+	CHECK(symbol != nullptr);
+	CHECK(symbol->rva == 0x1300);
+
+	symbol = index.FindVirtualMethod("CBaseEntity", "~CBaseEntity", 0);
+	CHECK(symbol != nullptr);
+	CHECK(symbol->rva == 0x1500);
+
+	CHECK(index.FindVirtualMethod("CBaseEntity", "Think", 0) == nullptr);
+}
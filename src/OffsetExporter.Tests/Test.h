@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+//! Minimal test registry, so the tests need nothing beyond the exporters' own dependencies.
+//! Every TEST is run by main.cpp. A failed CHECK throws and fails the test it is in.
+namespace Test
+{
+    struct Case
+    {
+        const char* name;
+        std::function<void()> func;
+    };
+
+    inline std::vector<Case>& GetCases()
+    {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    struct Registration
+    {
+        Registration(const char* name, std::function<void()> func) { GetCases().push_back({ name, std::move(func) }); }
+    };
+
+    class Failure : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+}
+
+#define TEST(name) \
+    static void name(); \
+    static Test::Registration name##Registration(#name, name); \
+    static void name()
+
+#define CHECK(expr) \
+    do \
+    { \
+        if (!(expr)) \
+            throw Test::Failure(fmt::format("{}:{}: CHECK({}) failed", __FILE__, __LINE__, #expr)); \
+    } while (false)
@@ -0,0 +1,24 @@
+#include <exception>
+#include "Test.h"
+
+int main()
+{
+    int failed = 0;
+
+    for (const Test::Case& test : Test::GetCases())
+    {
+        try
+        {
+            test.func();
+            fmt::println("PASS {}", test.name);
+        }
+        catch (const std::exception& e)
+        {
+            fmt::println("FAIL {}: {}", test.name, e.what());
+            failed++;
+        }
+    }
+
+    fmt::println("{} of {} tests failed", failed, Test::GetCases().size());
+    return failed == 0 ? 0 : 1;
+}